@@ -0,0 +1,70 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+//---------------------------
+// Host Arduino core (native HAL)
+//---------------------------
+// Stands in for the AVR Arduino core when the firmware is built with
+// [env:native]. Pin I/O, time and peripherals are backed by the simulated
+// board in hal_native.cpp; see hal_native.h for the control interface.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "WString.h"
+#include "Print.h"
+#include "HardwareSerial.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define LED_BUILTIN 13
+
+// Uno analog pin numbering
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+
+#define NUM_DIGITAL_PINS 20
+
+#define PI 3.1415926535897932384626433832795
+
+#define F(string_literal) (string_literal)
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// ATmega328P reset cause register (MCUSR) and its flag bits
+#define PORF  0
+#define EXTRF 1
+#define BORF  2
+#define WDRF  3
+extern uint8_t MCUSR;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void setup(void);
+void loop(void);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include <stdint.h>
+
+//---------------------------
+// Host EEPROM
+//---------------------------
+// The ATmega328P's 1 KB EEPROM. Contents survive halReset() like the
+// real part survives a power cycle; the simulator loads and saves them
+// through halEeprom(). Writes complete instantly.
+class EEPROMClass {
+public:
+    uint8_t read(int idx);
+    void write(int idx, uint8_t value);
+    void update(int idx, uint8_t value);
+    uint16_t length();
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef HARDWARESERIAL_H
+#define HARDWARESERIAL_H
+
+#include "Print.h"
+
+//---------------------------
+// Host serial port
+//---------------------------
+// Transmitted bytes go to the HAL's serial sink (stdout by default);
+// received bytes come from halSerialInject().
+class HardwareSerial : public Print {
+public:
+    void begin(unsigned long baud);
+    void end();
+    int available(void);
+    int peek(void);
+    int read(void);
+    void flush(void);
+    size_t write(uint8_t c);
+    using Print::write;
+    operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif
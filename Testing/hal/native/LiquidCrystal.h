@@ -0,0 +1,27 @@
+#ifndef LIQUIDCRYSTAL_H
+#define LIQUIDCRYSTAL_H
+
+#include <stdint.h>
+#include "Print.h"
+
+//---------------------------
+// Host HD44780 character LCD
+//---------------------------
+// Emulates the controller's display RAM (two lines of 40 characters, the
+// first cols visible) so the simulator can read back what is on screen.
+class LiquidCrystal : public Print {
+public:
+    LiquidCrystal(uint8_t rs, uint8_t enable,
+                  uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3);
+
+    void begin(uint8_t cols, uint8_t rows);
+    void clear();
+    void home();
+    void setCursor(uint8_t col, uint8_t row);
+    void display() {}
+    void noDisplay() {}
+    size_t write(uint8_t c);
+    using Print::write;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef PRINT_H
+#define PRINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "WString.h"
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+//---------------------------
+// Host Print base class
+//---------------------------
+// Mirrors the Arduino core's Print: derived classes implement write(uint8_t)
+// and inherit identical number/float formatting, so host output matches
+// what the board prints byte for byte.
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str);
+
+    size_t print(const char str[]);
+    size_t print(const String &s);
+    size_t print(char c);
+    size_t print(unsigned char b, int base = DEC);
+    size_t print(int n, int base = DEC);
+    size_t print(unsigned int n, int base = DEC);
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(double n, int digits = 2);
+
+    size_t println(void);
+    size_t println(const char str[]);
+    size_t println(const String &s);
+    size_t println(char c);
+    size_t println(unsigned char b, int base = DEC);
+    size_t println(int n, int base = DEC);
+    size_t println(unsigned int n, int base = DEC);
+    size_t println(long n, int base = DEC);
+    size_t println(unsigned long n, int base = DEC);
+    size_t println(double n, int digits = 2);
+
+private:
+    size_t printNumber(unsigned long n, uint8_t base);
+    size_t printFloat(double number, uint8_t digits);
+};
+
+#endif
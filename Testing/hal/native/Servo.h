@@ -0,0 +1,26 @@
+#ifndef SERVO_H
+#define SERVO_H
+
+#include <stdint.h>
+
+//---------------------------
+// Host hobby servo
+//---------------------------
+// Records the commanded angle; the simulated board exposes it through
+// halServoAngle().
+class Servo {
+public:
+    Servo();
+    uint8_t attach(int pin);
+    void detach();
+    void write(int value);
+    void writeMicroseconds(int value);
+    int read();
+    bool attached();
+
+private:
+    int8_t pin;
+    int angle;
+};
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * @file WString.cpp
+ * @brief Host implementation of the Arduino String subset.
+ */
+
+#include "WString.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static std::string formatInteger(unsigned long value, unsigned char base, bool negative) {
+    char buf[8 * sizeof(long) + 2];
+    char *str = &buf[sizeof(buf) - 1];
+    *str = '\0';
+    if (base < 2) base = 10;
+    do {
+        char c = value % base;
+        value /= base;
+        *--str = c < 10 ? c + '0' : c + 'a' - 10;
+    } while (value);
+    if (negative) *--str = '-';
+    return str;
+}
+
+String::String(int value, unsigned char base)
+    : buffer(formatInteger(value < 0 && base == 10 ? -(long)value : (unsigned int)value, base, value < 0 && base == 10)) {}
+String::String(unsigned int value, unsigned char base) : buffer(formatInteger(value, base, false)) {}
+String::String(long value, unsigned char base)
+    : buffer(formatInteger(value < 0 && base == 10 ? -value : value, base, value < 0 && base == 10)) {}
+String::String(unsigned long value, unsigned char base) : buffer(formatInteger(value, base, false)) {}
+
+String::String(float value, unsigned char decimals) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, (double)value);
+    buffer = buf;
+}
+
+String::String(double value, unsigned char decimals) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+    buffer = buf;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+    size_t pos = buffer.find(c, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int from) const {
+    return substring(from, buffer.size());
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) { unsigned int t = from; from = to; to = t; }
+    if (from >= buffer.size()) return String();
+    if (to > buffer.size()) to = buffer.size();
+    return String(buffer.substr(from, to - from));
+}
+
+bool String::startsWith(const String &prefix) const {
+    return buffer.compare(0, prefix.buffer.size(), prefix.buffer) == 0;
+}
+
+void String::trim() {
+    size_t begin = 0;
+    while (begin < buffer.size() && isspace((unsigned char)buffer[begin])) begin++;
+    size_t end = buffer.size();
+    while (end > begin && isspace((unsigned char)buffer[end - 1])) end--;
+    buffer = buffer.substr(begin, end - begin);
+}
+
+void String::toLowerCase() {
+    for (size_t i = 0; i < buffer.size(); i++) {
+        buffer[i] = tolower((unsigned char)buffer[i]);
+    }
+}
+
+long String::toInt() const {
+    return atol(buffer.c_str());
+}
+
+float String::toFloat() const {
+    return (float)atof(buffer.c_str());
+}
+
+String operator+(const String &lhs, const String &rhs) { String r(lhs); r += rhs; return r; }
+String operator+(const String &lhs, const char *rhs)   { String r(lhs); r += rhs; return r; }
+String operator+(const char *lhs, const String &rhs)   { String r(lhs); r += rhs; return r; }
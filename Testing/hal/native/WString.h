@@ -0,0 +1,52 @@
+#ifndef WSTRING_H
+#define WSTRING_H
+
+#include <string>
+
+//---------------------------
+// Host String
+//---------------------------
+// The subset of the Arduino String API used by the firmware, backed by
+// std::string.
+class String {
+public:
+    String(const char *cstr = "") : buffer(cstr ? cstr : "") {}
+    String(const std::string &s) : buffer(s) {}
+    explicit String(char c) : buffer(1, c) {}
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(float value, unsigned char decimals = 2);
+    explicit String(double value, unsigned char decimals = 2);
+
+    unsigned int length() const { return buffer.size(); }
+    const char *c_str() const { return buffer.c_str(); }
+    char charAt(unsigned int index) const { return index < buffer.size() ? buffer[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+
+    String &operator+=(const String &rhs) { buffer += rhs.buffer; return *this; }
+    String &operator+=(const char *rhs) { buffer += rhs; return *this; }
+    String &operator+=(char c) { buffer += c; return *this; }
+    bool operator==(const String &rhs) const { return buffer == rhs.buffer; }
+    bool operator==(const char *rhs) const { return buffer == rhs; }
+    bool operator!=(const String &rhs) const { return buffer != rhs.buffer; }
+
+    int indexOf(char c, unsigned int from = 0) const;
+    String substring(unsigned int from) const;
+    String substring(unsigned int from, unsigned int to) const;
+    bool startsWith(const String &prefix) const;
+    void trim();
+    void toLowerCase();
+    long toInt() const;
+    float toFloat() const;
+
+private:
+    std::string buffer;
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char *rhs);
+String operator+(const char *lhs, const String &rhs);
+
+#endif
@@ -0,0 +1,464 @@
+/**
+ * @file hal_native.cpp
+ * @brief Simulated Arduino Uno board for the native (host) build.
+ *
+ * Implements the Arduino core functions and peripheral classes the
+ * firmware uses, backed by plain host memory:
+ *
+ *  - Pins: mode, output level and injected input level per pin
+ *  - ADC: per-pin injected 10-bit values (halSetAnalogInput())
+ *  - Time: millis()/micros() from the host's monotonic clock, delay()
+ *    sleeps for real; or, with halUseVirtualClock(), a virtual clock that
+ *    only moves when delay() is called or the simulator advances it
+ *  - Trace: traceEvent() from trace.h, forwarded with a timestamp
+ *  - Serial: TX to a FILE sink (stdout by default), RX from a byte queue
+ *  - LCD: HD44780 display RAM, readable with halLcdLine()
+ *  - Servo: last commanded angle per pin, readable with halServoAngle()
+ *  - EEPROM: 1 KB, erased (0xFF) at start-up but kept across halReset(),
+ *    with a per-byte write counter for wear checks
+ *  - MCUSR: reset cause, PORF after halReset() unless halSetResetFlags()
+ *
+ * Nothing here is compiled into the uno firmware; [env:native] adds
+ * hal/native to the include path ahead of any Arduino headers.
+ */
+
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "LiquidCrystal.h"
+#include "Servo.h"
+#include "hal_native.h"
+#include "trace.h"
+
+#include <chrono>
+#include <deque>
+#include <thread>
+
+//====================================================
+// Board State
+//====================================================
+
+static const uint8_t LCD_RAM_COLS = 40;
+
+struct Board {
+    uint8_t pinModes[NUM_DIGITAL_PINS];
+    uint8_t pinOutputs[NUM_DIGITAL_PINS];
+    uint8_t pinInputs[NUM_DIGITAL_PINS];
+    uint16_t analogInputs[NUM_DIGITAL_PINS];
+    int servoAngles[NUM_DIGITAL_PINS];
+
+    std::deque<uint8_t> serialRx;
+    FILE *serialSink;
+
+    char lcdRam[HAL_LCD_ROWS][LCD_RAM_COLS];
+    char lcdLine[HAL_LCD_COLS + 1];
+    uint8_t lcdCol;
+    uint8_t lcdRow;
+};
+
+static Board board;
+static uint8_t eeprom[HAL_EEPROM_SIZE];
+static uint32_t eepromWrites[HAL_EEPROM_SIZE];
+uint8_t MCUSR = 0;
+static std::chrono::steady_clock::time_point clockStart = std::chrono::steady_clock::now();
+
+static bool virtualClock = false;
+static uint64_t virtualMicros = 0;
+static HalAnalogSource analogSource = NULL;
+static HalDigitalSource digitalSource = NULL;
+static HalTraceHandler traceHandler = NULL;
+
+static void lcdClearRam() {
+    memset(board.lcdRam, ' ', sizeof(board.lcdRam));
+    board.lcdCol = 0;
+    board.lcdRow = 0;
+}
+
+/**
+ * @brief Returns the board to its power-on state.
+ *
+ * Inputs read LOW, analog inputs read 0, the servo reads -1 (never
+ * written) and serial output goes to stdout.
+ */
+void halReset() {
+    memset(board.pinModes, INPUT, sizeof(board.pinModes));
+    memset(board.pinOutputs, LOW, sizeof(board.pinOutputs));
+    memset(board.pinInputs, LOW, sizeof(board.pinInputs));
+    memset(board.analogInputs, 0, sizeof(board.analogInputs));
+    for (uint8_t i = 0; i < NUM_DIGITAL_PINS; i++) {
+        board.servoAngles[i] = -1;
+    }
+    board.serialRx.clear();
+    board.serialSink = stdout;
+    lcdClearRam();
+    clockStart = std::chrono::steady_clock::now();
+    virtualMicros = 0;
+    analogSource = NULL;
+    digitalSource = NULL;
+    traceHandler = NULL;
+    MCUSR = 1 << PORF;
+}
+
+static struct BoardInit {
+    BoardInit() {
+        memset(eeprom, 0xFF, sizeof(eeprom));
+        halReset();
+    }
+} boardInit;
+
+//====================================================
+// Board Control (hal_native.h)
+//====================================================
+
+/**
+ * @brief Replaces the reset cause the firmware will read from MCUSR.
+ *
+ * Call after halReset(), e.g. (1 << BORF) to boot as after a brown-out.
+ */
+void halSetResetFlags(uint8_t flags) {
+    MCUSR = flags;
+}
+
+/**
+ * @brief Switches between the host clock and the virtual clock.
+ *
+ * With the virtual clock, delay() returns immediately after moving time
+ * forward, and every millis()/micros() read costs HAL_CLOCK_READ_COST_US
+ * so that a loop polling the clock still makes progress.
+ */
+void halUseVirtualClock(bool enable) {
+    virtualClock = enable;
+    virtualMicros = 0;
+    clockStart = std::chrono::steady_clock::now();
+}
+
+/**
+ * @brief Current board time in microseconds, without 32-bit rollover.
+ */
+uint64_t halNowMicros() {
+    if (virtualClock) {
+        return virtualMicros;
+    }
+    std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - clockStart;
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+/**
+ * @brief Moves the virtual clock forward (no effect on the host clock).
+ */
+void halAdvanceMicros(uint64_t us) {
+    if (virtualClock) {
+        virtualMicros += us;
+    }
+}
+
+/**
+ * @brief Installs a time-varying analog input, overriding halSetAnalogInput().
+ *
+ * Pass NULL to go back to the fixed per-pin values.
+ */
+void halSetAnalogSource(HalAnalogSource source) {
+    analogSource = source;
+}
+
+/**
+ * @brief Installs a time-varying level for input pins, overriding
+ * halSetDigitalInput().
+ *
+ * Pins configured as OUTPUT still read back their own output latch.
+ * Pass NULL to go back to the fixed per-pin values.
+ */
+void halSetDigitalSource(HalDigitalSource source) {
+    digitalSource = source;
+}
+
+void halSetTraceHandler(HalTraceHandler handler) {
+    traceHandler = handler;
+}
+
+void halSetAnalogInput(uint8_t pin, uint16_t value) {
+    if (pin < NUM_DIGITAL_PINS) {
+        board.analogInputs[pin] = value > 1023 ? 1023 : value;
+    }
+}
+
+void halSetDigitalInput(uint8_t pin, uint8_t value) {
+    if (pin < NUM_DIGITAL_PINS) {
+        board.pinInputs[pin] = value ? HIGH : LOW;
+    }
+}
+
+uint8_t halDigitalOutput(uint8_t pin) {
+    return pin < NUM_DIGITAL_PINS ? board.pinOutputs[pin] : LOW;
+}
+
+void halSerialInject(const char *text) {
+    while (*text) {
+        board.serialRx.push_back((uint8_t)*text++);
+    }
+}
+
+void halSetSerialOutput(FILE *sink) {
+    board.serialSink = sink;
+}
+
+/**
+ * @brief Returns the visible characters of one LCD line.
+ *
+ * The pointer stays valid until the next call.
+ */
+const char *halLcdLine(uint8_t row) {
+    if (row >= HAL_LCD_ROWS) {
+        row = HAL_LCD_ROWS - 1;
+    }
+    memcpy(board.lcdLine, board.lcdRam[row], HAL_LCD_COLS);
+    board.lcdLine[HAL_LCD_COLS] = '\0';
+    return board.lcdLine;
+}
+
+int halServoAngle(uint8_t pin) {
+    return pin < NUM_DIGITAL_PINS ? board.servoAngles[pin] : -1;
+}
+
+//====================================================
+// Arduino Core
+//====================================================
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin < NUM_DIGITAL_PINS) {
+        board.pinModes[pin] = mode;
+        if (mode == INPUT_PULLUP) {
+            board.pinInputs[pin] = HIGH;
+        }
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    if (pin < NUM_DIGITAL_PINS) {
+        board.pinOutputs[pin] = value ? HIGH : LOW;
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    if (pin >= NUM_DIGITAL_PINS) {
+        return LOW;
+    }
+    if (board.pinModes[pin] == OUTPUT) {
+        return board.pinOutputs[pin];
+    }
+    if (digitalSource) {
+        return digitalSource(pin, halNowMicros()) ? HIGH : LOW;
+    }
+    return board.pinInputs[pin];
+}
+
+int analogRead(uint8_t pin) {
+    if (pin < A0) {
+        pin += A0;          // analogRead(0) and analogRead(A0) are the same pin
+    }
+    if (pin >= NUM_DIGITAL_PINS) {
+        return 0;
+    }
+    if (analogSource) {
+        uint16_t value = analogSource(pin, halNowMicros());
+        return value > 1023 ? 1023 : value;
+    }
+    return board.analogInputs[pin];
+}
+
+void analogWrite(uint8_t pin, int value) {
+    digitalWrite(pin, value >= 128 ? HIGH : LOW);
+}
+
+unsigned long micros(void) {
+    halAdvanceMicros(HAL_CLOCK_READ_COST_US);
+    return (unsigned long)(uint32_t)halNowMicros();
+}
+
+unsigned long millis(void) {
+    halAdvanceMicros(HAL_CLOCK_READ_COST_US);
+    return (unsigned long)(uint32_t)(halNowMicros() / 1000);
+}
+
+void delay(unsigned long ms) {
+    if (virtualClock) {
+        virtualMicros += (uint64_t)ms * 1000;
+    } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+}
+
+void delayMicroseconds(unsigned int us) {
+    if (virtualClock) {
+        virtualMicros += us;
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+    }
+}
+
+//====================================================
+// Trace
+//====================================================
+
+void traceEvent(TraceEvent event) {
+    if (traceHandler) {
+        traceHandler((uint8_t)event, halNowMicros());
+    }
+}
+
+//====================================================
+// Serial
+//====================================================
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long baud) { (void)baud; }
+void HardwareSerial::end() {}
+int HardwareSerial::available(void) { return (int)board.serialRx.size(); }
+
+int HardwareSerial::peek(void) {
+    return board.serialRx.empty() ? -1 : board.serialRx.front();
+}
+
+int HardwareSerial::read(void) {
+    if (board.serialRx.empty()) {
+        return -1;
+    }
+    uint8_t c = board.serialRx.front();
+    board.serialRx.pop_front();
+    return c;
+}
+
+void HardwareSerial::flush(void) {
+    if (board.serialSink) {
+        fflush(board.serialSink);
+    }
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    if (board.serialSink) {
+        fputc(c, board.serialSink);
+    }
+    return 1;
+}
+
+//====================================================
+// LiquidCrystal
+//====================================================
+
+LiquidCrystal::LiquidCrystal(uint8_t rs, uint8_t enable,
+                             uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3) {
+    (void)rs; (void)enable; (void)d0; (void)d1; (void)d2; (void)d3;
+}
+
+void LiquidCrystal::begin(uint8_t cols, uint8_t rows) {
+    (void)cols; (void)rows;
+    lcdClearRam();
+}
+
+void LiquidCrystal::clear() {
+    lcdClearRam();
+}
+
+void LiquidCrystal::home() {
+    board.lcdCol = 0;
+    board.lcdRow = 0;
+}
+
+void LiquidCrystal::setCursor(uint8_t col, uint8_t row) {
+    board.lcdRow = row < HAL_LCD_ROWS ? row : HAL_LCD_ROWS - 1;
+    board.lcdCol = col < LCD_RAM_COLS ? col : LCD_RAM_COLS - 1;
+}
+
+/**
+ * @brief Writes at the cursor; like the HD44780, the address wraps from
+ *        the end of line 1 display RAM into line 2 and back.
+ */
+size_t LiquidCrystal::write(uint8_t c) {
+    board.lcdRam[board.lcdRow][board.lcdCol] = (char)c;
+    if (++board.lcdCol >= LCD_RAM_COLS) {
+        board.lcdCol = 0;
+        board.lcdRow = (board.lcdRow + 1) % HAL_LCD_ROWS;
+    }
+    return 1;
+}
+
+//====================================================
+// EEPROM
+//====================================================
+
+EEPROMClass EEPROM;
+
+/**
+ * @brief Raw EEPROM image (HAL_EEPROM_SIZE bytes), for loading and saving.
+ */
+uint8_t *halEeprom() {
+    return eeprom;
+}
+
+/**
+ * @brief Number of erase/write cycles one EEPROM byte has seen.
+ */
+uint32_t halEepromWrites(uint16_t addr) {
+    return addr < HAL_EEPROM_SIZE ? eepromWrites[addr] : 0;
+}
+
+uint8_t EEPROMClass::read(int idx) {
+    return (idx >= 0 && idx < HAL_EEPROM_SIZE) ? eeprom[idx] : 0xFF;
+}
+
+void EEPROMClass::write(int idx, uint8_t value) {
+    if (idx >= 0 && idx < HAL_EEPROM_SIZE) {
+        eeprom[idx] = value;
+        eepromWrites[idx]++;
+    }
+}
+
+void EEPROMClass::update(int idx, uint8_t value) {
+    if (read(idx) != value) {
+        write(idx, value);
+    }
+}
+
+uint16_t EEPROMClass::length() {
+    return HAL_EEPROM_SIZE;
+}
+
+//====================================================
+// Servo
+//====================================================
+
+Servo::Servo() : pin(-1), angle(90) {}
+
+uint8_t Servo::attach(int p) {
+    pin = (p >= 0 && p < NUM_DIGITAL_PINS) ? p : -1;
+    return 0;
+}
+
+void Servo::detach() {
+    pin = -1;
+}
+
+void Servo::write(int value) {
+    if (value < 0) value = 0;
+    if (value > 180) {
+        writeMicroseconds(value);   // Arduino treats large values as pulse widths
+        return;
+    }
+    angle = value;
+    if (pin >= 0) {
+        board.servoAngles[pin] = angle;
+    }
+}
+
+void Servo::writeMicroseconds(int value) {
+    value = constrain(value, 544, 2400);
+    write((int)lround((value - 544) * 180.0 / (2400 - 544)));
+}
+
+int Servo::read() {
+    return angle;
+}
+
+bool Servo::attached() {
+    return pin >= 0;
+}
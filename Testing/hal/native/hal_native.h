@@ -0,0 +1,49 @@
+#ifndef HAL_NATIVE_H
+#define HAL_NATIVE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+//---------------------------
+// Simulated board control
+//---------------------------
+// Host-only interface used by the native entry point and the simulator
+// to drive inputs into the firmware and observe its outputs.
+
+const uint64_t HAL_CLOCK_READ_COST_US = 1;  // virtual time consumed per millis()/micros()
+
+const uint16_t HAL_EEPROM_SIZE = 1024;
+
+const uint8_t HAL_LCD_COLS = 16;
+const uint8_t HAL_LCD_ROWS = 2;
+
+void halReset();
+void halSetResetFlags(uint8_t flags);
+
+void halUseVirtualClock(bool enable);
+uint64_t halNowMicros();
+void halAdvanceMicros(uint64_t us);
+
+typedef uint16_t (*HalAnalogSource)(uint8_t pin, uint64_t nowMicros);
+void halSetAnalogSource(HalAnalogSource source);
+
+typedef uint8_t (*HalDigitalSource)(uint8_t pin, uint64_t nowMicros);
+void halSetDigitalSource(HalDigitalSource source);
+
+typedef void (*HalTraceHandler)(uint8_t event, uint64_t nowMicros);
+void halSetTraceHandler(HalTraceHandler handler);
+
+void halSetAnalogInput(uint8_t pin, uint16_t value);
+void halSetDigitalInput(uint8_t pin, uint8_t value);
+uint8_t halDigitalOutput(uint8_t pin);
+
+void halSerialInject(const char *text);
+void halSetSerialOutput(FILE *sink);
+
+uint8_t *halEeprom();
+uint32_t halEepromWrites(uint16_t addr);
+
+const char *halLcdLine(uint8_t row);
+int halServoAngle(uint8_t pin);
+
+#endif
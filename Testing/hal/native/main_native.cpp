@@ -0,0 +1,52 @@
+/**
+ * @file main_native.cpp
+ * @brief Host entry point for the native firmware build.
+ *
+ * Runs the unmodified setup()/loop() firmware against the simulated board
+ * in hal_native.cpp, the same way the Arduino core's main() does on the Uno.
+ *
+ * Usage:
+ *   program [--adc CODE] [--d0 LEVEL] [--seconds N]
+ *
+ *   --adc CODE    value returned by analogRead() on the MQ-135 pin (default 130)
+ *   --d0 LEVEL    level of the MQ-135 digital output (default 0)
+ *   --seconds N   stop after N seconds of loop() (default: run forever)
+ */
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "globals.h"
+#include "hal_native.h"
+
+static void usage(const char *program) {
+    fprintf(stderr, "usage: %s [--adc CODE] [--d0 LEVEL] [--seconds N]\n", program);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    long adcCode = 130;
+    long d0Level = 0;
+    long seconds = -1;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) usage(argv[0]);
+        if (strcmp(argv[i], "--adc") == 0)          adcCode = atol(argv[++i]);
+        else if (strcmp(argv[i], "--d0") == 0)      d0Level = atol(argv[++i]);
+        else if (strcmp(argv[i], "--seconds") == 0) seconds = atol(argv[++i]);
+        else usage(argv[0]);
+    }
+
+    halSetAnalogInput(CO2_analog_pin, (uint16_t)adcCode);
+    halSetDigitalInput(CO2_digital_pin, (uint8_t)d0Level);
+
+    setup();
+    unsigned long start = millis();
+    while (seconds < 0 || millis() - start < (unsigned long)seconds * 1000UL) {
+        loop();
+    }
+    Serial.flush();
+    return 0;
+}
@@ -0,0 +1,206 @@
+/**
+ * @file avr_profile.c
+ * @brief Cycle-accurate profiler for the uno firmware image under simavr.
+ *
+ * Loads the ELF built by env:uno_profile into a simulated ATmega328P at
+ * 16 MHz and watches writes to GPIOR0, where PROFILE_SCOPE() (src/profile.h)
+ * marks scope entry (id) and exit (id | PROFILE_EXIT). Every write carries
+ * the exact cycle count, so per-point statistics are exact:
+ *
+ *  - calls, inclusive cycles (total / mean / max)
+ *  - self cycles: inclusive minus nested points, including ADC_vect
+ *    interrupting a scope
+ *
+ * Peripherals are stubbed: A0 is held at a fixed voltage (--adc-mv),
+ * UART output is discarded, LCD/servo/buzzer pins are left unconnected.
+ * The run covers setup() and then the requested number of seconds of
+ * loop(). Preheat is adaptive (8-60 s, src/warmup.h), so setup() has no
+ * fixed length: the loop() window starts at the first loop() marker, and
+ * the run gives up if none arrives within SETUP_LIMIT_S.
+ *
+ * Report (JSON, --out or stdout): per-point statistics plus the
+ * worst-case loop() pass in cycles and microseconds.
+ *
+ * Build (done by profile/profile_target.py):
+ *   cc -O2 avr_profile.c -o avr_profile $(pkg-config --cflags --libs simavr) -lelf
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+#include <simavr/avr_adc.h>
+
+#include "../src/profile.h"
+
+#define F_CPU_HZ 16000000UL
+#define GPIOR0_DATA_ADDR 0x3E       /* I/O 0x1E + 0x20 */
+#define MAX_DEPTH 16
+#define SETUP_LIMIT_S 120.0         /* preheat maximum 60 s plus calibration, with margin */
+
+#define PROFILE_NAME(id, name) name,
+static const char *const pointNames[PROF_POINT_COUNT] = { "none", PROFILE_POINTS(PROFILE_NAME) };
+
+struct PointStats {
+    uint64_t calls;
+    uint64_t totalCycles;
+    uint64_t selfCycles;
+    uint64_t maxCycles;
+};
+
+struct Frame {
+    uint8_t id;
+    avr_cycle_count_t start;
+    avr_cycle_count_t childCycles;
+};
+
+static struct PointStats stats[PROF_POINT_COUNT];
+static struct Frame stack[MAX_DEPTH];
+static int depth = 0;
+static unsigned long unmatched = 0;
+static avr_cycle_count_t loopStart = 0;    /* cycle of the first loop() entry, 0 until then */
+
+static void onMarker(struct avr_t *avr, avr_io_addr_t addr, uint8_t value, void *param) {
+    (void)param;
+    avr->data[addr] = value;
+    uint8_t id = value & ~PROFILE_EXIT;
+    if (id == PROF_NONE || id >= PROF_POINT_COUNT) {
+        return;
+    }
+
+    if (!(value & PROFILE_EXIT)) {
+        if (depth == MAX_DEPTH) {
+            unmatched++;
+            return;
+        }
+        if (id == PROF_LOOP && loopStart == 0) {
+            loopStart = avr->cycle;
+        }
+        stack[depth].id = id;
+        stack[depth].start = avr->cycle;
+        stack[depth].childCycles = 0;
+        depth++;
+        return;
+    }
+
+    if (depth == 0 || stack[depth - 1].id != id) {
+        unmatched++;
+        return;
+    }
+    depth--;
+    uint64_t inclusive = avr->cycle - stack[depth].start;
+    struct PointStats *s = &stats[id];
+    s->calls++;
+    s->totalCycles += inclusive;
+    s->selfCycles += inclusive - stack[depth].childCycles;
+    if (inclusive > s->maxCycles) {
+        s->maxCycles = inclusive;
+    }
+    if (depth > 0) {
+        stack[depth - 1].childCycles += inclusive;
+    }
+}
+
+static void writeReport(FILE *out, const char *elf, double seconds, unsigned adcMillivolts,
+                        avr_cycle_count_t cycles) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"firmware\": \"%s\",\n", elf);
+    fprintf(out, "  \"mcu\": \"atmega328p\",\n");
+    fprintf(out, "  \"f_cpu\": %lu,\n", F_CPU_HZ);
+    fprintf(out, "  \"setup_seconds\": %.3f,\n", (double)loopStart / F_CPU_HZ);
+    fprintf(out, "  \"loop_seconds\": %.3f,\n", seconds);
+    fprintf(out, "  \"adc_millivolts\": %u,\n", adcMillivolts);
+    fprintf(out, "  \"total_cycles\": %llu,\n", (unsigned long long)cycles);
+    fprintf(out, "  \"unmatched_markers\": %lu,\n", unmatched);
+    fprintf(out, "  \"loop_worst_cycles\": %llu,\n", (unsigned long long)stats[PROF_LOOP].maxCycles);
+    fprintf(out, "  \"loop_worst_us\": %.1f,\n", stats[PROF_LOOP].maxCycles * 1e6 / F_CPU_HZ);
+    fprintf(out, "  \"points\": [\n");
+    int first = 1;
+    for (int id = 1; id < PROF_POINT_COUNT; id++) {
+        const struct PointStats *s = &stats[id];
+        fprintf(out, "%s    { \"name\": \"%s\", \"calls\": %llu, \"total_cycles\": %llu, "
+                     "\"self_cycles\": %llu, \"mean_cycles\": %.1f, \"max_cycles\": %llu }",
+                first ? "" : ",\n", pointNames[id], (unsigned long long)s->calls,
+                (unsigned long long)s->totalCycles, (unsigned long long)s->selfCycles,
+                s->calls ? (double)s->totalCycles / s->calls : 0.0,
+                (unsigned long long)s->maxCycles);
+        first = 0;
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "usage: %s firmware.elf [--seconds S] [--adc-mv MV] [--out FILE]\n", program);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    const char *elf = NULL;
+    const char *outPath = NULL;
+    double seconds = 60.0;          /* of loop(), after setup() */
+    unsigned adcMillivolts = 630;   /* ~ADC 129, clean air at R0 76.63 */
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-') { elf = argv[i]; continue; }
+        if (i + 1 >= argc) usage(argv[0]);
+        if (strcmp(argv[i], "--seconds") == 0) seconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--adc-mv") == 0) adcMillivolts = (unsigned)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--out") == 0) outPath = argv[++i];
+        else usage(argv[0]);
+    }
+    if (!elf) usage(argv[0]);
+
+    elf_firmware_t firmware;
+    memset(&firmware, 0, sizeof(firmware));
+    if (elf_read_firmware(elf, &firmware) != 0) {
+        fprintf(stderr, "%s: cannot load firmware\n", elf);
+        return 1;
+    }
+    avr_t *avr = avr_make_mcu_by_name("atmega328p");
+    if (!avr) {
+        fprintf(stderr, "simavr has no atmega328p core\n");
+        return 1;
+    }
+    avr_init(avr);
+    avr->log = LOG_NONE;                    /* discards UART output as well */
+    firmware.frequency = F_CPU_HZ;
+    avr_load_firmware(avr, &firmware);
+
+    avr_register_io_write(avr, GPIOR0_DATA_ADDR, onMarker, NULL);
+    avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_ADC_GETIRQ, ADC_IRQ_ADC0), adcMillivolts);
+
+    avr_cycle_count_t setupLimit = (avr_cycle_count_t)(SETUP_LIMIT_S * F_CPU_HZ);
+    avr_cycle_count_t loopCycles = (avr_cycle_count_t)(seconds * F_CPU_HZ);
+    int state = cpu_Running;
+    while (state != cpu_Done && state != cpu_Crashed) {
+        if (loopStart == 0 ? avr->cycle >= setupLimit : avr->cycle >= loopStart + loopCycles) {
+            break;
+        }
+        state = avr_run(avr);
+    }
+    if (state == cpu_Crashed) {
+        fprintf(stderr, "firmware crashed at cycle %llu\n", (unsigned long long)avr->cycle);
+        return 1;
+    }
+    if (loopStart == 0) {
+        fprintf(stderr, "setup() did not reach loop() within %.0f s\n", SETUP_LIMIT_S);
+        return 1;
+    }
+
+    FILE *out = outPath ? fopen(outPath, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "%s: cannot write report\n", outPath);
+        return 1;
+    }
+    writeReport(out, elf, seconds, adcMillivolts, avr->cycle);
+    if (outPath) {
+        fclose(out);
+        printf("Profile report written to %s (setup() %.1f s, worst loop() pass %.1f us)\n",
+               outPath, (double)loopStart / F_CPU_HZ, stats[PROF_LOOP].maxCycles * 1e6 / F_CPU_HZ);
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+# PlatformIO extra script for env:uno_profile.
+#
+# Adds a "profile" target that builds the simavr runner (avr_profile.c)
+# on the host and runs the freshly built firmware ELF under it:
+#
+#   pio run -e uno_profile -t profile
+#
+# Requires simavr and libelf development packages on the host
+# (e.g. apt install libsimavr-dev libelf-dev pkg-config).
+# Override the run with PROFILE_ARGS, e.g. PROFILE_ARGS="--seconds 300".
+
+import os
+import subprocess
+
+Import("env")
+
+project_dir = env.subst("$PROJECT_DIR")
+build_dir = env.subst("$BUILD_DIR")
+runner_src = os.path.join(project_dir, "profile", "avr_profile.c")
+runner_bin = os.path.join(build_dir, "avr_profile")
+report = os.path.join(build_dir, "profile_report.json")
+
+
+def simavr_flags():
+    try:
+        out = subprocess.check_output(["pkg-config", "--cflags", "--libs", "simavr"])
+        return out.decode().split()
+    except (OSError, subprocess.CalledProcessError):
+        return ["-I/usr/include/simavr", "-lsimavr"]
+
+
+def build_runner(target, source, env):
+    cmd = ["cc", "-std=c99", "-O2", runner_src, "-o", runner_bin] + simavr_flags() + ["-lelf"]
+    print(" ".join(cmd))
+    return subprocess.call(cmd)
+
+
+def run_profile(target, source, env):
+    args = os.environ.get("PROFILE_ARGS", "").split()
+    cmd = [runner_bin, env.subst("$BUILD_DIR/${PROGNAME}.elf"), "--out", report] + args
+    print(" ".join(cmd))
+    return subprocess.call(cmd)
+
+
+env.AddCustomTarget(
+    name="profile",
+    dependencies="$BUILD_DIR/${PROGNAME}.elf",
+    actions=[build_runner, run_profile],
+    title="AVR cycle profile",
+    description="Run the firmware under simavr and report per-function cycle counts",
+)
@@ -0,0 +1,248 @@
+/**
+ * @file adc_trace.cpp
+ * @brief Writer and zero-copy reader for .mqtr ADC traces.
+ *
+ * The reader maps the whole file read-only and decodes samples straight
+ * out of the mapping with a forward cursor, so a multi-hour capture opens
+ * in constant time and replays without a single allocation. The kernel
+ * pages the file in as the cursor reaches it.
+ *
+ * Dependencies:
+ *  - POSIX mmap (host tooling only, never built for the board)
+ */
+
+#include "adc_trace.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const uint8_t LONG_FORM = 0x80;
+static const uint8_t D0_BIT = 0x40;
+
+//====================================================
+// Writer
+//====================================================
+
+/**
+ * @brief Creates a trace file and writes a provisional header.
+ *
+ * The sample count and payload size are filled in by adcTraceClose().
+ */
+bool adcTraceCreate(AdcTraceWriter *writer, const char *path, double sampleRateHz,
+                    float r0AtCapture, uint8_t analogPin, uint8_t digitalPin) {
+    memset(writer, 0, sizeof(*writer));
+    writer->file = fopen(path, "wb");
+    if (!writer->file) {
+        return false;
+    }
+    memcpy(writer->header.magic, ADC_TRACE_MAGIC, sizeof(ADC_TRACE_MAGIC));
+    writer->header.version = ADC_TRACE_VERSION;
+    writer->header.headerSize = sizeof(AdcTraceHeader);
+    writer->header.sampleRateMilliHz = (uint32_t)(sampleRateHz * 1000.0 + 0.5);
+    writer->header.r0AtCapture = r0AtCapture;
+    writer->header.analogPin = analogPin;
+    writer->header.digitalPin = digitalPin;
+    writer->previous = -1;
+    return fwrite(&writer->header, sizeof(writer->header), 1, writer->file) == 1;
+}
+
+/**
+ * @brief Appends one sample, choosing the short form when the delta fits.
+ */
+bool adcTraceAppend(AdcTraceWriter *writer, uint16_t code, uint8_t d0) {
+    uint8_t bytes[2];
+    size_t length;
+    uint8_t d0Bit = d0 ? D0_BIT : 0;
+
+    code &= 0x3FF;                      // 10-bit ADC code; the delta is taken on what is stored
+    int delta = (int)code - writer->previous;
+    if (writer->previous >= 0 && delta >= -32 && delta <= 31) {
+        bytes[0] = d0Bit | (uint8_t)(delta & 0x3F);
+        length = 1;
+    } else {
+        bytes[0] = LONG_FORM | d0Bit | (uint8_t)(code >> 8);
+        bytes[1] = (uint8_t)(code & 0xFF);
+        length = 2;
+    }
+    writer->previous = code;
+    writer->header.sampleCount++;
+    writer->header.payloadBytes += length;
+    return fwrite(bytes, 1, length, writer->file) == length;
+}
+
+/**
+ * @brief Rewrites the header with the final counts and closes the file.
+ */
+bool adcTraceClose(AdcTraceWriter *writer) {
+    bool ok = fseek(writer->file, 0, SEEK_SET) == 0
+           && fwrite(&writer->header, sizeof(writer->header), 1, writer->file) == 1;
+    ok = (fclose(writer->file) == 0) && ok;
+    writer->file = NULL;
+    return ok;
+}
+
+//====================================================
+// Reader
+//====================================================
+
+/**
+ * @brief Decodes the sample at the cursor into reader->code / d0.
+ */
+static bool decodeNext(AdcTraceReader *reader) {
+    const uint8_t *p = reader->cursor;
+    if (p >= reader->payloadEnd) {
+        return false;
+    }
+    uint8_t b = *p++;
+    if (b & LONG_FORM) {
+        if (p >= reader->payloadEnd) {
+            return false;
+        }
+        reader->code = (uint16_t)(((b & 0x03) << 8) | *p++);
+    } else {
+        int delta = (b & 0x20) ? (int)(b & 0x3F) - 64 : (int)(b & 0x3F);
+        reader->code = (uint16_t)((reader->code + delta) & 0x3FF);
+    }
+    reader->d0 = (b & D0_BIT) ? 1 : 0;
+    reader->cursor = p;
+    return true;
+}
+
+static void readerRewind(AdcTraceReader *reader) {
+    reader->cursor = reader->payload;
+    reader->code = 0;
+    reader->d0 = 0;
+    decodeNext(reader);
+    reader->index = 0;
+}
+
+/**
+ * @brief Maps a trace file and validates its header.
+ *
+ * Returns false (with a message on stderr) for missing, truncated or
+ * foreign files.
+ */
+bool adcTraceOpen(AdcTraceReader *reader, const char *path) {
+    memset(reader, 0, sizeof(*reader));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(AdcTraceHeader)) {
+        fprintf(stderr, "%s: too short for a trace header\n", path);
+        close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "%s: mmap failed\n", path);
+        return false;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    reader->map = (const uint8_t *)map;
+    reader->mapSize = st.st_size;
+    reader->header = (const AdcTraceHeader *)map;
+
+    const AdcTraceHeader *h = reader->header;
+    if (memcmp(h->magic, ADC_TRACE_MAGIC, sizeof(ADC_TRACE_MAGIC)) != 0
+        || h->version != ADC_TRACE_VERSION
+        || h->headerSize < sizeof(AdcTraceHeader)
+        || h->sampleRateMilliHz == 0
+        || h->sampleCount == 0
+        || (size_t)h->headerSize + h->payloadBytes > reader->mapSize) {
+        fprintf(stderr, "%s: not a valid MQTR v%u trace\n", path, ADC_TRACE_VERSION);
+        adcTraceCloseReader(reader);
+        return false;
+    }
+    reader->payload = reader->map + h->headerSize;
+    reader->payloadEnd = reader->payload + h->payloadBytes;
+    readerRewind(reader);
+    return true;
+}
+
+void adcTraceCloseReader(AdcTraceReader *reader) {
+    if (reader->map) {
+        munmap((void *)reader->map, reader->mapSize);
+    }
+    memset(reader, 0, sizeof(*reader));
+}
+
+double adcTraceSampleRate(const AdcTraceReader *reader) {
+    return reader->header->sampleRateMilliHz / 1000.0;
+}
+
+double adcTraceDuration(const AdcTraceReader *reader) {
+    return reader->header->sampleCount / adcTraceSampleRate(reader);
+}
+
+/**
+ * @brief Positions the cursor on a sample, leaving it in code / d0.
+ *
+ * Forward seeks decode incrementally from the current position, so
+ * replaying in time order costs O(1) per sample. Seeking past the end
+ * leaves the last sample in place and returns false.
+ */
+bool adcTraceSeek(AdcTraceReader *reader, uint32_t index) {
+    if (index < reader->index) {
+        readerRewind(reader);
+    }
+    while (reader->index < index) {
+        if (!decodeNext(reader)) {
+            return false;
+        }
+        reader->index++;
+    }
+    return true;
+}
+
+//====================================================
+// Replay
+//====================================================
+
+static AdcTraceReader *replay = NULL;
+static double replayOffset = 0.0;
+
+/**
+ * @brief Selects the trace served by the replay sources.
+ */
+void adcTraceReplayBegin(AdcTraceReader *reader, double offsetSeconds) {
+    replay = reader;
+    replayOffset = offsetSeconds;
+}
+
+static void replaySeek(uint64_t nowMicros) {
+    double seconds = nowMicros / 1e6 + replayOffset;
+    double index = seconds > 0 ? seconds * adcTraceSampleRate(replay) : 0.0;
+    uint32_t last = replay->header->sampleCount - 1;
+    adcTraceSeek(replay, index >= last ? last : (uint32_t)index);
+}
+
+/**
+ * @brief HalAnalogSource serving the trace's analog pin (others read 0).
+ */
+uint16_t adcTraceReplayAnalog(uint8_t pin, uint64_t nowMicros) {
+    if (!replay || pin != replay->header->analogPin) {
+        return 0;
+    }
+    replaySeek(nowMicros);
+    return replay->code;
+}
+
+/**
+ * @brief HalDigitalSource serving the trace's D0 pin (others read LOW).
+ */
+uint8_t adcTraceReplayDigital(uint8_t pin, uint64_t nowMicros) {
+    if (!replay || pin != replay->header->digitalPin) {
+        return 0;
+    }
+    replaySeek(nowMicros);
+    return replay->d0;
+}
@@ -0,0 +1,84 @@
+#ifndef ADC_TRACE_H
+#define ADC_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+//---------------------------
+// Binary ADC trace format (.mqtr)
+//---------------------------
+// All fields little-endian. The header is followed by sampleCount
+// delta-encoded samples of (10-bit ADC code, D0 level):
+//
+//   0 d s s s s s s          short form: d = D0, s = signed 6-bit delta
+//   1 d 0 0 0 0 h h  llll    long form:  d = D0, hh:llll = absolute code
+//
+// The first sample is always in long form. A steady MQ-135 signal costs
+// one byte per sample (~176 KB per hour at 50 Hz).
+
+const char ADC_TRACE_MAGIC[4] = { 'M', 'Q', 'T', 'R' };
+const uint16_t ADC_TRACE_VERSION = 1;
+
+struct AdcTraceHeader {
+    char magic[4];              // "MQTR"
+    uint16_t version;           // ADC_TRACE_VERSION
+    uint16_t headerSize;        // sizeof(AdcTraceHeader), lets readers skip future fields
+    uint32_t sampleRateMilliHz; // samples per 1000 s, e.g. 50000 for 50 Hz
+    uint32_t sampleCount;
+    uint32_t payloadBytes;      // encoded sample bytes following the header
+    float r0AtCapture;          // firmware R0 when recorded (kOhm), 0 if unknown
+    uint8_t analogPin;          // Arduino pin number of the MQ-135 AO (A0 = 14)
+    uint8_t digitalPin;         // Arduino pin number of the MQ-135 DO
+    uint8_t reserved[6];
+};
+
+//---------------------------
+// Writer
+//---------------------------
+struct AdcTraceWriter {
+    FILE *file;
+    AdcTraceHeader header;
+    int previous;               // previous ADC code, -1 before the first sample
+};
+
+bool adcTraceCreate(AdcTraceWriter *writer, const char *path, double sampleRateHz,
+                    float r0AtCapture, uint8_t analogPin, uint8_t digitalPin);
+bool adcTraceAppend(AdcTraceWriter *writer, uint16_t code, uint8_t d0);
+bool adcTraceClose(AdcTraceWriter *writer);
+
+//---------------------------
+// Memory-mapped reader
+//---------------------------
+struct AdcTraceReader {
+    const uint8_t *map;         // whole file, read-only mapping
+    size_t mapSize;
+    const AdcTraceHeader *header;
+    const uint8_t *payload;
+    const uint8_t *payloadEnd;
+
+    // Streaming cursor: decodes forward only, restarts on a backward seek.
+    const uint8_t *cursor;
+    uint32_t index;             // index of the sample held in code/d0
+    uint16_t code;
+    uint8_t d0;
+};
+
+bool adcTraceOpen(AdcTraceReader *reader, const char *path);
+void adcTraceCloseReader(AdcTraceReader *reader);
+double adcTraceSampleRate(const AdcTraceReader *reader);
+double adcTraceDuration(const AdcTraceReader *reader);
+bool adcTraceSeek(AdcTraceReader *reader, uint32_t index);
+
+//---------------------------
+// Replay into the native HAL
+//---------------------------
+// Install with halSetAnalogSource(adcTraceReplayAnalog) and
+// halSetDigitalSource(adcTraceReplayDigital). Board time t maps to sample
+// floor((t + offset) * rate); past the end the last sample is held.
+
+void adcTraceReplayBegin(AdcTraceReader *reader, double offsetSeconds);
+uint16_t adcTraceReplayAnalog(uint8_t pin, uint64_t nowMicros);
+uint8_t adcTraceReplayDigital(uint8_t pin, uint64_t nowMicros);
+
+#endif
@@ -0,0 +1,377 @@
+/**
+ * @file alarm_bench.cpp
+ * @brief Alarm-latency benchmark: gas scenarios to activateWarningSystem().
+ *
+ * Each scenario is run for a number of trials. A trial powers the board
+ * up, runs setup(), then injects the scenario's gas episodes at a random
+ * phase (so the 1 s processing gate and the 5 minute recalibration cycle
+ * are sampled rather than always hit the same way) and records every
+ * warning transition.
+ *
+ * Metrics per scenario:
+ *  - detection latency: from the moment the true concentration first
+ *    exceeds PPM_THRESHOLD to the first warning_on (the servo move
+ *    starts in the same call); reported as p50 / p99 over detected trials
+ *  - missed: alarm expected but never raised within the run
+ *  - false alarms: warning_on with no alarm due, i.e. in scenarios that
+ *    should never alarm, or before the threshold crossing
+ *  - chatter: warning_on plus warning_off transitions per hour of
+ *    scenario time, averaged over the trials. The hover scenario keeps
+ *    the concentration wobbling across PPM_THRESHOLD, where a single
+ *    comparison toggles the servo and buzzer on every swing
+ *
+ * Trial isolation: each trial runs through simRunIsolated(), i.e. from
+ * power-on state.
+ *
+ * Baseline file: one line per scenario, compared with a tolerance of
+ * BENCH_LATENCY_SLACK_S or BENCH_LATENCY_SLACK_PCT (whichever is larger)
+ * on p50/p99; any extra false alarm or missed detection is a regression,
+ * and so is chatter above the baseline by more than BENCH_CHATTER_SLACK
+ * per hour or BENCH_LATENCY_SLACK_PCT. Baselines written before the
+ * chatter column existed are still read; chatter is then not compared.
+ *
+ * Dependencies:
+ *  - simulator.h    : virtual-clock firmware runner
+ *  - sensor_model.h : synthetic MQ-135
+ *  - globals.h      : PPM_THRESHOLD
+ */
+
+#include "alarm_bench.h"
+#include "envcomp.h"
+#include "globals.h"
+#include "hal_native.h"
+#include "simulator.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static const double BENCH_SETTLE_S = 60.0;          // earliest gas start after setup()
+static const double BENCH_PHASE_SPAN_S = 300.0;     // random start spread (one recalibration cycle)
+static const double BENCH_TRUTH_STEP_S = 0.01;      // resolution of the threshold-crossing search
+static const double BENCH_LATENCY_SLACK_S = 0.5;
+static const double BENCH_LATENCY_SLACK_PCT = 5.0;
+static const double BENCH_CHATTER_SLACK = 1.0;      // transitions per hour
+
+static const uint8_t BENCH_MAX_EPISODES = 3;
+
+struct BenchScenario {
+    const char *name;
+    const char *description;
+    bool alarmExpected;
+    double seconds;                 // run length after the first episode starts
+    uint8_t episodeCount;
+    GasEpisode episodes[BENCH_MAX_EPISODES];    // start times relative to the scenario start
+    double wobblePeriod;            // > 0: repeat wobble from the scenario start every period
+    GasEpisode wobble;              // added on top of the episodes; ppm is the swing above them
+};
+
+//                 start  rise  hold  fall  ppm
+static const BenchScenario scenarios[] = {
+    { "step", "420 -> 3000 ppm step, held 3 min", true, 300.0, 1,
+      { { 0.0, 0.0, 180.0, 0.0, 3000.0f } },
+      0.0, { 0.0, 0.0, 0.0, 0.0, 0.0f } },
+    { "ramp", "420 -> 3000 ppm over 10 min, held 2 min", true, 900.0, 1,
+      { { 0.0, 600.0, 120.0, 0.0, 3000.0f } },
+      0.0, { 0.0, 0.0, 0.0, 0.0, 0.0f } },
+    { "breath", "three 2 s exhalations (20000 ppm), 20 s apart", false, 300.0, 3,
+      { { 0.0, 0.5, 0.5, 1.0, 20000.0f },
+        { 20.0, 0.5, 0.5, 1.0, 20000.0f },
+        { 40.0, 0.5, 0.5, 1.0, 20000.0f } },
+      0.0, { 0.0, 0.0, 0.0, 0.0, 0.0f } },
+    { "clean", "ambient air only, 1 hour", false, 3600.0, 0,
+      { { 0.0, 0.0, 0.0, 0.0, 0.0f } },
+      0.0, { 0.0, 0.0, 0.0, 0.0, 0.0f } },
+    { "plateau", "1500 ppm held 5 min, then 3000 ppm for 3 min", true, 600.0, 2,
+      { { 0.0, 60.0, 540.0, 0.0, 1500.0f },
+        { 360.0, 0.0, 180.0, 0.0, 1920.0f } },
+      0.0, { 0.0, 0.0, 0.0, 0.0, 0.0f } },
+    { "hover", "2000 ppm for 15 min, +200 ppm swings every minute", true, 900.0, 1,
+      { { 0.0, 60.0, 900.0, 0.0, 2000.0f } },
+      60.0, { 60.0, 20.0, 20.0, 20.0, 200.0f } },
+};
+
+static const size_t SCENARIO_COUNT = sizeof(scenarios) / sizeof(scenarios[0]);
+
+struct TrialResult {
+    uint8_t detected;
+    double latency;
+    uint32_t falseAlarms;
+    uint32_t transitions;           // warning_on and warning_off within the scenario
+};
+
+struct ScenarioResult {
+    unsigned trials;
+    unsigned detected;
+    unsigned missed;
+    double p50;
+    double p99;
+    double worst;
+    unsigned falseAlarms;
+    double chatter;                 // transitions per hour
+};
+
+//====================================================
+// Single Trial (runs in the child process)
+//====================================================
+
+/**
+ * @brief First time at or after from when the true concentration exceeds
+ * PPM_THRESHOLD, or a negative value if it never does before until.
+ */
+static double thresholdCrossing(double from, double until) {
+    for (double t = from; t <= until; t += BENCH_TRUTH_STEP_S) {
+        if (sensorModelTruePPM(t) > PPM_THRESHOLD) {
+            return t;
+        }
+    }
+    return -1.0;
+}
+
+static TrialResult runTrial(const BenchScenario &scenario, const SensorModelConfig &base, unsigned trial) {
+    SensorModelConfig model = base;
+    model.seed = base.seed + trial;
+    std::mt19937 phaseRng(model.seed ^ 0x9E3779B9u);
+    std::uniform_real_distribution<double> phase(0.0, BENCH_PHASE_SPAN_S);
+
+    simBegin(NULL);
+    sensorModelInit(model);
+    halSetAnalogSource(sensorModelSample);
+    envSetSource(sensorModelEnvironment);
+    simRunSetup();
+
+    double origin = simNowMicros() / 1e6;
+    double start = origin + BENCH_SETTLE_S + phase(phaseRng);
+    double end = start + scenario.seconds;
+    for (uint8_t i = 0; i < scenario.episodeCount; i++) {
+        GasEpisode episode = scenario.episodes[i];
+        episode.start += start;
+        sensorModelAddEpisode(episode);
+    }
+    if (scenario.wobblePeriod > 0) {
+        for (double t = 0; t < scenario.seconds; t += scenario.wobblePeriod) {
+            GasEpisode episode = scenario.wobble;
+            episode.start += start + t;
+            episode.ppm += model.ambientPPM;
+            sensorModelAddEpisode(episode);
+        }
+    }
+    double crossing = scenario.alarmExpected ? thresholdCrossing(start, end) : -1.0;
+
+    simRunUntil((uint64_t)(end * 1e6));
+
+    TrialResult result = { 0, 0.0, 0, 0 };
+    const std::vector<SimTransition> &log = simTransitions();
+    for (size_t i = 0; i < log.size(); i++) {
+        double t = log[i].micros / 1e6;
+        if ((log[i].event == TRACE_WARNING_ON || log[i].event == TRACE_WARNING_OFF) && t >= start) {
+            result.transitions++;
+        }
+        if (log[i].event != TRACE_WARNING_ON) {
+            continue;
+        }
+        if (crossing < 0 || t < crossing) {
+            result.falseAlarms++;
+        } else if (!result.detected) {
+            result.detected = 1;
+            result.latency = t - crossing;
+        }
+    }
+    return result;
+}
+
+struct TrialContext {
+    const BenchScenario *scenario;
+    const SensorModelConfig *model;
+    unsigned trial;
+};
+
+static void isolatedTrial(const void *context, void *result) {
+    const TrialContext *c = (const TrialContext *)context;
+    *(TrialResult *)result = runTrial(*c->scenario, *c->model, c->trial);
+}
+
+static bool runIsolatedTrial(const BenchScenario &scenario, const SensorModelConfig &model,
+                             unsigned trial, TrialResult *result) {
+    TrialContext context = { &scenario, &model, trial };
+    return simRunIsolated(isolatedTrial, &context, result, sizeof(*result));
+}
+
+//====================================================
+// Statistics / Baseline
+//====================================================
+
+/**
+ * @brief Nearest-rank percentile of an ascending sample.
+ */
+static double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t rank = (size_t)ceil(p * sorted.size());
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void printRow(const char *name, const ScenarioResult &r) {
+    if (r.detected > 0) {
+        printf("  %-8s %6u %8u %8u %9.3f %9.3f %9.3f %8u %9.1f\n", name, r.trials, r.detected,
+               r.missed, r.p50, r.p99, r.worst, r.falseAlarms, r.chatter);
+    } else {
+        printf("  %-8s %6u %8u %8u %9s %9s %9s %8u %9.1f\n", name, r.trials, r.detected,
+               r.missed, "-", "-", "-", r.falseAlarms, r.chatter);
+    }
+}
+
+static bool writeBaseline(const char *path, const AlarmBenchOptions &options,
+                          const ScenarioResult *results) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "%s: cannot write baseline\n", path);
+        return false;
+    }
+    fprintf(file, "# Alarm-latency baseline, regenerate with: sim --bench --baseline %s --update-baseline\n", path);
+    fprintf(file, "# model: r0=%.2f ambient=%.0f noise=%.2f tau=%.1f seed=%u warmup=%.1f\n",
+            options.model.r0, options.model.ambientPPM, options.model.noiseCodes,
+            options.model.tauSeconds, options.model.seed, options.model.warmupSeconds);
+    fprintf(file, "# scenario trials missed p50_s p99_s false_alarms chatter_per_h\n");
+    for (size_t s = 0; s < SCENARIO_COUNT; s++) {
+        fprintf(file, "%s %u %u %.3f %.3f %u %.2f\n", scenarios[s].name, results[s].trials,
+                results[s].missed, results[s].p50, results[s].p99, results[s].falseAlarms,
+                results[s].chatter);
+    }
+    return fclose(file) == 0;
+}
+
+static bool exceeds(double current, double baseline, double minimumSlack) {
+    double slack = baseline * BENCH_LATENCY_SLACK_PCT / 100.0;
+    if (slack < minimumSlack) {
+        slack = minimumSlack;
+    }
+    return current > baseline + slack;
+}
+
+static bool latencyRegressed(double current, double baseline) {
+    return exceeds(current, baseline, BENCH_LATENCY_SLACK_S);
+}
+
+/**
+ * @brief Compares results against a baseline file.
+ *
+ * Returns:
+ *  @return int - 0 if nothing regressed, 1 on regression, 2 if the
+ *                baseline cannot be read
+ */
+static int checkBaseline(const char *path, const ScenarioResult *results) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "%s: cannot read baseline\n", path);
+        return 2;
+    }
+    printf("\nBaseline %s:\n", path);
+    int status = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        char name[32];
+        unsigned trials, missed, falseAlarms;
+        double p50, p99, chatter;
+        int fields = line[0] == '#' ? 0 : sscanf(line, "%31s %u %u %lf %lf %u %lf", name, &trials,
+                                                &missed, &p50, &p99, &falseAlarms, &chatter);
+        if (fields < 6) {
+            continue;
+        }
+        bool hasChatter = fields == 7;
+        size_t s = 0;
+        while (s < SCENARIO_COUNT && strcmp(scenarios[s].name, name) != 0) {
+            s++;
+        }
+        if (s == SCENARIO_COUNT) {
+            printf("  %-8s not in this build, ignored\n", name);
+            continue;
+        }
+        const ScenarioResult &r = results[s];
+        bool hadLatency = missed < trials && scenarios[s].alarmExpected;
+        bool regressed = r.missed * trials > missed * r.trials
+                      || r.falseAlarms * trials > falseAlarms * r.trials
+                      || (r.detected > 0 && hadLatency
+                          && (latencyRegressed(r.p50, p50) || latencyRegressed(r.p99, p99)))
+                      || (hasChatter && exceeds(r.chatter, chatter, BENCH_CHATTER_SLACK));
+        printf("  %-8s p50 %8.3f -> %8.3f  p99 %8.3f -> %8.3f  false %u -> %u  missed %u -> %u",
+               name, p50, r.p50, p99, r.p99, falseAlarms, r.falseAlarms, missed, r.missed);
+        if (hasChatter) {
+            printf("  chatter %.1f -> %.1f", chatter, r.chatter);
+        }
+        printf("  %s\n", regressed ? "REGRESSION" : "ok");
+        if (regressed) {
+            status = 1;
+        }
+    }
+    fclose(file);
+    return status;
+}
+
+//====================================================
+// Public Interface
+//====================================================
+
+/**
+ * @brief Runs every scenario and reports, optionally against a baseline.
+ *
+ * Returns:
+ *  @return int - process exit status (0 ok, 1 regression, 2 error)
+ */
+int alarmBenchRun(const AlarmBenchOptions &options) {
+    ScenarioResult results[SCENARIO_COUNT];
+
+    printf("Alarm latency: %u trials per scenario, threshold %d ppm, latency from threshold crossing\n",
+           options.trials, PPM_THRESHOLD);
+    printf("  %-8s %6s %8s %8s %9s %9s %9s %8s %9s\n", "scenario", "trials", "detected", "missed",
+           "p50 s", "p99 s", "max s", "false", "chatter/h");
+
+    for (size_t s = 0; s < SCENARIO_COUNT; s++) {
+        const BenchScenario &scenario = scenarios[s];
+        std::vector<double> latencies;
+        ScenarioResult &r = results[s];
+        memset(&r, 0, sizeof(r));
+        unsigned long transitions = 0;
+
+        for (unsigned trial = 0; trial < options.trials; trial++) {
+            TrialResult t;
+            if (!runIsolatedTrial(scenario, options.model, trial, &t)) {
+                fprintf(stderr, "%s trial %u failed\n", scenario.name, trial);
+                return 2;
+            }
+            r.trials++;
+            r.falseAlarms += t.falseAlarms;
+            transitions += t.transitions;
+            if (t.detected) {
+                latencies.push_back(t.latency);
+            }
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        r.detected = (unsigned)latencies.size();
+        r.p50 = percentile(latencies, 0.50);
+        r.p99 = percentile(latencies, 0.99);
+        r.worst = latencies.empty() ? 0.0 : latencies.back();
+        r.missed = scenario.alarmExpected ? r.trials - r.detected : 0;
+        r.chatter = r.trials ? transitions * 3600.0 / (scenario.seconds * r.trials) : 0.0;
+        printRow(scenario.name, r);
+    }
+
+    if (!options.baselinePath) {
+        return 0;
+    }
+    if (options.updateBaseline) {
+        if (!writeBaseline(options.baselinePath, options, results)) {
+            return 2;
+        }
+        printf("\nBaseline written to %s\n", options.baselinePath);
+        return 0;
+    }
+    return checkBaseline(options.baselinePath, results);
+}
@@ -0,0 +1,23 @@
+#ifndef ALARM_BENCH_H
+#define ALARM_BENCH_H
+
+#include <stdint.h>
+
+#include "sensor_model.h"
+
+//---------------------------
+// Alarm-latency benchmark
+//---------------------------
+// Runs scripted gas scenarios through the firmware many times and
+// measures how long the warning system takes to react.
+
+struct AlarmBenchOptions {
+    SensorModelConfig model;    // seed is the base seed, offset per trial
+    unsigned trials;            // trials per scenario
+    const char *baselinePath;   // compare against this baseline (NULL: no check)
+    bool updateBaseline;        // rewrite baselinePath instead of comparing
+};
+
+int alarmBenchRun(const AlarmBenchOptions &options);
+
+#endif
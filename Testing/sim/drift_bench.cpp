@@ -0,0 +1,413 @@
+/**
+ * @file drift_bench.cpp
+ * @brief Drift-detection benchmark: R0 drift scenarios to drift_detected.
+ *
+ * Each trial powers the board up, runs setup(), lets the firmware settle
+ * until the automatic baseline has replaced the 5 minute recalibration
+ * cycle (which would otherwise absorb any drift), then replays the
+ * scenario's R0 drift and gas episodes at a random phase.
+ *
+ * Metrics per scenario:
+ *  - detection delay: from drift onset to the first drift_detected;
+ *    reported as p50 / p99 over detected trials
+ *  - corrected: drift scripted, not flagged, but absorbed by R0 anyway
+ *    (the automatic baseline): at the end of the run the firmware's R0
+ *    has followed the unit's true R0 to within DRIFT_MIN_SHIFT. Nothing
+ *    is left for the detector to find, so this is not a miss
+ *  - missed: drift scripted, never flagged and not corrected
+ *
+ * Scenarios marked followUp keep running after the detection, and it
+ * only counts when the firmware acted on it: every detection is cleared
+ * by an R0 correction within DRIFT_BENCH_ACT_S, R0 ends within
+ * DRIFT_MIN_SHIFT of the unit's true R0, and no warning_on fires on the
+ * way. Otherwise the trial is missed.
+ *  - false positives: drift_detected before the onset or in scenarios
+ *    without drift, also as a rate per drift-free hour
+ *  - magnitude error: driftMagnitude() at detection against the unit's
+ *    true R0 change, mean absolute, in percent of R0
+ *  - Kalman error: kalmanPPM() at the end of the run against the true
+ *    concentration, worst over the scenario, in percent. Only trials that
+ *    run to the end are scored (no drift, corrected, or followUp): at a
+ *    step's detection the filter is still moving it from gas to drift.
+ *    Any trial beyond DRIFT_BENCH_KALMAN_MAX_PCT fails the run, with or
+ *    without a baseline: an estimate that far off passes the alarm gate
+ *
+ * The baseline file has the alarm bench's format (scenario trials missed
+ * p50 p99 false); delays may grow by DRIFT_BENCH_DELAY_SLACK_S or
+ * DRIFT_BENCH_DELAY_SLACK_PCT, whichever is larger.
+ *
+ * Dependencies:
+ *  - simulator.h    : virtual-clock firmware runner, trial isolation
+ *  - sensor_model.h : synthetic MQ-135 with drift episodes
+ *  - drift.h        : detector state at detection
+ *  - kalman.h       : filter estimate at the end of each trial
+ *  - globals.h      : the firmware's R0
+ */
+
+#include "drift_bench.h"
+#include "drift.h"
+#include "envcomp.h"
+#include "globals.h"
+#include "kalman.h"
+#include "hal_native.h"
+#include "simulator.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static const double DRIFT_BENCH_SETTLE_S = 5400.0;      // baseline ready, periodic recalibration stopped
+static const double DRIFT_BENCH_PHASE_SPAN_S = 300.0;
+static const double DRIFT_BENCH_STEP_S = 1.0;           // detector state is sampled once per second
+static const double DRIFT_BENCH_DELAY_SLACK_S = 30.0;
+static const double DRIFT_BENCH_DELAY_SLACK_PCT = 10.0;
+static const double DRIFT_BENCH_ACT_S = 600.0;          // followUp: detection to R0 correction
+static const double DRIFT_BENCH_KALMAN_MAX_PCT = 25.0;  // |kalmanPPM() / true - 1| at the end of a trial
+
+static const uint8_t DRIFT_BENCH_MAX_GAS = 5;
+
+struct DriftScenario {
+    const char *name;
+    const char *description;
+    double seconds;                 // run length after the scenario start
+    bool hasDrift;
+    bool followUp;                  // detection must also correct R0 (see above)
+    DriftEpisode drift;             // start relative to the scenario start
+    uint8_t gasCount;
+    GasEpisode gas[DRIFT_BENCH_MAX_GAS];
+};
+
+//                                                   start  duration  change
+static const DriftScenario scenarios[] = {
+    { "ramp_up", "R0 +10 % over 2 h", 10800.0, true, false, { 0.0, 7200.0, 0.10f }, 0,
+      { { 0.0, 0.0, 0.0, 0.0, 0.0f } } },
+    { "ramp_dn", "R0 -10 % over 2 h", 10800.0, true, false, { 0.0, 7200.0, -0.10f }, 0,
+      { { 0.0, 0.0, 0.0, 0.0, 0.0f } } },
+    { "step_dn", "R0 -8 % step", 3600.0, true, false, { 0.0, 0.0, -0.08f }, 0,
+      { { 0.0, 0.0, 0.0, 0.0, 0.0f } } },
+    { "late_dn", "R0 -5 %/h for 3 h, baseline active, R0 must follow", 14400.0, true, true,
+      { 0.0, 10800.0, -0.15f }, 0,
+      { { 0.0, 0.0, 0.0, 0.0, 0.0f } } },
+    { "gas", "no drift; step, 10 min ramp, breaths", 7200.0, false, false, { 0.0, 0.0, 0.0f }, 5,
+      { { 0.0, 0.0, 180.0, 0.0, 3000.0f },
+        { 1200.0, 600.0, 120.0, 0.0, 3000.0f },
+        { 3600.0, 0.5, 0.5, 1.0, 20000.0f },
+        { 3620.0, 0.5, 0.5, 1.0, 20000.0f },
+        { 3640.0, 0.5, 0.5, 1.0, 20000.0f } } },
+    { "clean", "no drift, ambient air, 3 hours", 10800.0, false, false, { 0.0, 0.0, 0.0f }, 0,
+      { { 0.0, 0.0, 0.0, 0.0, 0.0f } } },
+};
+
+static const size_t SCENARIO_COUNT = sizeof(scenarios) / sizeof(scenarios[0]);
+
+struct TrialResult {
+    uint8_t detected;
+    double delay;
+    uint32_t falsePositives;
+    double driftFreeSeconds;
+    double magnitudeError;          // |estimated - true|, fraction of R0
+    uint8_t corrected;
+    double kalmanError;             // |kalmanPPM() / true - 1| at the end, < 0: not scored
+};
+
+struct ScenarioResult {
+    unsigned trials;
+    unsigned detected;
+    unsigned missed;
+    unsigned corrected;
+    double p50;
+    double p99;
+    double worst;
+    unsigned falsePositives;
+    double driftFreeHours;
+    double magnitudeError;          // mean over detected trials
+    double kalmanError;             // worst over the scored trials, < 0: none
+};
+
+struct TrialContext {
+    const DriftScenario *scenario;
+    const SensorModelConfig *model;
+    unsigned trial;
+};
+
+//====================================================
+// Single Trial (runs in the child process)
+//====================================================
+
+static void runTrial(const void *context, void *out) {
+    const TrialContext *c = (const TrialContext *)context;
+    const DriftScenario &scenario = *c->scenario;
+    SensorModelConfig model = *c->model;
+    model.seed = c->model->seed + c->trial;
+    std::mt19937 phaseRng(model.seed ^ 0x9E3779B9u);
+    std::uniform_real_distribution<double> phase(0.0, DRIFT_BENCH_PHASE_SPAN_S);
+
+    simBegin(NULL);
+    sensorModelInit(model);
+    halSetAnalogSource(sensorModelSample);
+    envSetSource(sensorModelEnvironment);
+    simRunSetup();
+
+    double origin = simNowMicros() / 1e6;
+    double start = origin + DRIFT_BENCH_SETTLE_S + phase(phaseRng);
+    double end = start + scenario.seconds;
+    if (scenario.hasDrift) {
+        DriftEpisode drift = scenario.drift;
+        drift.start += start;
+        sensorModelAddDrift(drift);
+    }
+    for (uint8_t i = 0; i < scenario.gasCount; i++) {
+        GasEpisode episode = scenario.gas[i];
+        episode.start += start;
+        sensorModelAddEpisode(episode);
+    }
+    double onset = scenario.hasDrift ? start + scenario.drift.start : -1.0;
+
+    TrialResult result = { 0, 0.0, 0, 0.0, 0.0, 0, 0.0 };
+    size_t seen = 0;
+    double firmwareR0Start = 0.0;
+    unsigned warnings = 0;
+    double latchedSince = -1.0;
+    bool unacted = false;
+    double t = origin;
+    while (t < end && (!result.detected || scenario.followUp)) {
+        t += DRIFT_BENCH_STEP_S;
+        simRunUntil((uint64_t)(t * 1e6));
+        if (firmwareR0Start == 0.0 && t >= start) {
+            firmwareR0Start = R0;
+        }
+        if (!driftDetected()) {
+            latchedSince = -1.0;
+        } else if (latchedSince < 0.0) {
+            latchedSince = t;
+        } else if (t - latchedSince > DRIFT_BENCH_ACT_S) {
+            unacted = true;
+        }
+        const std::vector<SimTransition> &log = simTransitions();
+        for (; seen < log.size(); seen++) {
+            if (log[seen].event == TRACE_WARNING_ON && log[seen].micros / 1e6 >= start) {
+                warnings++;
+            }
+            if (log[seen].event != TRACE_DRIFT_DETECTED) {
+                continue;
+            }
+            double when = log[seen].micros / 1e6;
+            if (onset < 0 || when < onset) {
+                result.falsePositives++;
+            } else if (!result.detected) {
+                result.detected = 1;
+                result.delay = when - onset;
+                double truth = sensorModelR0(when) / sensorModelR0(start - 1.0) - 1.0;
+                result.magnitudeError = fabs(driftMagnitude() - truth);
+            }
+        }
+    }
+    if (scenario.hasDrift && firmwareR0Start > 0.0) {
+        double followed = R0 / firmwareR0Start;
+        double truth = sensorModelR0(end) / sensorModelR0(start - 1.0);
+        bool tracked = fabs(followed / truth - 1.0) < DRIFT_MIN_SHIFT;
+        if (scenario.followUp && (!tracked || unacted || warnings > 0)) {
+            result.detected = 0;            // flagged but not acted on: missed
+        } else if (!result.detected) {
+            result.corrected = tracked;
+        }
+    }
+    result.kalmanError = t >= end ? fabs(kalmanPPM() / sensorModelTruePPM(t) - 1.0) : -1.0;
+    // Drift-free time scored for false positives: from the end of settling.
+    result.driftFreeSeconds = (onset < 0 ? end : onset) - (origin + DRIFT_BENCH_SETTLE_S);
+    *(TrialResult *)out = result;
+}
+
+//====================================================
+// Statistics / Baseline
+//====================================================
+
+static double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t rank = (size_t)ceil(p * sorted.size());
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void printRow(const char *name, const ScenarioResult &r) {
+    double rate = r.driftFreeHours > 0 ? r.falsePositives / r.driftFreeHours : 0.0;
+    if (r.detected > 0) {
+        printf("  %-8s %6u %8u %9u %6u %9.1f %9.1f %9.1f %6u %8.3f %7.2f", name, r.trials,
+               r.detected, r.corrected, r.missed, r.p50, r.p99, r.worst, r.falsePositives, rate,
+               r.magnitudeError * 100.0);
+    } else {
+        printf("  %-8s %6u %8u %9u %6u %9s %9s %9s %6u %8.3f %7s", name, r.trials, r.detected,
+               r.corrected, r.missed, "-", "-", "-", r.falsePositives, rate, "-");
+    }
+    if (r.kalmanError >= 0) {
+        printf(" %7.1f\n", r.kalmanError * 100.0);
+    } else {
+        printf(" %7s\n", "-");
+    }
+}
+
+static bool writeBaseline(const char *path, const AlarmBenchOptions &options,
+                          const ScenarioResult *results) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "%s: cannot write baseline\n", path);
+        return false;
+    }
+    fprintf(file, "# Drift-detection baseline, regenerate with: sim --drift-bench --baseline %s --update-baseline\n", path);
+    fprintf(file, "# model: r0=%.2f ambient=%.0f noise=%.2f tau=%.1f seed=%u warmup=%.1f\n",
+            options.model.r0, options.model.ambientPPM, options.model.noiseCodes,
+            options.model.tauSeconds, options.model.seed, options.model.warmupSeconds);
+    fprintf(file, "# scenario trials missed p50_s p99_s false_positives\n");
+    for (size_t s = 0; s < SCENARIO_COUNT; s++) {
+        fprintf(file, "%s %u %u %.1f %.1f %u\n", scenarios[s].name, results[s].trials,
+                results[s].missed, results[s].p50, results[s].p99, results[s].falsePositives);
+    }
+    return fclose(file) == 0;
+}
+
+static bool delayRegressed(double current, double baseline) {
+    double slack = baseline * DRIFT_BENCH_DELAY_SLACK_PCT / 100.0;
+    if (slack < DRIFT_BENCH_DELAY_SLACK_S) {
+        slack = DRIFT_BENCH_DELAY_SLACK_S;
+    }
+    return current > baseline + slack;
+}
+
+static int checkBaseline(const char *path, const ScenarioResult *results) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "%s: cannot read baseline\n", path);
+        return 2;
+    }
+    printf("\nBaseline %s:\n", path);
+    int status = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        char name[32];
+        unsigned trials, missed, falsePositives;
+        double p50, p99;
+        if (line[0] == '#' || sscanf(line, "%31s %u %u %lf %lf %u", name, &trials, &missed,
+                                     &p50, &p99, &falsePositives) != 6) {
+            continue;
+        }
+        size_t s = 0;
+        while (s < SCENARIO_COUNT && strcmp(scenarios[s].name, name) != 0) {
+            s++;
+        }
+        if (s == SCENARIO_COUNT) {
+            printf("  %-8s not in this build, ignored\n", name);
+            continue;
+        }
+        const ScenarioResult &r = results[s];
+        bool hadDelay = missed < trials && scenarios[s].hasDrift;
+        bool regressed = r.missed * trials > missed * r.trials
+                      || r.falsePositives * trials > falsePositives * r.trials
+                      || (r.detected > 0 && hadDelay
+                          && (delayRegressed(r.p50, p50) || delayRegressed(r.p99, p99)));
+        printf("  %-8s p50 %8.1f -> %8.1f  p99 %8.1f -> %8.1f  false %u -> %u  missed %u -> %u  %s\n",
+               name, p50, r.p50, p99, r.p99, falsePositives, r.falsePositives, missed, r.missed,
+               regressed ? "REGRESSION" : "ok");
+        if (regressed) {
+            status = 1;
+        }
+    }
+    fclose(file);
+    return status;
+}
+
+//====================================================
+// Public Interface
+//====================================================
+
+/**
+ * @brief Runs every drift scenario and reports, optionally against a baseline.
+ *
+ * Returns:
+ *  @return int - process exit status (0 ok, 1 regression, 2 error)
+ */
+int driftBenchRun(const AlarmBenchOptions &options) {
+    ScenarioResult results[SCENARIO_COUNT];
+
+    printf("Drift detection: %u trials per scenario, delay from drift onset, "
+           "false positives per drift-free hour, |magnitude error| in %% of R0, "
+           "worst |Kalman error| in %% of the true PPM\n", options.trials);
+    printf("  %-8s %6s %8s %9s %6s %9s %9s %9s %6s %8s %7s %7s\n", "scenario", "trials", "detected",
+           "corrected", "missed", "p50 s", "p99 s", "max s", "false", "false/h", "mag %", "kal %");
+
+    unsigned totalFalse = 0;
+    double totalHours = 0.0;
+    for (size_t s = 0; s < SCENARIO_COUNT; s++) {
+        const DriftScenario &scenario = scenarios[s];
+        std::vector<double> delays;
+        ScenarioResult &r = results[s];
+        memset(&r, 0, sizeof(r));
+        r.kalmanError = -1.0;
+
+        for (unsigned trial = 0; trial < options.trials; trial++) {
+            TrialContext context = { &scenario, &options.model, trial };
+            TrialResult t;
+            if (!simRunIsolated(runTrial, &context, &t, sizeof(t))) {
+                fprintf(stderr, "%s trial %u failed\n", scenario.name, trial);
+                return 2;
+            }
+            r.trials++;
+            r.falsePositives += t.falsePositives;
+            r.driftFreeHours += t.driftFreeSeconds / 3600.0;
+            r.corrected += t.corrected;
+            if (t.kalmanError > r.kalmanError) {
+                r.kalmanError = t.kalmanError;
+            }
+            if (t.detected) {
+                delays.push_back(t.delay);
+                r.magnitudeError += t.magnitudeError;
+            }
+        }
+
+        std::sort(delays.begin(), delays.end());
+        r.detected = (unsigned)delays.size();
+        r.p50 = percentile(delays, 0.50);
+        r.p99 = percentile(delays, 0.99);
+        r.worst = delays.empty() ? 0.0 : delays.back();
+        r.missed = scenario.hasDrift ? r.trials - r.detected - r.corrected : 0;
+        r.magnitudeError = r.detected > 0 ? r.magnitudeError / r.detected : 0.0;
+        totalFalse += r.falsePositives;
+        totalHours += r.driftFreeHours;
+        printRow(scenario.name, r);
+    }
+    printf("  false-positive rate %.4f per hour (%u in %.1f drift-free hours)\n",
+           totalHours > 0 ? totalFalse / totalHours : 0.0, totalFalse, totalHours);
+
+    int status = 0;
+#if KALMAN_FILTER
+    double kalmanWorst = 0.0;
+    for (size_t s = 0; s < SCENARIO_COUNT; s++) {
+        if (results[s].kalmanError > kalmanWorst) {
+            kalmanWorst = results[s].kalmanError;
+        }
+    }
+    bool kalmanOk = kalmanWorst * 100.0 <= DRIFT_BENCH_KALMAN_MAX_PCT;
+    printf("  Kalman estimate worst %.1f %% off (limit %.0f %%)  %s\n", kalmanWorst * 100.0,
+           DRIFT_BENCH_KALMAN_MAX_PCT, kalmanOk ? "ok" : "FAIL");
+    if (!kalmanOk) {
+        status = 1;
+    }
+#endif
+
+    if (!options.baselinePath) {
+        return status;
+    }
+    if (options.updateBaseline) {
+        if (!writeBaseline(options.baselinePath, options, results)) {
+            return 2;
+        }
+        printf("\nBaseline written to %s\n", options.baselinePath);
+        return status;
+    }
+    int baselineStatus = checkBaseline(options.baselinePath, results);
+    return baselineStatus != 0 ? baselineStatus : status;
+}
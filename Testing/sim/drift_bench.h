@@ -0,0 +1,18 @@
+#ifndef DRIFT_BENCH_H
+#define DRIFT_BENCH_H
+
+#include "alarm_bench.h"
+
+//---------------------------
+// Drift-detection benchmark
+//---------------------------
+// Runs scripted R0 drift (and drift-free gas) scenarios through the
+// firmware and measures how long the drift detector takes to flag drift
+// and how often it flags drift that is not there. Takes the same options
+// as the alarm-latency benchmark.
+
+const unsigned DRIFT_BENCH_TRIALS = 20;     // default trials per scenario
+
+int driftBenchRun(const AlarmBenchOptions &options);
+
+#endif
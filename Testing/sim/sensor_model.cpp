@@ -0,0 +1,164 @@
+/**
+ * @file sensor_model.cpp
+ * @brief Synthetic MQ-135 analog output for the simulator.
+ *
+ * The true concentration is the ambient level plus any scripted gas
+ * episodes. It passes through a first-order lag (the sensor's response
+ * time) and is turned into an ADC code by inverting the firmware curve:
+ *
+ *    Rs/R0 = k * (PPM/400)^(-1/n),  V = Vcc * RL / (Rs + RL)
+ *
+ * with the simulated unit's own R0 (optionally drifting linearly, plus
+ * scripted drift steps and ramps) and optional Gaussian noise. A cold unit starts at SENSOR_MODEL_COLD_RS of
+ * its warm Rs and approaches it exponentially with the warm-up time
+ * constant, counted from virtual time 0 (power-on). Rs also follows the
+ * air temperature and humidity through the firmware's own correction
+ * factor, and sensorModelEnvironment() is the matching temperature/RH
+ * sensor for the firmware's compensation stage.
+ *
+ * Dependencies:
+ *  - globals.h : RL (and curve.h: FactoryCurve, the simulated unit's truth)
+ *  - envcomp.h : envCorrectionFactor()
+ */
+
+#include "sensor_model.h"
+#include "globals.h"
+#include "envcomp.h"
+
+#include <math.h>
+#include <random>
+#include <vector>
+
+static SensorModelConfig config;
+static std::vector<GasEpisode> episodes;
+static std::vector<DriftEpisode> drifts;
+static std::mt19937 rng;
+static std::normal_distribution<float> noise(0.0f, 1.0f);
+
+static double lastSeconds = -1.0;
+static double laggedPPM = 0.0;
+
+void sensorModelInit(const SensorModelConfig &c) {
+    config = c;
+    episodes.clear();
+    drifts.clear();
+    rng.seed(config.seed);
+    lastSeconds = -1.0;
+    laggedPPM = config.ambientPPM;
+}
+
+void sensorModelAddEpisode(const GasEpisode &episode) {
+    episodes.push_back(episode);
+}
+
+void sensorModelAddDrift(const DriftEpisode &drift) {
+    drifts.push_back(drift);
+}
+
+/**
+ * @brief The unit's warm R0 at reference conditions at a point in virtual time.
+ *
+ * Linear drift and drift episodes multiply; an episode holds its full
+ * change once it is over.
+ */
+double sensorModelR0(double seconds) {
+    double r0 = config.r0 * (1.0 + config.driftPerHour * seconds / 3600.0);
+    for (size_t i = 0; i < drifts.size(); i++) {
+        const DriftEpisode &d = drifts[i];
+        double t = seconds - d.start;
+        if (t < 0) {
+            continue;
+        }
+        double level = (d.duration > 0 && t < d.duration) ? t / d.duration : 1.0;
+        r0 *= 1.0 + d.change * level;
+    }
+    return r0;
+}
+
+/**
+ * @brief True concentration at a point in virtual time.
+ *
+ * Overlapping episodes add on top of the ambient level.
+ */
+float sensorModelTruePPM(double seconds) {
+    double ppm = config.ambientPPM;
+    for (size_t i = 0; i < episodes.size(); i++) {
+        const GasEpisode &e = episodes[i];
+        double t = seconds - e.start;
+        double level;
+        if (t < 0) {
+            continue;
+        } else if (t < e.rise) {
+            level = t / e.rise;
+        } else if (t < e.rise + e.hold) {
+            level = 1.0;
+        } else if (t < e.rise + e.hold + e.fall) {
+            level = 1.0 - (t - e.rise - e.hold) / e.fall;
+        } else {
+            continue;
+        }
+        ppm += (e.ppm - config.ambientPPM) * level;
+    }
+    return (float)ppm;
+}
+
+static double analogLevel(double ppm, double r0) {
+    double ratio = FactoryCurve::cleanAirRatio() * pow(ppm / 400.0, -1.0 / FactoryCurve::exponent());
+    double rs = ratio * r0;
+    return 1023.0 * RL / (rs + RL);
+}
+
+static uint16_t clampCode(double code) {
+    return (uint16_t)lround(code < 0 ? 0 : (code > 1023 ? 1023 : code));
+}
+
+static void environmentAt(double seconds, float *temperature, float *humidity) {
+    *temperature = config.temperature
+                 + config.temperatureSwing * (float)sin(2 * M_PI * seconds / 86400.0);
+    *humidity = config.humidity;
+}
+
+/**
+ * @brief EnvSource: the simulated temperature/RH sensor, at the last sample time.
+ */
+bool sensorModelEnvironment(float *temperature, float *humidity) {
+    environmentAt(lastSeconds < 0 ? 0 : lastSeconds, temperature, humidity);
+    return true;
+}
+
+/**
+ * @brief Noise-free ADC code of a unit with baseline r0 exposed to ppm.
+ */
+uint16_t sensorModelCodeFor(float ppm, float r0) {
+    return clampCode(analogLevel(ppm, r0));
+}
+
+/**
+ * @brief HalAnalogSource: the sensor's output at the given time.
+ */
+uint16_t sensorModelSample(uint8_t pin, uint64_t nowMicros) {
+    (void)pin;
+    double seconds = nowMicros / 1e6;
+    double target = sensorModelTruePPM(seconds);
+
+    if (lastSeconds < 0 || config.tauSeconds <= 0) {
+        laggedPPM = target;
+    } else if (seconds > lastSeconds) {
+        double alpha = 1.0 - exp(-(seconds - lastSeconds) / config.tauSeconds);
+        laggedPPM += (target - laggedPPM) * alpha;
+    }
+    lastSeconds = seconds;
+
+    double r0 = sensorModelR0(seconds);
+    float temperature, humidity;
+    environmentAt(seconds, &temperature, &humidity);
+    r0 *= envCorrectionFactor(temperature, humidity);
+    if (config.warmupSeconds > 0) {
+        r0 *= 1.0 - (1.0 - SENSOR_MODEL_COLD_RS) * exp(-seconds / config.warmupSeconds);
+    }
+    double code = analogLevel(laggedPPM, r0);
+    if (config.noiseCodes > 0) {
+        code += noise(rng) * config.noiseCodes;
+    }
+    return clampCode(code);
+}
@@ -0,0 +1,52 @@
+#ifndef SENSOR_MODEL_H
+#define SENSOR_MODEL_H
+
+#include <stdint.h>
+
+//---------------------------
+// Synthetic MQ-135
+//---------------------------
+// Generates the analog output the firmware would see for a scripted CO2
+// concentration, using the firmware's own curve constants inverted.
+
+struct SensorModelConfig {
+    float r0;               // true clean-air baseline of the simulated unit (kOhm)
+    float ambientPPM;       // background concentration
+    float noiseCodes;       // Gaussian ADC noise, standard deviation in codes
+    float tauSeconds;       // first-order sensor response time constant
+    uint32_t seed;          // noise generator seed
+    float driftPerHour;     // R0 drift, fraction of r0 per hour (0.05 = +5 %/h)
+    float warmupSeconds;    // heater time constant from power-on (0 = already warm)
+    float temperature;      // mean air temperature (degC)
+    float humidity;         // relative humidity (%)
+    float temperatureSwing; // daily temperature amplitude (degC, sinusoid, 24 h period)
+};
+
+const float SENSOR_MODEL_COLD_RS = 0.4f;   // Rs of a cold unit, fraction of its warm Rs
+
+// Trapezoidal gas episode: ramps up over rise, holds, ramps down over fall.
+struct GasEpisode {
+    double start;           // seconds of virtual time
+    double rise;
+    double hold;
+    double fall;
+    float ppm;              // peak concentration
+};
+
+// R0 shift: change (fraction of r0) reached linearly over duration (0 = step).
+struct DriftEpisode {
+    double start;           // seconds of virtual time
+    double duration;
+    float change;           // -0.08 = R0 8 % low after the episode
+};
+
+void sensorModelInit(const SensorModelConfig &config);
+void sensorModelAddEpisode(const GasEpisode &episode);
+void sensorModelAddDrift(const DriftEpisode &drift);
+float sensorModelTruePPM(double seconds);
+double sensorModelR0(double seconds);
+uint16_t sensorModelCodeFor(float ppm, float r0);
+uint16_t sensorModelSample(uint8_t pin, uint64_t nowMicros);
+bool sensorModelEnvironment(float *temperature, float *humidity);
+
+#endif
@@ -0,0 +1,472 @@
+/**
+ * @file sim_main.cpp
+ * @brief Command-line front end for the fixed-step firmware simulator.
+ *
+ * Runs the complete firmware (setup() and loop()) on the virtual clock
+ * against a synthetic MQ-135 and reports, in virtual time, when every
+ * traced state transition happened and how long it took to get there.
+ *
+ * Usage:
+ *   sim [options]
+ *
+ *   --hours H         virtual run length after setup (default 24)
+ *   --r0 KOHM         true R0 of the simulated sensor (default 76.63)
+ *   --ambient PPM     background concentration (default 420)
+ *   --noise CODES     ADC noise standard deviation (default 0.5)
+ *   --tau S           sensor response time constant (default 20)
+ *   --seed N          noise seed (default 1)
+ *   --drift PCT       sensor R0 drift in percent per hour (default 0)
+ *   --warmup S        heater warm-up time constant from power-on (default 6;
+ *                     0 when --reset is not "power": the unit is still warm)
+ *   --env T:RH[:SWING] air temperature (degC), humidity (%) and daily
+ *                     temperature swing seen by the sensor and by the
+ *                     firmware's compensation input (default 20:33:0)
+ *   --env-fixed       keep the firmware on its fixed reference conditions
+ *                     (no compensation of the simulated environment)
+ *   --gas T:PPM:HOLD[:RISE[:FALL]]
+ *                     add a gas episode starting T seconds after setup
+ *   --shift T:PCT[:RAMP]
+ *                     shift the sensor's R0 by PCT percent, starting T
+ *                     seconds after setup, over RAMP seconds (default 0: step)
+ *   --trace FILE      replay a recorded .mqtr ADC trace instead of the
+ *                     synthetic sensor (--r0/--ambient/--noise/--tau/--gas
+ *                     are then ignored)
+ *   --trace-offset S  start the replay S seconds into the trace
+ *   --eeprom FILE     load the board's EEPROM from FILE (if it exists)
+ *                     before setup() and save it back after the run
+ *   --reset CAUSE     reset cause seen by the firmware: power (default),
+ *                     brownout, watchdog, external or none (no flags, as
+ *                     after a bootloader that cleared MCUSR)
+ *   --serial          echo firmware serial output to stdout
+ *   --quiet           summary only, no per-transition lines
+ *
+ * Trace tools (write a trace and exit, the firmware is not run):
+ *   --record FILE     sample the synthetic sensor for --hours into FILE;
+ *                     gas and shift times are relative to the trace start
+ *   --record-rate HZ  sample rate for --record (default 50)
+ *   --convert-log IN OUT
+ *                     convert a debugSensor() serial log ("ADC: n | D0: n")
+ *   --log-rate HZ     line rate of the serial log (default 1)
+ *
+ * Alarm-latency benchmark (see alarm_bench.cpp; model options apply):
+ *   --bench           run the step / ramp / breath / clean / plateau / hover
+ *                     scenarios
+ *   --trials N        trials per scenario (default 50)
+ *   --baseline FILE   compare against FILE, exit 1 on regression
+ *   --update-baseline rewrite FILE with the current results
+ *
+ * Drift-detection benchmark (see drift_bench.cpp; same options):
+ *   --drift-bench     run the ramp / step / gas / clean drift scenarios
+ *                     (default 20 trials per scenario)
+ */
+
+#include <Arduino.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "adc_trace.h"
+#include "alarm_bench.h"
+#include "drift_bench.h"
+#include "globals.h"
+#include "hal_native.h"
+#include "sensor_model.h"
+#include "simulator.h"
+#include "trace.h"
+#include "warmup.h"
+#include "envcomp.h"
+#include "config.h"
+#include "kalman.h"
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [--hours H] [--r0 KOHM] [--ambient PPM] [--noise CODES]\n"
+            "          [--tau S] [--seed N] [--drift PCT] [--warmup S] [--env T:RH[:SWING] [--env-fixed]]\n"
+            "          [--gas T:PPM:HOLD[:RISE[:FALL]]]... [--shift T:PCT[:RAMP]]...\n"
+            "          [--trace FILE [--trace-offset S]] [--eeprom FILE] [--reset CAUSE]\n"
+            "          [--serial] [--quiet]\n"
+            "       %s --record FILE [--record-rate HZ] [model options] [--hours H]\n"
+            "       %s --convert-log IN OUT [--log-rate HZ]\n"
+            "       %s --bench|--drift-bench [--trials N] [--baseline FILE [--update-baseline]] [model options]\n",
+            program, program, program, program);
+    exit(2);
+}
+
+static bool parseEpisode(const char *text, GasEpisode *episode) {
+    double fields[5] = { 0, 0, 0, 0, 0 };
+    int count = 0;
+    const char *p = text;
+    while (count < 5) {
+        char *end;
+        fields[count++] = strtod(p, &end);
+        if (end == p) return false;
+        if (*end == '\0') break;
+        if (*end != ':') return false;
+        p = end + 1;
+    }
+    if (count < 3) return false;
+    episode->start = fields[0];
+    episode->ppm = (float)fields[1];
+    episode->hold = fields[2];
+    episode->rise = fields[3];
+    episode->fall = fields[4];
+    return true;
+}
+
+/**
+ * @brief Parses T:PCT[:RAMP] into an R0 drift episode.
+ */
+static bool parseShift(const char *text, DriftEpisode *drift) {
+    double ramp = 0;
+    double percent = 0;
+    if (sscanf(text, "%lf:%lf:%lf", &drift->start, &percent, &ramp) < 2 || ramp < 0) {
+        return false;
+    }
+    drift->duration = ramp;
+    drift->change = (float)(percent / 100.0);
+    return true;
+}
+
+/**
+ * @brief Samples the synthetic sensor at a fixed rate into a trace file.
+ */
+static int recordTrace(const char *path, double rateHz, double seconds, const SensorModelConfig &model,
+                       const std::vector<GasEpisode> &gas, const std::vector<DriftEpisode> &shifts) {
+    sensorModelInit(model);
+    for (size_t i = 0; i < gas.size(); i++) {
+        sensorModelAddEpisode(gas[i]);
+    }
+    for (size_t i = 0; i < shifts.size(); i++) {
+        sensorModelAddDrift(shifts[i]);
+    }
+    AdcTraceWriter writer;
+    if (!adcTraceCreate(&writer, path, rateHz, model.r0, A0, CO2_digital_pin)) {
+        fprintf(stderr, "%s: cannot create\n", path);
+        return 1;
+    }
+    uint32_t count = (uint32_t)(seconds * rateHz);
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t now = (uint64_t)(i * 1e6 / rateHz);
+        adcTraceAppend(&writer, sensorModelSample(A0, now), 0);
+    }
+    uint32_t bytes = writer.header.payloadBytes;
+    if (!adcTraceClose(&writer)) {
+        fprintf(stderr, "%s: write failed\n", path);
+        return 1;
+    }
+    printf("%s: %u samples at %.3f Hz, %u payload bytes (%.2f bytes/sample)\n",
+           path, count, rateHz, bytes, count ? (double)bytes / count : 0.0);
+    return 0;
+}
+
+/**
+ * @brief Converts a debugSensor() serial capture into a trace file.
+ *
+ * Lines without an "ADC:" field (prompts, calibration progress) are skipped.
+ */
+static int convertLog(const char *in, const char *out, double rateHz) {
+    FILE *log = fopen(in, "r");
+    if (!log) {
+        fprintf(stderr, "%s: cannot open\n", in);
+        return 1;
+    }
+    AdcTraceWriter writer;
+    if (!adcTraceCreate(&writer, out, rateHz, 0.0f, A0, CO2_digital_pin)) {
+        fprintf(stderr, "%s: cannot create\n", out);
+        fclose(log);
+        return 1;
+    }
+    char line[256];
+    float r0 = 0.0f;
+    while (fgets(line, sizeof(line), log)) {
+        const char *field = strstr(line, "ADC:");
+        unsigned code, d0;
+        if (!field || sscanf(field, "ADC: %u | D0: %u", &code, &d0) != 2) {
+            continue;
+        }
+        const char *r0Field = strstr(line, "R0:");
+        if (r0Field) {
+            sscanf(r0Field, "R0: %f", &r0);
+        }
+        adcTraceAppend(&writer, (uint16_t)code, (uint8_t)d0);
+    }
+    fclose(log);
+    writer.header.r0AtCapture = r0;     // last R0 the firmware reported
+    uint32_t count = writer.header.sampleCount;
+    if (!adcTraceClose(&writer)) {
+        fprintf(stderr, "%s: write failed\n", out);
+        return 1;
+    }
+    printf("%s: %u samples, R0 at capture %.2f kOhm\n", out, count, r0);
+    return 0;
+}
+
+static bool parseResetCause(const char *text, uint8_t *flags) {
+    static const char *const names[] = { "power", "external", "brownout", "watchdog" };
+    if (strcmp(text, "none") == 0) {
+        *flags = 0;         // MCUSR already cleared by a bootloader
+        return true;
+    }
+    for (uint8_t bit = PORF; bit <= WDRF; bit++) {
+        if (strcmp(text, names[bit]) == 0) {
+            *flags = 1 << bit;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void loadEeprom(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return;     // first run: the EEPROM stays erased
+    }
+    if (fread(halEeprom(), 1, HAL_EEPROM_SIZE, file) != HAL_EEPROM_SIZE) {
+        fprintf(stderr, "%s: short EEPROM image, ignored\n", path);
+        memset(halEeprom(), 0xFF, HAL_EEPROM_SIZE);
+    }
+    fclose(file);
+}
+
+static void saveEeprom(const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (!file || fwrite(halEeprom(), 1, HAL_EEPROM_SIZE, file) != HAL_EEPROM_SIZE) {
+        fprintf(stderr, "%s: cannot write EEPROM image\n", path);
+    }
+    if (file) {
+        fclose(file);
+    }
+}
+
+static uint64_t firstEvent(TraceEvent event) {
+    const std::vector<SimTransition> &log = simTransitions();
+    for (size_t i = 0; i < log.size(); i++) {
+        if (log[i].event == event) return log[i].micros;
+    }
+    return UINT64_MAX;
+}
+
+static void printSpan(const char *label, TraceEvent from, TraceEvent to) {
+    uint64_t a = firstEvent(from);
+    uint64_t b = firstEvent(to);
+    if (a == UINT64_MAX || b == UINT64_MAX || b < a) {
+        printf("  %-28s n/a\n", label);
+    } else {
+        printf("  %-28s %10.3f s\n", label, (b - a) / 1e6);
+    }
+}
+
+int main(int argc, char **argv) {
+    SensorModelConfig model = { 76.63f, 420.0f, 0.5f, 20.0f, 1, 0.0f, 6.0f, 20.0f, 33.0f, 0.0f };
+    bool envFixed = false;
+    bool warmupGiven = false;
+    std::vector<GasEpisode> gas;
+    std::vector<DriftEpisode> shifts;
+    double hours = 24.0;
+    bool echoSerial = false;
+    bool quiet = false;
+    const char *tracePath = NULL;
+    double traceOffset = 0.0;
+    const char *recordPath = NULL;
+    double recordRate = 50.0;
+    const char *logIn = NULL;
+    const char *logOut = NULL;
+    double logRate = 1.0;
+    bool bench = false;
+    bool driftBench = false;
+    bool trialsGiven = false;
+    const char *eepromPath = NULL;
+    uint8_t resetFlags = 1 << PORF;
+    AlarmBenchOptions benchOptions = { model, 50, NULL, false };
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--serial") == 0) { echoSerial = true; continue; }
+        if (strcmp(arg, "--quiet") == 0)  { quiet = true; continue; }
+        if (strcmp(arg, "--bench") == 0)  { bench = true; continue; }
+        if (strcmp(arg, "--drift-bench") == 0) { driftBench = true; continue; }
+        if (strcmp(arg, "--env-fixed") == 0) { envFixed = true; continue; }
+        if (strcmp(arg, "--update-baseline") == 0) { benchOptions.updateBaseline = true; continue; }
+        if (i + 1 >= argc) usage(argv[0]);
+        const char *value = argv[++i];
+        if (strcmp(arg, "--convert-log") == 0) {
+            if (i + 1 >= argc) usage(argv[0]);
+            logIn = value;
+            logOut = argv[++i];
+            continue;
+        }
+        if (strcmp(arg, "--hours") == 0)        hours = atof(value);
+        else if (strcmp(arg, "--r0") == 0)      model.r0 = (float)atof(value);
+        else if (strcmp(arg, "--ambient") == 0) model.ambientPPM = (float)atof(value);
+        else if (strcmp(arg, "--noise") == 0)   model.noiseCodes = (float)atof(value);
+        else if (strcmp(arg, "--tau") == 0)     model.tauSeconds = (float)atof(value);
+        else if (strcmp(arg, "--seed") == 0)    model.seed = (uint32_t)strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--drift") == 0)   model.driftPerHour = (float)(atof(value) / 100.0);
+        else if (strcmp(arg, "--warmup") == 0)  { model.warmupSeconds = (float)atof(value); warmupGiven = true; }
+        else if (strcmp(arg, "--trace") == 0)        tracePath = value;
+        else if (strcmp(arg, "--trace-offset") == 0) traceOffset = atof(value);
+        else if (strcmp(arg, "--record") == 0)       recordPath = value;
+        else if (strcmp(arg, "--record-rate") == 0)  recordRate = atof(value);
+        else if (strcmp(arg, "--log-rate") == 0)     logRate = atof(value);
+        else if (strcmp(arg, "--trials") == 0)       { benchOptions.trials = (unsigned)strtoul(value, NULL, 10); trialsGiven = true; }
+        else if (strcmp(arg, "--baseline") == 0)     benchOptions.baselinePath = value;
+        else if (strcmp(arg, "--eeprom") == 0)       eepromPath = value;
+        else if (strcmp(arg, "--reset") == 0) {
+            if (!parseResetCause(value, &resetFlags)) usage(argv[0]);
+        }
+        else if (strcmp(arg, "--env") == 0) {
+            if (sscanf(value, "%f:%f:%f", &model.temperature, &model.humidity, &model.temperatureSwing) < 2) {
+                usage(argv[0]);
+            }
+        }
+        else if (strcmp(arg, "--gas") == 0) {
+            GasEpisode episode;
+            if (!parseEpisode(value, &episode)) usage(argv[0]);
+            gas.push_back(episode);
+        }
+        else if (strcmp(arg, "--shift") == 0) {
+            DriftEpisode shift;
+            if (!parseShift(value, &shift)) usage(argv[0]);
+            shifts.push_back(shift);
+        }
+        else usage(argv[0]);
+    }
+
+    if (!warmupGiven && resetFlags != (1 << PORF)) {
+        model.warmupSeconds = 0;
+    }
+
+    if (bench) {
+        benchOptions.model = model;
+        return alarmBenchRun(benchOptions);
+    }
+    if (driftBench) {
+        benchOptions.model = model;
+        if (!trialsGiven) {
+            benchOptions.trials = DRIFT_BENCH_TRIALS;
+        }
+        return driftBenchRun(benchOptions);
+    }
+    if (logIn) {
+        return convertLog(logIn, logOut, logRate);
+    }
+    if (recordPath) {
+        return recordTrace(recordPath, recordRate, hours * 3600.0, model, gas, shifts);
+    }
+
+    AdcTraceReader trace;
+    if (tracePath) {
+        if (!adcTraceOpen(&trace, tracePath)) {
+            return 1;
+        }
+        printf("Replaying %s: %u samples at %.3f Hz (%.1f s), R0 at capture %.2f kOhm\n",
+               tracePath, trace.header->sampleCount, adcTraceSampleRate(&trace),
+               adcTraceDuration(&trace), trace.header->r0AtCapture);
+        gas.clear();
+        shifts.clear();
+    }
+
+    std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+
+    simBegin(echoSerial ? stdout : NULL);
+    halSetResetFlags(resetFlags);
+    if (eepromPath) {
+        loadEeprom(eepromPath);
+    }
+    if (tracePath) {
+        adcTraceReplayBegin(&trace, traceOffset);
+        halSetAnalogSource(adcTraceReplayAnalog);
+        halSetDigitalSource(adcTraceReplayDigital);
+    } else {
+        sensorModelInit(model);
+        halSetAnalogSource(sensorModelSample);
+        envSetSource(envFixed ? envFixedSource : sensorModelEnvironment);
+    }
+    simRunSetup();
+
+    // Gas episode times are relative to the end of setup().
+    uint64_t origin = simNowMicros();
+    for (size_t i = 0; i < gas.size(); i++) {
+        gas[i].start += origin / 1e6;
+        sensorModelAddEpisode(gas[i]);
+    }
+    for (size_t i = 0; i < shifts.size(); i++) {
+        shifts[i].start += origin / 1e6;
+        sensorModelAddDrift(shifts[i]);
+    }
+    simRunUntil(origin + (uint64_t)(hours * 3600e6));
+
+    if (eepromPath) {
+        saveEeprom(eepromPath);
+    }
+
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    double virtualSeconds = simNowMicros() / 1e6;
+
+    const std::vector<SimTransition> &log = simTransitions();
+    if (!quiet) {
+        printf("%-16s %12s  %-18s %s\n", "virtual time", "since prev", "transition", "latency");
+        uint64_t previous = 0;
+        for (size_t i = 0; i < log.size(); i++) {
+            char when[32];
+            simFormatTime(log[i].micros, when, sizeof(when));
+            printf("%-16s %11.3fs  %-18s", when, (log[i].micros - previous) / 1e6, simEventName(log[i].event));
+            previous = log[i].micros;
+
+            // Alarm transitions: latency from the gas episode that caused them.
+            double now = log[i].micros / 1e6;
+            for (size_t g = gas.size(); g-- > 0;) {
+                double end = gas[g].start + gas[g].rise + gas[g].hold + gas[g].fall;
+                if (log[i].event == TRACE_WARNING_ON && now >= gas[g].start) {
+                    printf(" %.3f s after gas episode %zu start", now - gas[g].start, g + 1);
+                    break;
+                }
+                if (log[i].event == TRACE_WARNING_OFF && now >= end) {
+                    printf(" %.3f s after gas episode %zu end", now - end, g + 1);
+                    break;
+                }
+            }
+            printf("\n");
+        }
+        printf("\n");
+    }
+
+    if (!tracePath) {
+        printf("Final R0: firmware %.2f kOhm, simulated unit %.2f kOhm\n",
+               R0, sensorModelR0(virtualSeconds));
+#if KALMAN_FILTER
+        printf("Final Kalman estimate: %.0f ppm (true %.0f), drift %+.2f %% (true %+.2f %% of firmware R0)\n",
+               kalmanPPM(), sensorModelTruePPM(virtualSeconds), kalmanDrift() * 100.0,
+               (sensorModelR0(virtualSeconds) / R0 - 1.0) * 100.0);
+#endif
+    }
+    printf("Startup latency (virtual time):\n");
+    printSpan("preheat", TRACE_PREHEAT_START, TRACE_PREHEAT_DONE);
+    uint64_t preheatStart = firstEvent(TRACE_PREHEAT_START);
+    uint64_t preheatDone = firstEvent(TRACE_PREHEAT_DONE);
+    if (preheatStart != UINT64_MAX && preheatDone != UINT64_MAX) {
+        printf("  %-28s %+10.3f s\n", "preheat vs fixed 20 s wait",
+               (preheatDone - preheatStart) / 1e6 - PREHEAT_FIXED_MS / 1e3);
+    }
+    printSpan("calibration", TRACE_CALIBRATION_START, TRACE_CALIBRATION_DONE);
+    printf("  %-28s %10.3f s\n", "power-on to system ready", firstEvent(TRACE_SYSTEM_READY) / 1e6);
+
+    unsigned counts[TRACE_EVENT_COUNT] = { 0 };
+    for (size_t i = 0; i < log.size(); i++) {
+        if (log[i].event < TRACE_EVENT_COUNT) counts[log[i].event]++;
+    }
+    printf("Transition counts:\n");
+    for (uint8_t e = 0; e < TRACE_EVENT_COUNT; e++) {
+        printf("  %-28s %10u\n", simEventName(e), counts[e]);
+    }
+    printf("Simulated %.1f s (%.2f h) in %.2f s wall time, %.0fx real time, %llu loop passes\n",
+           virtualSeconds, virtualSeconds / 3600.0, wallSeconds,
+           wallSeconds > 0 ? virtualSeconds / wallSeconds : 0.0,
+           (unsigned long long)simLoopPasses());
+    if (tracePath) {
+        adcTraceCloseReader(&trace);
+    }
+    return 0;
+}
@@ -0,0 +1,154 @@
+/**
+ * @file simulator.cpp
+ * @brief Fixed-step, faster-than-real-time runner for the unmodified firmware.
+ *
+ * Drives setup()/loop() on the native HAL's virtual clock:
+ *
+ *  - delay() jumps the clock forward instantly (hal_native.cpp)
+ *  - After each loop() pass the clock jumps to the next millisecond
+ *    boundary. Every deadline in the firmware is a millis() comparison,
+ *    so no deadline can fall between two boundaries and nothing is
+ *    skipped; an idle pass costs one call instead of a millisecond
+ *  - traceEvent() calls are recorded with their virtual timestamps
+ *
+ * A simulated day is ~86 million loop passes and runs in seconds.
+ *
+ * Trial isolation (benchmarks): the firmware keeps its state in globals
+ * and function-local statics, so simRunIsolated() runs each trial in a
+ * fork()ed child of the untouched parent -- the host equivalent of a
+ * power cycle. Results come back over a pipe.
+ *
+ * Dependencies:
+ *  - hal_native.h : virtual clock and trace hook
+ *  - trace.h      : event identifiers
+ *  - POSIX fork/pipe (simRunIsolated() only)
+ */
+
+#include "simulator.h"
+#include "hal_native.h"
+#include "trace.h"
+
+#include <Arduino.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static std::vector<SimTransition> transitions;
+static uint64_t loopPasses = 0;
+
+static void recordTransition(uint8_t event, uint64_t nowMicros) {
+    SimTransition t = { event, nowMicros };
+    transitions.push_back(t);
+}
+
+/**
+ * @brief Resets the board onto the virtual clock and starts recording.
+ *
+ * Parameters:
+ *  @param serialSink Where firmware serial output goes (NULL discards it)
+ */
+void simBegin(FILE *serialSink) {
+    halReset();
+    halUseVirtualClock(true);
+    halSetSerialOutput(serialSink);
+    halSetTraceHandler(recordTransition);
+    transitions.clear();
+    loopPasses = 0;
+}
+
+void simRunSetup() {
+    setup();
+}
+
+/**
+ * @brief Runs loop() until the virtual clock reaches endMicros.
+ */
+void simRunUntil(uint64_t endMicros) {
+    while (halNowMicros() < endMicros) {
+        loop();
+        loopPasses++;
+        uint64_t now = halNowMicros();
+        uint64_t next = (now / 1000 + 1) * 1000;
+        halAdvanceMicros(next - now);
+    }
+}
+
+uint64_t simNowMicros() {
+    return halNowMicros();
+}
+
+uint64_t simLoopPasses() {
+    return loopPasses;
+}
+
+/**
+ * @brief Runs one trial in a child process so it starts from power-on state.
+ *
+ * Returns:
+ *  @return true if the child ran to completion and delivered its result
+ */
+bool simRunIsolated(SimTrial trial, const void *context, void *result, size_t size) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        trial(context, result);
+        ssize_t written = write(fds[1], result, size);
+        _exit(written == (ssize_t)size ? 0 : 1);
+    }
+
+    close(fds[1]);
+    ssize_t got = read(fds[0], result, size);
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return got == (ssize_t)size && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+const std::vector<SimTransition> &simTransitions() {
+    return transitions;
+}
+
+const char *simEventName(uint8_t event) {
+    static const char *const names[TRACE_EVENT_COUNT] = {
+        "preheat_start",
+        "preheat_done",
+        "calibration_start",
+        "calibration_done",
+        "calibration_aborted",
+        "system_ready",
+        "recalibration_due",
+        "warning_on",
+        "warning_off",
+        "r0_reestimated",
+        "calibration_restored",
+        "drift_detected",
+        "servo_in_position",
+    };
+    return event < TRACE_EVENT_COUNT ? names[event] : "unknown";
+}
+
+/**
+ * @brief Formats virtual time as [D+]HH:MM:SS.mmm.
+ */
+void simFormatTime(uint64_t micros, char *buf, size_t size) {
+    uint64_t ms = micros / 1000;
+    unsigned days = (unsigned)(ms / 86400000ULL);
+    unsigned hours = (unsigned)(ms / 3600000ULL % 24);
+    unsigned minutes = (unsigned)(ms / 60000ULL % 60);
+    unsigned seconds = (unsigned)(ms / 1000ULL % 60);
+    unsigned millisPart = (unsigned)(ms % 1000);
+    if (days > 0) {
+        snprintf(buf, size, "%u+%02u:%02u:%02u.%03u", days, hours, minutes, seconds, millisPart);
+    } else {
+        snprintf(buf, size, "%02u:%02u:%02u.%03u", hours, minutes, seconds, millisPart);
+    }
+}
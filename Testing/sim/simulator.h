@@ -0,0 +1,32 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+//---------------------------
+// Fixed-step firmware runner (1 ms virtual clock step)
+//---------------------------
+
+struct SimTransition {
+    uint8_t event;          // TraceEvent
+    uint64_t micros;        // virtual time
+};
+
+void simBegin(FILE *serialSink);
+void simRunSetup();
+void simRunUntil(uint64_t endMicros);
+uint64_t simNowMicros();
+uint64_t simLoopPasses();
+
+// Runs trial(context, result) in a fork()ed child, so it starts from the
+// untouched power-on state; result (size bytes) comes back over a pipe.
+typedef void (*SimTrial)(const void *context, void *result);
+bool simRunIsolated(SimTrial trial, const void *context, void *result, size_t size);
+
+const std::vector<SimTransition> &simTransitions();
+const char *simEventName(uint8_t event);
+void simFormatTime(uint64_t micros, char *buf, size_t size);
+
+#endif
@@ -0,0 +1,211 @@
+/**
+ * @file alarm.cpp
+ * @brief Alarm engine: hysteresis, persistence and dwell per severity level.
+ *
+ * Replaces the single "ppm > PPM_THRESHOLD" comparison in the alarm
+ * task, which switched the warning state on every reading that crossed
+ * 2000 ppm. Near the threshold one ADC code is ~150 ppm, so a steady
+ * room toggled the servo and the buzzer every few seconds.
+ *
+ * Each level in levels[] (flash) is a small state machine fed once per
+ * second with the averaged PPM:
+ *
+ *    off --(persistN of the last persistM readings > enterPPM,
+ *           off for at least minOffS)--> on
+ *    on  --(persistN of the last persistM readings < exitPPM,
+ *           on for at least minOnS)--> off
+ *
+ *  - hysteresis: enterPPM > exitPPM, so a reading between them holds
+ *    the current state
+ *  - persistence: the last persistM readings are kept as bits; a single
+ *    spike or dip cannot switch a level (CONSECUTIVE_HIGH in the old
+ *    AirPPM_test sketch was the N-of-N case)
+ *  - dwell: a level that just switched stays put for its minimum time.
+ *    The first entry after power-up is not held back
+ *
+ * The levels are independent; the severity is the highest one that is
+ * on. The sensor voltage failsafe counts as a reading above every enter
+ * threshold, and gated levels also need the caller's confirmation to
+ * count a reading towards entering (the Kalman gate: gas, not drift).
+ * Leaving is never gated.
+ *
+ * The module only decides. The alarm task turns ALARM_CRITICAL into the
+ * warning state and response.cpp plays the level's pattern below it.
+ *
+ * Dependencies:
+ *  - buzzer.h  : pattern of each level
+ *  - globals.h : PPM_THRESHOLD, the CRITICAL enter level
+ *
+ * Memory:
+ *  - 21 bytes per level in flash, 8 bytes per level in RAM
+ */
+
+#include "alarm.h"
+#include "globals.h"
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#else
+#include <string.h>
+#define PROGMEM
+#define memcpy_P memcpy
+#endif
+
+//====================================================
+// Level Table
+//====================================================
+
+// Ascending severity, one row per AlarmSeverity after ALARM_NONE.
+// CRITICAL enters at PPM_THRESHOLD (globals.h), the same level that aborts
+// a calibration in the alarm task, and leaves 10 % below it.
+static const AlarmLevel levels[ALARM_SEVERITY_COUNT - 1] PROGMEM = {
+    //  name        enter  exit  N  M  on_s  off_s  pattern                 gated
+    { "ELEVATED",   1000,   900, 3, 5,   60,    30, BUZZER_ALARM_ELEVATED,  false },
+    { "HIGH",       1500,  1350, 3, 5,   60,    30, BUZZER_ALARM_HIGH,      false },
+    { "CRITICAL", PPM_THRESHOLD, PPM_THRESHOLD * 9 / 10,
+                                 3, 5,   30,    10, BUZZER_ALARM_CRITICAL,  true  },
+};
+
+static_assert(PPM_THRESHOLD * 9 / 10 > 1500, "PPM_THRESHOLD overlaps the HIGH level; lower HIGH and ELEVATED with it");
+
+static const uint8_t LEVEL_COUNT = sizeof(levels) / sizeof(levels[0]);
+
+//====================================================
+// Level State
+//====================================================
+
+struct LevelState {
+    bool on;
+    uint8_t above;          // one bit per reading, newest in bit 0: above enterPPM
+    uint8_t below;          // same, below exitPPM
+    uint8_t entries;        // times switched on (saturates)
+    uint32_t since;         // millis() of the last switch
+};
+
+static LevelState state[LEVEL_COUNT];
+static AlarmSeverity currentSeverity = ALARM_NONE;
+
+static uint8_t countBits(uint8_t bits) {
+    uint8_t count = 0;
+    while (bits) {
+        bits &= bits - 1;
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Feeds one reading to one level and switches it when due.
+ */
+static void levelUpdate(const AlarmLevel &level, LevelState &s, float ppm,
+                        bool failsafe, bool confirmed, uint32_t now) {
+    uint8_t window = (level.persistM >= ALARM_PERSIST_MAX) ? 0xFF : (1 << level.persistM) - 1;
+    bool above = failsafe || (ppm > level.enterPPM && (confirmed || !level.gated));
+    bool below = !failsafe && ppm < level.exitPPM;
+    s.above = ((s.above << 1) | above) & window;
+    s.below = ((s.below << 1) | below) & window;
+
+    uint32_t dwell = now - s.since;
+    if (!s.on) {
+        if (countBits(s.above) >= level.persistN
+            && (s.entries == 0 || dwell >= level.minOffS * 1000UL)) {
+            s.on = true;
+            s.since = now;
+            if (s.entries < 0xFF) {
+                s.entries++;
+            }
+        }
+    } else if (countBits(s.below) >= level.persistN && dwell >= level.minOnS * 1000UL) {
+        s.on = false;
+        s.since = now;
+    }
+}
+
+static void printSeverity(AlarmSeverity severity) {
+    if (severity == ALARM_NONE) {
+        Serial.println(F("none"));
+        return;
+    }
+    AlarmLevel level;
+    memcpy_P(&level, &levels[severity - 1], sizeof(level));
+    Serial.println(level.name);
+}
+
+//====================================================
+// Public Interface
+//====================================================
+
+/**
+ * @brief Evaluates every level on one reading; call once per second.
+ *
+ * Parameters:
+ *  @param ppm       Averaged CO2 concentration
+ *  @param failsafe  Raw sensor voltage above SENSOR_VOLTAGE_THRESHOLD
+ *  @param confirmed Gated levels may count this reading towards entering
+ *
+ * Returns:
+ *  @return AlarmSeverity - highest level now on
+ */
+AlarmSeverity alarmUpdate(float ppm, bool failsafe, bool confirmed) {
+    uint32_t now = millis();
+    AlarmSeverity next = ALARM_NONE;
+    for (uint8_t i = 0; i < LEVEL_COUNT; i++) {
+        AlarmLevel level;
+        memcpy_P(&level, &levels[i], sizeof(level));
+        levelUpdate(level, state[i], ppm, failsafe, confirmed, now);
+        if (state[i].on) {
+            next = (AlarmSeverity)(i + 1);
+        }
+    }
+    if (next != currentSeverity) {
+        currentSeverity = next;
+        Serial.print(F("Alarm level: "));
+        printSeverity(currentSeverity);
+    }
+    return currentSeverity;
+}
+
+AlarmSeverity alarmSeverity() {
+    return currentSeverity;
+}
+
+/**
+ * @brief Buzzer pattern of a severity (ALARM_NONE has none: BUZZER_PATTERN_COUNT).
+ */
+BuzzerPattern alarmPattern(AlarmSeverity severity) {
+    if (severity == ALARM_NONE || severity >= ALARM_SEVERITY_COUNT) {
+        return BUZZER_PATTERN_COUNT;
+    }
+    AlarmLevel level;
+    memcpy_P(&level, &levels[severity - 1], sizeof(level));
+    return (BuzzerPattern)level.pattern;
+}
+
+/**
+ * @brief Prints the level table and state (console command "alarm").
+ *
+ * Output format (thresholds in ppm, times in s):
+ *  level enter exit persist on_s off_s state for_s entries
+ */
+void alarmReport() {
+    uint32_t now = millis();
+    Serial.println(F("--- alarm (ppm, s) ---"));
+    Serial.println(F("level enter exit persist on_s off_s state for_s entries"));
+    for (uint8_t i = 0; i < LEVEL_COUNT; i++) {
+        AlarmLevel level;
+        memcpy_P(&level, &levels[i], sizeof(level));
+        const LevelState &s = state[i];
+        Serial.print(level.name);
+        Serial.print(' '); Serial.print(level.enterPPM);
+        Serial.print(' '); Serial.print(level.exitPPM);
+        Serial.print(' '); Serial.print(level.persistN);
+        Serial.print('/'); Serial.print(level.persistM);
+        Serial.print(' '); Serial.print(level.minOnS);
+        Serial.print(' '); Serial.print(level.minOffS);
+        Serial.print(s.on ? F(" on ") : F(" off "));
+        Serial.print(s.entries ? (now - s.since) / 1000 : now / 1000);
+        Serial.print(' '); Serial.println(s.entries);
+    }
+    Serial.print(F("severity "));
+    printSeverity(currentSeverity);
+}
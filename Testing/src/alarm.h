@@ -0,0 +1,41 @@
+#ifndef ALARM_H
+#define ALARM_H
+
+#include <Arduino.h>
+#include "buzzer.h"
+
+//---------------------------
+// Table-driven alarm engine
+//---------------------------
+// One row per severity level (alarm.cpp): enter/exit thresholds, N-of-M
+// persistence and minimum on/off dwell. The active severity is the
+// highest level that is on; ALARM_CRITICAL is the warning state.
+
+enum AlarmSeverity {
+    ALARM_NONE,
+    ALARM_ELEVATED,
+    ALARM_HIGH,
+    ALARM_CRITICAL,
+    ALARM_SEVERITY_COUNT
+};
+
+const uint8_t ALARM_PERSIST_MAX = 8;        // longest persistence window (one bit per reading)
+
+struct AlarmLevel {
+    char name[9];
+    uint16_t enterPPM;      // a reading above this counts towards entering
+    uint16_t exitPPM;       // a reading below this counts towards leaving
+    uint8_t persistN;       // readings of the last persistM that must agree
+    uint8_t persistM;       // window, at most ALARM_PERSIST_MAX
+    uint16_t minOnS;        // shortest time on before leaving is allowed
+    uint16_t minOffS;       // shortest time off before entering again
+    uint8_t pattern;        // BuzzerPattern while this is the severity
+    bool gated;             // entering also needs the caller's confirmation (Kalman gate)
+};
+
+AlarmSeverity alarmUpdate(float ppm, bool failsafe, bool confirmed);
+AlarmSeverity alarmSeverity();
+BuzzerPattern alarmPattern(AlarmSeverity severity);
+void alarmReport();
+
+#endif
@@ -0,0 +1,89 @@
+/**
+ * @file average.cpp
+ * @brief Constant-time moving average over integer samples.
+ *
+ * Keeps a running sum alongside the circular sample buffer. Each insert
+ * subtracts the sample leaving the window and adds the new one, so the
+ * mean costs a single divide regardless of window length.
+ *
+ * Samples are stored as raw integers (ADC codes) rather than floats:
+ *  - The running sum is exact and can never accumulate rounding drift
+ *  - Storage is 2 bytes per sample instead of 4, which matters on the
+ *    Uno's 2 KB of SRAM when using multi-second windows
+ *
+ * Dependencies:
+ *  - None (pure computation, caller provides the buffer)
+ *
+ * Limits:
+ *  - 1023 * size must fit in 32 bits, i.e. any window that fits in RAM
+ */
+
+#include "average.h"
+
+/**
+ * @brief Binds a moving average to its storage and clears it.
+ *
+ * Parameters:
+ *  @param ma     Moving average to initialize
+ *  @param buffer Caller-owned array of at least size entries
+ *  @param size   Window length in samples (must be > 0)
+ */
+void movingAverageInit(MovingAverage *ma, uint16_t *buffer, uint16_t size) {
+    ma->samples = buffer;
+    ma->size = size;
+    movingAverageReset(ma);
+}
+
+/**
+ * @brief Discards all samples while keeping the bound storage.
+ */
+void movingAverageReset(MovingAverage *ma) {
+    for (uint16_t i = 0; i < ma->size; i++) {
+        ma->samples[i] = 0;
+    }
+    ma->index = 0;
+    ma->count = 0;
+    ma->sum = 0;
+}
+
+/**
+ * @brief Inserts a sample, evicting the oldest once the window is full.
+ *
+ * Cost: O(1), one subtraction and one addition on the running sum.
+ *
+ * Parameters:
+ *  @param ma    Moving average to update
+ *  @param value New sample
+ */
+void movingAveragePush(MovingAverage *ma, uint16_t value) {
+    if (ma->count < ma->size) {
+        ma->count++;
+    } else {
+        ma->sum -= ma->samples[ma->index];
+    }
+    ma->samples[ma->index] = value;
+    ma->sum += value;
+    if (++ma->index >= ma->size) {
+        ma->index = 0;
+    }
+}
+
+/**
+ * @brief Returns the number of valid samples in the window.
+ */
+uint16_t movingAverageCount(const MovingAverage *ma) {
+    return ma->count;
+}
+
+/**
+ * @brief Returns the mean of the valid samples.
+ *
+ * Returns:
+ *  @return float - Mean in sample units, 0 if the window is empty
+ */
+float movingAverageMean(const MovingAverage *ma) {
+    if (ma->count == 0) {
+        return 0.0f;
+    }
+    return (float)ma->sum / ma->count;
+}
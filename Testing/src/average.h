@@ -0,0 +1,23 @@
+#ifndef AVERAGE_H
+#define AVERAGE_H
+
+#include <Arduino.h>
+
+//---------------------------
+// Running-sum moving average
+//---------------------------
+struct MovingAverage {
+    uint16_t *samples;  // caller-owned storage, size entries
+    uint16_t size;      // window length in samples
+    uint16_t index;     // next slot to overwrite
+    uint16_t count;     // valid samples (saturates at size)
+    uint32_t sum;       // exact sum of the valid samples
+};
+
+void movingAverageInit(MovingAverage *ma, uint16_t *buffer, uint16_t size);
+void movingAverageReset(MovingAverage *ma);
+void movingAveragePush(MovingAverage *ma, uint16_t value);
+uint16_t movingAverageCount(const MovingAverage *ma);
+float movingAverageMean(const MovingAverage *ma);
+
+#endif
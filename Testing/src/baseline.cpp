@@ -0,0 +1,266 @@
+/**
+ * @file baseline.cpp
+ * @brief Automatic baseline correction from long-window clean-air minima.
+ *
+ * Indoor air returns to (near) ambient CO2 at some point every few hours,
+ * and clean air gives the MQ-135 its highest Rs, i.e. its lowest ADC code.
+ * The lowest per-minute reading over the last hours is therefore the
+ * sensor's current clean-air point, and R0 can follow the drift without
+ * asking the user for clean air:
+ *
+ *    target R0 = Rs(lowest minute code) / k   (k: ActiveCurve, curve.h)
+ *
+ * (Tracking the minimum code is the same as tracking the maximum of
+ * Rs/R0, but needs no float per reading and stays valid when R0 moves.
+ * With ENV_COMPENSATION each minute mean is first mapped to the code the
+ * same Rs would give at the reference temperature and humidity, so
+ * minima taken at different temperatures remain comparable.)
+ *
+ * Memory-bounded rolling minimum:
+ *  - Every second the averaged ADC code is summed; each minute yields one
+ *    mean (x16 fixed point, sub-code resolution)
+ *  - Minutes fold into the running minimum of the current block of
+ *    BASELINE_BLOCK_MINUTES; finished blocks go into a ring of
+ *    BASELINE_BLOCKS block minima
+ *  - The window minimum is the minimum over the ring plus the open block:
+ *    O(BASELINE_BLOCKS) per minute, 2 bytes per block, and old blocks
+ *    expire whole (the window spans 4 h to 4 h 15 min)
+ *
+ * Correction:
+ *  - Only once BASELINE_MIN_BLOCKS blocks exist
+ *  - Errors under BASELINE_DEADBAND are ignored, so the PPM table is not
+ *    rebuilt for noise
+ *  - R0 moves toward the target by at most BASELINE_MAX_STEP per minute,
+ *    so a wrong minimum (e.g. a sensor glitch) cannot cause a jump
+ *
+ * A minimum only follows Rs up. When Rs drifts down, the old blocks keep
+ * the target high for the whole window, so R0 corrections made elsewhere
+ * (r0track.cpp, a detected drift) call baselineSeed(): every block then
+ * holds the clean-air code of the new R0 and the baseline stops pulling
+ * R0 back toward minima the sensor no longer reaches.
+ *
+ * Dependencies:
+ *  - globals.h : R0, RL (and curve.h: ActiveCurve)
+ *  - calib.h   : updateR0()
+ *  - envcomp.h : Rs scale to the reference conditions
+ */
+
+#include "baseline.h"
+#include "globals.h"
+#include "calib.h"
+#include "envcomp.h"
+
+static const uint16_t CODE_SCALE = 16;      // minute means are stored as code x 16
+static const uint16_t NO_MINIMUM = 0xFFFF;
+
+static uint32_t minuteSum = 0;              // code x 16, summed per second
+static uint8_t minuteSeconds = 0;
+static uint16_t openBlockMin = NO_MINIMUM;
+static uint8_t openBlockMinutes = 0;
+static uint16_t blockMin[BASELINE_BLOCKS];
+static uint8_t blockHead = 0;               // next ring slot to overwrite
+static uint8_t blockCount = 0;
+
+//====================================================
+// Rolling Minimum
+//====================================================
+
+/**
+ * @brief Lowest minute code (x16) in the window, NO_MINIMUM if empty.
+ */
+static uint16_t windowMinimum() {
+    uint16_t lowest = openBlockMin;
+    for (uint8_t i = 0; i < blockCount; i++) {
+        if (blockMin[i] < lowest) {
+            lowest = blockMin[i];
+        }
+    }
+    return lowest;
+}
+
+/**
+ * @brief Maps a minute mean (code x 16) to the reference conditions.
+ *
+ * code = 1023 * RL / (Rs + RL), so scaling Rs by s gives
+ * code' = 1023 / ((1023 / code - 1) * s + 1).
+ */
+static uint16_t referenceCode(uint16_t minuteCode) {
+#if ENV_COMPENSATION
+    if (minuteCode == 0) {
+        return 0;
+    }
+    const float fullScale = 1023.0 * CODE_SCALE;
+    float scaled = fullScale / ((fullScale / minuteCode - 1) * envRsScale() + 1);
+    return (uint16_t)(scaled + 0.5f);
+#else
+    return minuteCode;
+#endif
+}
+
+static void closeMinute(uint16_t minuteCode) {
+    minuteCode = referenceCode(minuteCode);
+    if (minuteCode < openBlockMin) {
+        openBlockMin = minuteCode;
+    }
+    if (++openBlockMinutes < BASELINE_BLOCK_MINUTES) {
+        return;
+    }
+    blockMin[blockHead] = openBlockMin;
+    blockHead = (blockHead + 1) % BASELINE_BLOCKS;
+    if (blockCount < BASELINE_BLOCKS) {
+        blockCount++;
+    }
+    openBlockMin = NO_MINIMUM;
+    openBlockMinutes = 0;
+}
+
+//====================================================
+// Correction
+//====================================================
+
+/**
+ * @brief R0 implied by the window minimum, or 0 if there is no history.
+ */
+float baselineTargetR0() {
+    uint16_t lowest = windowMinimum();
+    if (lowest == NO_MINIMUM || lowest == 0) {
+        return 0;
+    }
+    float volt = ((float)lowest / CODE_SCALE) * (5.0 / 1023.0);
+    float rs = ((5.0 / volt) - 1.0) * RL;   // already at the reference conditions: no calculateRs()
+    return curveR0<ActiveCurve>(rs);
+}
+
+/**
+ * @brief Reports whether enough history exists to correct R0.
+ */
+bool baselineReady() {
+    return blockCount >= BASELINE_MIN_BLOCKS;
+}
+
+static void nudgeR0() {
+    if (!baselineReady()) {
+        return;
+    }
+    float target = baselineTargetR0();
+    if (target <= 0) {
+        return;
+    }
+    float error = (target - R0) / R0;
+    if (error < BASELINE_DEADBAND && error > -BASELINE_DEADBAND) {
+        return;
+    }
+    error = constrain(error, -BASELINE_MAX_STEP, BASELINE_MAX_STEP);
+    updateR0(R0 * (1 + error));
+}
+
+//====================================================
+// Public Interface
+//====================================================
+
+/**
+ * @brief Feeds one averaged reading; call once per second.
+ *
+ * Parameters:
+ *  @param code Moving-average ADC code (0-1023)
+ *
+ * Side effects:
+ *  - Once per minute, may move R0 by up to BASELINE_MAX_STEP
+ */
+void baselineUpdate(float code) {
+    minuteSum += (uint16_t)(code * CODE_SCALE + 0.5f);
+    if (++minuteSeconds < 60) {
+        return;
+    }
+    closeMinute((uint16_t)(minuteSum / minuteSeconds));
+    minuteSum = 0;
+    minuteSeconds = 0;
+    nudgeR0();
+}
+
+/**
+ * @brief Replaces the history with the clean-air point of a new R0.
+ *
+ * Keeps the block count, so an active baseline stays active; later
+ * minutes below the seeded code still pull R0 up as before.
+ *
+ * Parameters:
+ *  @param r0 R0 just installed by updateR0() (kOhm)
+ */
+void baselineSeed(float r0) {
+    if (r0 <= 0) {
+        return;
+    }
+    float rs = ActiveCurve::cleanAirRatio() * r0;
+    uint16_t seed = (uint16_t)(1023.0 * CODE_SCALE * RL / (rs + RL) + 0.5f);
+    for (uint8_t i = 0; i < blockCount; i++) {
+        blockMin[i] = seed;
+    }
+    openBlockMin = seed;
+}
+
+/**
+ * @brief Forgets all history (e.g. after replacing the sensor).
+ */
+void baselineReset() {
+    minuteSum = 0;
+    minuteSeconds = 0;
+    openBlockMin = NO_MINIMUM;
+    openBlockMinutes = 0;
+    blockHead = 0;
+    blockCount = 0;
+}
+
+/**
+ * @brief Copies the finished-block ring out, e.g. for persist.cpp.
+ *
+ * Parameters:
+ *  @param blocks Receives BASELINE_BLOCKS block minima (code x 16)
+ *  @param head   Receives the next ring slot to overwrite
+ *
+ * Returns:
+ *  @return uint8_t - Number of valid blocks in the ring
+ */
+uint8_t baselineExport(uint16_t *blocks, uint8_t *head) {
+    for (uint8_t i = 0; i < BASELINE_BLOCKS; i++) {
+        blocks[i] = blockMin[i];
+    }
+    *head = blockHead;
+    return blockCount;
+}
+
+/**
+ * @brief Restores a ring saved by baselineExport().
+ *
+ * The open block and minute accumulator start empty. An inconsistent
+ * ring (head or count out of range) is ignored.
+ */
+void baselineImport(const uint16_t *blocks, uint8_t head, uint8_t count) {
+    if (head >= BASELINE_BLOCKS || count > BASELINE_BLOCKS) {
+        return;
+    }
+    baselineReset();
+    for (uint8_t i = 0; i < BASELINE_BLOCKS; i++) {
+        blockMin[i] = blocks[i];
+    }
+    blockHead = head;
+    blockCount = count;
+}
+
+/**
+ * @brief Prints the correction state (console command "baseline").
+ */
+void baselineReport() {
+    uint16_t lowest = windowMinimum();
+    Serial.print(F("baseline blocks ")); Serial.print(blockCount);
+    Serial.print('/'); Serial.print(BASELINE_BLOCKS);
+    Serial.print(F(" min code "));
+    if (lowest == NO_MINIMUM) {
+        Serial.print('-');
+    } else {
+        Serial.print((float)lowest / CODE_SCALE, 2);
+    }
+    Serial.print(F(" target R0 ")); Serial.print(baselineTargetR0(), 2);
+    Serial.print(F(" R0 ")); Serial.print(R0, 2);
+    Serial.println(baselineReady() ? F(" (active)") : F(" (collecting)"));
+}
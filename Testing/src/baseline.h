@@ -0,0 +1,24 @@
+#ifndef BASELINE_H
+#define BASELINE_H
+
+#include <Arduino.h>
+
+//---------------------------
+// Automatic baseline correction
+//---------------------------
+const uint8_t BASELINE_BLOCK_MINUTES = 15;  // minutes folded into one block minimum
+const uint8_t BASELINE_BLOCKS = 16;         // history: 16 x 15 min = 4 h window
+const uint8_t BASELINE_MIN_BLOCKS = 4;      // 1 h of history before R0 is touched
+const float BASELINE_DEADBAND = 0.01;       // ignore R0 errors below 1 %
+const float BASELINE_MAX_STEP = 0.005;      // move R0 at most 0.5 % per minute
+
+void baselineUpdate(float code);
+void baselineReset();
+void baselineSeed(float r0);
+bool baselineReady();
+float baselineTargetR0();
+void baselineReport();
+uint8_t baselineExport(uint16_t *blocks, uint8_t *head);
+void baselineImport(const uint16_t *blocks, uint8_t head, uint8_t count);
+
+#endif
@@ -0,0 +1,247 @@
+/**
+ * @file buzzer.cpp
+ * @brief Timer-driven buzzer patterns from a step table in flash.
+ *
+ * Replaces the updateBuzzer() state machine, which toggled the 500/50 ms
+ * warning pattern from millis() on every loop() pass (jittering with loop
+ * load), and the blocking warning_buzzer(). A pattern is a list of steps
+ * in one flash table; the Timer2 compare-match interrupt counts down the
+ * current step every millisecond and moves the D11 output on to the next,
+ * so patterns stay exact however busy the main loop is and cost it nothing.
+ *
+ * Step encoding (one byte):
+ *
+ *    bit 7      buzzer on (1) / off (0)
+ *    bits 6-0   duration in 10 ms units (1-127: 10 ms - 1.27 s)
+ *
+ *    BUZZER_STEP_END     0x00  pattern over, buzzer off
+ *    BUZZER_STEP_REPEAT  0x80  back to the first step
+ *
+ * Priorities: a one-shot pattern (ending in BUZZER_STEP_END) asked for
+ * while a looping one plays is dropped, so a calibration beep cannot
+ * silence an alarm. Everything else replaces the current pattern.
+ *
+ * Timer2 runs in CTC mode at clk/64 with OCR2A = 249 (1 kHz at 16 MHz);
+ * the compare interrupt is enabled only while a pattern plays. The pin is
+ * driven by the interrupt, not by OC2A, so an active buzzer sees the same
+ * levels as before. Timer2 was unused: Timer0 is millis() and the sampler,
+ * Timer1 the servo. On non-AVR targets buzzerService() advances the
+ * pattern from millis() instead (the buzzer task, every 10 ms).
+ *
+ * Dependencies:
+ *  - globals.h : Buzzer_output pin
+ *  - profile.h : ISR scope marker
+ */
+
+#include "buzzer.h"
+#include "globals.h"
+#include "profile.h"
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+#else
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#endif
+
+//====================================================
+// Pattern Table
+//====================================================
+
+static const uint8_t BUZZER_STEP_END = 0x00;
+static const uint8_t BUZZER_STEP_REPEAT = 0x80;
+
+#define BUZZER_ON(ms)  (0x80 | ((ms) / 10))
+#define BUZZER_OFF(ms) ((ms) / 10)
+
+static const uint8_t patternSteps[] PROGMEM = {
+    // BUZZER_ALARM_CRITICAL (0)
+    BUZZER_ON(500), BUZZER_OFF(50), BUZZER_STEP_REPEAT,
+    // BUZZER_ALARM_HIGH (3)
+    BUZZER_ON(200), BUZZER_OFF(800), BUZZER_STEP_REPEAT,
+    // BUZZER_ALARM_ELEVATED (6)
+    BUZZER_ON(100), BUZZER_OFF(1000), BUZZER_OFF(1000), BUZZER_OFF(900), BUZZER_STEP_REPEAT,
+    // BUZZER_RECOVERY (11)
+    BUZZER_ON(40), BUZZER_OFF(60), BUZZER_ON(40), BUZZER_OFF(60), BUZZER_ON(120), BUZZER_STEP_END,
+    // BUZZER_CALIBRATION_START (17)
+    BUZZER_ON(100), BUZZER_STEP_END,
+    // BUZZER_CALIBRATION_DONE (19)
+    BUZZER_ON(100), BUZZER_OFF(100), BUZZER_ON(100), BUZZER_STEP_END,
+    // BUZZER_CALIBRATION_ABORTED (23)
+    BUZZER_ON(400), BUZZER_STEP_END,
+};
+
+// First step of each BuzzerPattern
+static const uint8_t patternStart[BUZZER_PATTERN_COUNT] PROGMEM = {
+    0, 3, 6, 11, 17, 19, 23
+};
+
+//====================================================
+// Player State
+//====================================================
+
+static volatile uint8_t firstStep = 0;      // index of the playing pattern's first step
+static volatile uint8_t currentStep = 0;
+static volatile uint16_t remainingMs = 0;   // of the current step
+static volatile bool playing = false;
+static volatile bool looping = false;       // the playing pattern ends in BUZZER_STEP_REPEAT
+
+static void timerEnable(bool enable) {
+#if defined(__AVR__)
+    if (enable) {
+        TCNT2 = 0;
+        TIFR2 = _BV(OCF2A);
+        TIMSK2 |= _BV(OCIE2A);
+    } else {
+        TIMSK2 &= ~_BV(OCIE2A);
+    }
+#else
+    (void)enable;
+#endif
+}
+
+/**
+ * @brief Enters step index (interrupts off): drives the pin, loads the duration.
+ */
+static void enterStep(uint8_t index) {
+    uint8_t step = pgm_read_byte(&patternSteps[index]);
+    if (step == BUZZER_STEP_REPEAT) {
+        index = firstStep;
+        step = pgm_read_byte(&patternSteps[index]);
+    }
+    currentStep = index;
+    if (step == BUZZER_STEP_END) {
+        digitalWrite(Buzzer_output, LOW);
+        playing = false;
+        timerEnable(false);
+        return;
+    }
+    digitalWrite(Buzzer_output, (step & 0x80) ? HIGH : LOW);
+    remainingMs = (uint16_t)(step & 0x7F) * 10;
+}
+
+/**
+ * @brief Advances the playing pattern by elapsedMs.
+ */
+static void advance(uint16_t elapsedMs) {
+    while (playing && elapsedMs > 0) {
+        if (elapsedMs < remainingMs) {
+            remainingMs -= elapsedMs;
+            return;
+        }
+        elapsedMs -= remainingMs;
+        enterStep(currentStep + 1);
+    }
+}
+
+#if defined(__AVR__)
+
+/**
+ * @brief Timer2 compare match A: one millisecond of the playing pattern.
+ */
+ISR(TIMER2_COMPA_vect) {
+    PROFILE_SCOPE(PROF_BUZZER_ISR);
+    advance(BUZZER_TICK_MS);
+}
+
+#else
+
+static unsigned long lastServiceTime = 0;
+
+#endif
+
+//====================================================
+// Public Interface
+//====================================================
+
+/**
+ * @brief Sets up Timer2 for the 1 kHz pattern tick (interrupt still off).
+ */
+void buzzerBegin() {
+    pinMode(Buzzer_output, OUTPUT);
+    digitalWrite(Buzzer_output, LOW);
+#if defined(__AVR__)
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        TIMSK2 = 0;
+        TCCR2A = _BV(WGM21);                // CTC, TOP = OCR2A, OC2A disconnected
+        TCCR2B = _BV(CS22);                 // clk/64
+        OCR2A = F_CPU / 64 / 1000 - 1;      // 249: 1 kHz
+    }
+#endif
+}
+
+/**
+ * @brief Switches to the pattern starting at step start (interrupts off).
+ */
+static void startPattern(uint8_t start, bool loops) {
+    if (playing && looping && !loops) {
+        return;                             // a beep never silences an alarm
+    }
+    if (playing && looping && firstStep == start) {
+        return;                             // already playing: keep the rhythm
+    }
+    firstStep = start;
+    looping = loops;
+    playing = true;
+    enterStep(start);
+    timerEnable(true);
+}
+
+/**
+ * @brief Starts a pattern (see the priority rule in the file header).
+ */
+void buzzerPlay(BuzzerPattern pattern) {
+    if (pattern >= BUZZER_PATTERN_COUNT) {
+        return;
+    }
+    uint8_t start = pgm_read_byte(&patternStart[pattern]);
+    uint8_t end = start;
+    while (pgm_read_byte(&patternSteps[end]) != BUZZER_STEP_END
+           && pgm_read_byte(&patternSteps[end]) != BUZZER_STEP_REPEAT) {
+        end++;
+    }
+    bool loops = pgm_read_byte(&patternSteps[end]) == BUZZER_STEP_REPEAT;
+#if defined(__AVR__)
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        startPattern(start, loops);
+    }
+#else
+    buzzerService();                        // bring the current pattern up to date first
+    startPattern(start, loops);
+#endif
+}
+
+/**
+ * @brief Silences the buzzer and ends any pattern.
+ */
+void buzzerStop() {
+#if defined(__AVR__)
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        timerEnable(false);
+        playing = false;
+    }
+#else
+    playing = false;
+#endif
+    digitalWrite(Buzzer_output, LOW);
+}
+
+bool buzzerPlaying() {
+    return playing;
+}
+
+/**
+ * @brief Polled pattern player for targets without the Timer2 interrupt.
+ *
+ * Does nothing on AVR.
+ */
+void buzzerService() {
+#if !defined(__AVR__)
+    unsigned long now = millis();
+    unsigned long elapsed = now - lastServiceTime;
+    lastServiceTime = now;
+    advance(elapsed > 0xFFFF ? 0xFFFF : (uint16_t)elapsed);
+#endif
+}
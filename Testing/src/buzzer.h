@@ -0,0 +1,33 @@
+#ifndef BUZZER_H
+#define BUZZER_H
+
+#include <Arduino.h>
+
+//---------------------------
+// Buzzer pattern engine
+//---------------------------
+// Patterns are step lists in flash (buzzer.cpp), played by the Timer2
+// compare-match interrupt at 1 kHz. Looping patterns run until stopped or
+// replaced; one-shot patterns end by themselves and never interrupt a
+// looping one.
+
+enum BuzzerPattern {
+    BUZZER_ALARM_CRITICAL,      // 500 ms on / 50 ms off, loops (the original warning pattern)
+    BUZZER_ALARM_HIGH,          // 200 ms on / 800 ms off, loops
+    BUZZER_ALARM_ELEVATED,      // 100 ms on every 3 s, loops
+    BUZZER_RECOVERY,            // chirp when the air is clean again
+    BUZZER_CALIBRATION_START,   // one short beep
+    BUZZER_CALIBRATION_DONE,    // two short beeps
+    BUZZER_CALIBRATION_ABORTED, // one long beep
+    BUZZER_PATTERN_COUNT
+};
+
+const uint8_t BUZZER_TICK_MS = 1;           // Timer2 compare-match period
+
+void buzzerBegin();
+void buzzerPlay(BuzzerPattern pattern);
+void buzzerStop();
+bool buzzerPlaying();
+void buzzerService();
+
+#endif
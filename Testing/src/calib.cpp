@@ -12,29 +12,48 @@
  * Calibration assumes a clean-air baseline of approximately 400 ppm CO2
  * equivalent, as commonly used for MQ-135 sensors.
  * 
- * 1.8 RS/R0 Value comes from emperical testing. See test/CO2_testing.ipynb
+ * The clean-air Rs/R0 (1.8, from emperical testing, see test/CO2_testing.ipynb)
+ * belongs to the active curve in curve.h, so it always matches calculatePPM().
  *
  * Dependencies:
  *  - globals.h : shared system state (R0, timing flags, LCD, pins)
  *  - utils.h   : sensor math (Rs, PPM calculations)
+ *  - sampler.h : sensor readings that do not disturb the ADC sampler
+ *  - lut.h     : ADC->PPM table, invalidated whenever R0 changes
+ *  - trace.h   : calibration trace points for the simulator
+ *  - baseline.h: automatic correction that replaces scheduled recalibration
+ *  - r0track.h : streaming implied-R0 statistics for the drift check
+ *  - persist.h : saves each completed calibration to EEPROM
+ *  - drift.h   : drift detector, restarted by each calibration
+ *  - kalman.h  : filter drift state, kept relative to R0
+ *  - buzzer.h  : start / done / aborted beeps
  *
  * Hardware:
  *  - MQ-135 analog output on CO2_analog_pin
  *  - 16x2 character LCD
  *
  * Timing:
- *  - Initial calibration: ~7 seconds total
- *  - Regular recalibration: user-assisted, blocking
+ *  - Initial calibration: ~9 seconds total, blocking (setup only)
+ *  - Regular recalibration: user-assisted, non-blocking state machine
  *
  * Limitations:
  *  - Requires user to place device in clean air
- *  - Blocking delays are used intentionally for stability
  */
 
 
 #include "calib.h"
+#include "config.h"
 #include "globals.h"
 #include "utils.h"
+#include "sampler.h"
+#include "lut.h"
+#include "trace.h"
+#include "baseline.h"
+#include "r0track.h"
+#include "persist.h"
+#include "drift.h"
+#include "kalman.h"
+#include "buzzer.h"
 #include <Arduino.h>
 #include <math.h>
 
@@ -63,61 +82,135 @@ void calibrateInitWaiting() {
 	delay(5000);
 }
 
-/**
- * @brief Performs full sensor calibration and computes R0.
- *
- * Samples the MQ-135 analog output multiple times in clean air,
- * calculates the average sensor resistance (Rs), and derives the
- * reference resistance R0 using the standard MQ-135 clean-air ratio.
- *
- * Calibration steps:
- *  1. Take 50 analog samples at ~10 Hz
- *  2. Convert ADC readings to voltage
- *  3. Compute Rs for each sample
- *  4. Average Rs and divide by clean-air ratio (1.8)
- *
- * Side effects:
- *  - Updates global R0
- *  - Updates LCD with progress and test PPM
- *  - Prints diagnostic output to Serial
- *
- * Blocking: YES (~7 seconds)
- */
-void calibrateSensor() {
+//======================================================================
+// Calibration State Machine
+//======================================================================
+//
+// A calibration is a sequence of timed states advanced by
+// calibrationService() from the service task. No state waits: each call
+// checks its deadline and returns, so sampling, the servo and alarm
+// evaluation keep running while the LCD shows progress.
+//
+//   PROMPT (2 s) -> COUNTDOWN (3 x 1 s)     regular recalibration only
+//   SETTLE (2 s) -> SAMPLING (50 x 100 ms) -> RESULT (2 s) -> IDLE
+//
+// The calibration is aborted, leaving R0 untouched, when gas arrives:
+//  - a sample's Rs falls more than CAL_ABORT_RS_DROP_PCT below the mean so
+//    far (sudden spike, e.g. a breath)
+//  - during a regular recalibration, a sample reads above CAL_ABORT_PPM with
+//    the current R0 (slow rise; the same gate loop() applies before starting)
+//  - the main loop raises an alarm
+
+enum CalibrationState {
+	CAL_IDLE,
+	CAL_PROMPT,
+	CAL_COUNTDOWN,
+	CAL_SETTLE,
+	CAL_SAMPLING,
+	CAL_RESULT
+};
+
+static const uint8_t CAL_SAMPLES = 50;
+static const unsigned long CAL_SAMPLE_INTERVAL_MS = 100;
+static const unsigned long CAL_PROMPT_MS = 2000;
+static const uint8_t CAL_COUNTDOWN_SECONDS = 3;
+static const unsigned long CAL_SETTLE_MS = 2000;
+static const unsigned long CAL_RESULT_MS = 2000;
+static const uint8_t CAL_ABORT_MIN_SAMPLES = 5;		// samples before the spike check applies
+static const uint8_t CAL_ABORT_RS_DROP_PCT = 5;		// ~1.7x PPM on the exponent-10 curve
+static const float CAL_ABORT_PPM = 700;				// regular recalibration only
+static const uint8_t CAL_STARTUP_ATTEMPTS = 5;		// calibrateSensor() gives up after this many aborts
+
+static CalibrationState calState = CAL_IDLE;
+static unsigned long calStateTime = 0;		// entry time of the current state / step
+static bool calRegular = false;				// started by performRegularRecalibration()
+static bool calCompleted = false;			// last calibration reached RESULT (not aborted)
+static uint8_t calCount = 0;				// samples taken, or countdown seconds left
+static uint32_t calSumADC = 0;				// integer sum: also feeds the spike check
+#if !SENSOR_MATH_FIXED
+static float calSumRs = 0;
+#endif
+
+static void calEnter(CalibrationState state) {
+	calState = state;
+	calStateTime = millis();
+}
+
+static void calShowCountdown() {
+	lcd.setCursor(0,1); 
+	lcd.print(calCount); 
+	lcd.print(" seconds     "); 
+}
+
+static void calBeginSettle() {
 	lcd.clear(); 
 	lcd.setCursor(0,0); 
 	lcd.print("Calibrating...");
 
 	Serial.println("Calibrating ...");
+	traceEvent(TRACE_CALIBRATION_START);
+	buzzerPlay(BUZZER_CALIBRATION_START);
 
-	delay(2000);
-
-	float sumRs=0; 
-	int samples=50;
-	for(int i = 0; i < samples; i++){
-		int raw = analogRead(CO2_analog_pin);
-		float volt = raw*(5.0/1023.0);
-		sumRs += calculateRs(volt);
+	calCount = 0;
+	calSumADC = 0;
+#if !SENSOR_MATH_FIXED
+	calSumRs = 0;
+#endif
+	calEnter(CAL_SETTLE);
+}
 
-		// display progress
-		lcd.setCursor(0,1);
-		if (i<10) {
-			lcd.print("0");
-		} 
-		lcd.print(i+1); 
-		lcd.print("/"); 
-		lcd.print(samples); 
-		lcd.print(" samples     ");
+/**
+ * @brief Reports whether a new sample marks gas arriving mid-calibration.
+ *
+ * Compares Rs of the sample against Rs of the mean code so far without a
+ * divide: Rs is proportional to (1023 - code) / code, so
+ * Rs(raw) < (1 - drop) * Rs(mean) becomes a cross-multiplication.
+ */
+static bool calIsSpike(uint16_t raw) {
+	if (calCount < CAL_ABORT_MIN_SAMPLES) {
+		return false;
+	}
+	uint32_t mean = calSumADC / calCount;
+	uint32_t lhs = (uint32_t)(1023 - raw) * mean * 100;
+	uint32_t rhs = (uint32_t)(100 - CAL_ABORT_RS_DROP_PCT) * (1023 - mean) * raw;
+	return lhs < rhs;
+}
 
-		Serial.print(i+1);Serial.print("/");
-		Serial.print(samples);Serial.print(" samples\r");
-		delay(100);
+static void calTakeSample() {
+	int raw = readSensorADC();
+	if (calIsSpike(raw) || (calRegular && lutLookupPPM(raw) > CAL_ABORT_PPM)) {
+		calibrationAbort("CO2 spike");
+		return;
 	}
+	calSumADC += raw;
+#if !SENSOR_MATH_FIXED
+	float volt = raw*(5.0/1023.0);
+	calSumRs += calculateRs(volt);
+#endif
+	calCount++;
 
-	float Rs_clean = sumRs/samples;
-	R0 = Rs_clean/1.8;
-	//R0 = Rs_clean/1.09;
-	float testPPM = calculatePPM(analogRead(CO2_analog_pin)*(5.0/1023.0));
+	// display progress
+	lcd.setCursor(0,1);
+	if (calCount<10) {
+		lcd.print("0");
+	} 
+	lcd.print(calCount); 
+	lcd.print("/"); 
+	lcd.print(CAL_SAMPLES); 
+	lcd.print(" samples     ");
+
+	Serial.print(calCount);Serial.print("/");
+	Serial.print(CAL_SAMPLES);Serial.print(" samples\r");
+}
+
+static void calFinish() {
+#if SENSOR_MATH_FIXED
+	float Rs_clean = calculateRs(((float)calSumADC/CAL_SAMPLES)*(5.0/1023.0));
+#else
+	float Rs_clean = calSumRs/CAL_SAMPLES;
+#endif
+	updateR0(curveR0<ActiveCurve>(Rs_clean));
+	float testPPM = calculatePPM(readSensorADC()*(5.0/1023.0));
 
 	lcd.setCursor(0,1); 
 	lcd.print("Test: "); 
@@ -126,7 +219,182 @@ void calibrateSensor() {
 
 	Serial.print("\nTest: ");Serial.print(testPPM,2);Serial.print(" ppm");
 	debugSensor();
-	delay(2000);
+#if CALIBRATION_PERSIST
+	persistCalibrationDone();
+#endif
+#if DRIFT_DETECTION
+	driftReset();
+#endif
+#if BASELINE_CORRECTION
+	baselineSeed(R0);			// clean air measured now outranks the older minima
+#endif
+	calCompleted = true;
+	buzzerPlay(BUZZER_CALIBRATION_DONE);
+	calEnter(CAL_RESULT);
+}
+
+/**
+ * @brief Starts a calibration if none is running.
+ *
+ * Parameters:
+ *  @param regular true for a scheduled recalibration: shows the clean-air
+ *                 prompt and countdown first, and clears recalibrationDue
+ *                 on completion
+ */
+void calibrationStart(bool regular) {
+	if (calState != CAL_IDLE) {
+		return;
+	}
+	calRegular = regular;
+	calCompleted = false;
+	if (!regular) {
+		calBeginSettle();
+		return;
+	}
+	lcd.clear(); 
+	lcd.setCursor(0,0); lcd.print(" Rglr Recalib  ");
+	lcd.setCursor(0,1); lcd.print("Place clean air");
+	Serial.print("Regular recalibration due...");
+	calEnter(CAL_PROMPT);
+}
+
+/**
+ * @brief Advances the running calibration; call on every loop() pass.
+ *
+ * Returns immediately when idle or when the current step's deadline has
+ * not been reached. Takes at most one sample per call.
+ */
+void calibrationService() {
+	unsigned long elapsed = millis() - calStateTime;
+
+	switch (calState) {
+	case CAL_IDLE:
+		break;
+
+	case CAL_PROMPT:
+		if (elapsed >= CAL_PROMPT_MS) {
+			calCount = CAL_COUNTDOWN_SECONDS;
+			calShowCountdown();
+			calEnter(CAL_COUNTDOWN);
+		}
+		break;
+
+	case CAL_COUNTDOWN:
+		if (elapsed >= 1000) {
+			calStateTime += 1000;
+			if (--calCount == 0) {
+				calBeginSettle();
+			} else {
+				calShowCountdown();
+			}
+		}
+		break;
+
+	case CAL_SETTLE:
+		if (elapsed >= CAL_SETTLE_MS) {
+			calEnter(CAL_SAMPLING);
+			calTakeSample();
+		}
+		break;
+
+	case CAL_SAMPLING:
+		if (elapsed >= CAL_SAMPLE_INTERVAL_MS) {
+			calStateTime += CAL_SAMPLE_INTERVAL_MS;
+			calTakeSample();
+			if (calState == CAL_SAMPLING && calCount >= CAL_SAMPLES) {
+				calFinish();
+			}
+		}
+		break;
+
+	case CAL_RESULT:
+		if (elapsed >= CAL_RESULT_MS) {
+			calState = CAL_IDLE;
+			if (calRegular) {
+				lastCalibrationTime = millis(); 
+				recalibrationDue = false;
+			}
+			traceEvent(TRACE_CALIBRATION_DONE);
+		}
+		break;
+	}
+}
+
+/**
+ * @brief Reports whether a calibration owns the LCD and the sensor.
+ */
+bool calibrationActive() {
+	return calState != CAL_IDLE;
+}
+
+/**
+ * @brief Abandons a running calibration without changing R0.
+ *
+ * A scheduled recalibration stays due and is retried once the air is
+ * clean again (see loop()).
+ *
+ * Parameters:
+ *  @param reason Short cause for the serial log
+ */
+void calibrationAbort(const char *reason) {
+	if (calState == CAL_IDLE) {
+		return;
+	}
+	calState = CAL_IDLE;
+	lcd.clear();
+	Serial.print("\nCalibration aborted: ");
+	Serial.println(reason);
+	traceEvent(TRACE_CALIBRATION_ABORTED);
+	buzzerPlay(BUZZER_CALIBRATION_ABORTED);		// dropped if the alarm is already sounding
+}
+
+/**
+ * @brief Performs full sensor calibration and computes R0 (startup).
+ *
+ * Samples the MQ-135 analog output multiple times in clean air,
+ * calculates the average sensor resistance (Rs), and derives the
+ * reference resistance R0 using the standard MQ-135 clean-air ratio.
+ *
+ * Calibration steps:
+ *  1. Take 50 analog samples at ~10 Hz
+ *  2. Convert ADC readings to voltage
+ *  3. Compute Rs for each sample
+ *  4. Average Rs and divide by the active curve's clean-air ratio
+ *
+ * With SENSOR_MATH_FIXED, steps 2-4 instead sum the integer ADC codes and
+ * compute Rs once from the mean code (one float divide instead of 50).
+ *
+ * Runs the calibration state machine to completion, restarting it if a
+ * spike aborts it, at most CAL_STARTUP_ATTEMPTS times. If every attempt
+ * is aborted (polluted air, a disconnected sensor) R0 keeps its default
+ * or previous value, with a serial notice, so that setup() still
+ * returns and the monitor runs. Only setup() uses this; at run time
+ * calibrations go through calibrationService().
+ *
+ * Side effects:
+ *  - Updates global R0 (via updateR0())
+ *  - Updates LCD with progress and test PPM
+ *  - Prints diagnostic output to Serial
+ *
+ * Blocking: YES (~9 seconds per attempt)
+ */
+void calibrateSensor() {
+	for (uint8_t attempt = 0; attempt < CAL_STARTUP_ATTEMPTS; attempt++) {
+		calibrationStart(false);
+		while (calibrationActive()) {
+			calibrationService();
+			buzzerService();				// beeps on targets without the buzzer timer
+			delay(1);
+		}
+		if (calCompleted) {
+			return;
+		}
+	}
+	Serial.print("Calibration failed ");
+	Serial.print(CAL_STARTUP_ATTEMPTS);
+	Serial.print(" times, keeping R0 = ");
+	Serial.print(R0);
+	Serial.println(" kOhm");
 }
 
 /**
@@ -138,86 +406,131 @@ void calibrateSensor() {
  *
  * Handles millis() rollover safely.
  *
+ * With BASELINE_CORRECTION, scheduled recalibration stops once the
+ * automatic baseline has enough history to take over.
+ *
+ * With DRIFT_DETECTION, a detected drift makes recalibration due at
+ * once, also while the baseline is active: R0 moves with every baseline
+ * step (driftRebase()), so a detection then means drift the baseline
+ * cannot follow, such as Rs drifting down faster than its old minima
+ * expire. The recalibration keeps the usual gates (ppm < 700, no alarm)
+ * and its completion clears the flag (driftReset()).
+ *
  * Does not perform recalibration directly.
  */
 void checkRecalibration() {
+#if DRIFT_DETECTION
+	if (driftDetected()) {
+		if (!recalibrationDue) {
+			traceEvent(TRACE_RECALIBRATION_DUE);
+		}
+		recalibrationDue = true;
+		return;
+	}
+#endif
+#if BASELINE_CORRECTION
+	if (baselineReady()) {
+		recalibrationDue = false;
+		return;
+	}
+#endif
 	unsigned long currentTime = millis();
 	if(currentTime < lastCalibrationTime) {
 		lastCalibrationTime = currentTime;
 	}
 	if(currentTime - lastCalibrationTime >= RECALIBRATION_INTERVAL) {
+		if (!recalibrationDue) {
+			traceEvent(TRACE_RECALIBRATION_DUE);
+		}
 		recalibrationDue = true;
 	}
 }
 
 /**
- * @brief Executes a scheduled recalibration sequence.
+ * @brief Starts a scheduled recalibration sequence.
  *
  * If recalibration is due, prompts the user to place the device in
- * clean air, performs a countdown, and reuses calibrateSensor()
- * to update R0.
+ * clean air, performs a countdown, and calibrates, all through the
+ * non-blocking state machine.
  *
  * Conditions:
  *  - recalibrationDue must be true
  *
- * Side effects:
+ * Side effects (on completion):
  *  - Updates global R0
  *  - Resets lastCalibrationTime
  *  - Clears recalibrationDue flag
  *
- * Blocking: YES (user-assisted)
+ * Blocking: NO (advanced by calibrationService())
  */
 void performRegularRecalibration() {
 	if(!recalibrationDue) {
 		return;
 	}
-
-	lcd.clear(); 
-	lcd.setCursor(0,0); lcd.print(" Rglr Recalib  ");
-	lcd.setCursor(0,1); lcd.print("Place clean air");
-	Serial.print("Regular recalibration due...");
-	delay(2000);
-
-	for(int i = 3; i > 0; i--){
-		lcd.setCursor(0,1); 
-		lcd.print(i); 
-		lcd.print(" seconds     "); 
-		delay(1000);
-	}
-
-	calibrateSensor();
-	lastCalibrationTime = millis(); 
-	recalibrationDue=false;
+	calibrationStart(true);
 }
 
 /**
  * @brief Performs a fast drift check without recalibrating.
  *
- * Takes a small number of samples, estimates a temporary R0 value,
- * and compares it to the original calibration reference.
- *
- * If deviation exceeds 10%, a warning is issued via Serial output.
+ * With DRIFT_DETECTION, reports the sequential detector's verdict and
+ * estimated magnitude (drift.cpp). Otherwise reads the implied R0 that
+ * r0track.cpp maintains over the last minute (Rs through
+ * curveR0<ActiveCurve>()) and compares it to the original calibration
+ * reference; if the deviation exceeds 10%, a warning is issued.
  *
  * Purpose:
  *  - Early detection of sensor drift
  *  - Diagnostic use only (non-corrective)
  *
- * Does NOT modify R0.
+ * Does NOT modify R0. Non-blocking; silent until drift is found.
  */
 void quickRecalibrationCheck() {
-	float sumRs=0; 
-	int samples=10;
-	for(int i = 0; i < samples; i++){
-		float Rs = calculateRs(analogRead(CO2_analog_pin)*(5.0/1023.0));
-		sumRs += Rs;
-		delay(100);
+#if DRIFT_DETECTION
+	if (driftDetected()) {
+		Serial.print("WARNING: Sensor drift! ");
+		Serial.print(driftMagnitude()*100, 1);
+		Serial.println(" %");
 	}
-
-	float avgRs=sumRs/samples;
-	float R0calc = avgRs/1.8;
+#else
+	if (!r0TrackFull() || originalR0 <= 0) {
+		return;
+	}
+	float R0calc = r0TrackMean();
 	if(abs((R0calc/originalR0-1))*100>10) {
 		Serial.println("WARNING: Sensor drift!");
 	}
+#endif
+}
+
+/**
+ * @brief Installs a new baseline resistance R0.
+ *
+ * Single entry point for every R0 change, so that state derived from
+ * R0 (currently the ADC->PPM table) is kept consistent.
+ *
+ * Parameters:
+ *  @param newR0 New clean-air baseline resistance (kOhm)
+ *
+ * Side effects:
+ *  - Updates global R0
+ *  - Schedules an incremental rebuild of the PPM lookup table
+ *  - Rebases the Kalman filter's drift state on the new R0
+ *  - Moves the drift detector's reference with R0
+ */
+void updateR0(float newR0) {
+#if KALMAN_FILTER
+	if (R0 > 0) {
+		kalmanRebase(newR0/R0);
+	}
+#endif
+#if DRIFT_DETECTION
+	if (R0 > 0) {
+		driftRebase(newR0/R0);
+	}
+#endif
+	R0 = newR0;
+	lutInvalidate();
 }
 
 //=======================================================================
@@ -5,9 +5,14 @@
 
 void calibrateInitWaiting();
 void calibrateSensor();
+void calibrationStart(bool regular);
+void calibrationService();
+bool calibrationActive();
+void calibrationAbort(const char *reason);
 void checkRecalibration();
 void performRegularRecalibration();
 void quickRecalibrationCheck();
+void updateR0(float newR0);
 
 #endif
     
\ No newline at end of file
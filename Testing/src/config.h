@@ -0,0 +1,74 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+//---------------------------
+// Compile-time feature switches
+//---------------------------
+// Each switch can be overridden from platformio.ini, e.g.
+//   build_flags = -DSENSOR_MATH_FIXED=0
+
+#ifndef SENSOR_MATH_FIXED
+#define SENSOR_MATH_FIXED 1     // 1: Q16.16 integer sensor math, 0: float reference path
+#endif
+
+#ifndef CO2_CURVE
+#define CO2_CURVE 0             // 0: 400*(1.8/ratio)^10 (empirical), 1: 400*(1.09/ratio)^3.9216, 2: curve_generated.h (see curve.h)
+#endif
+
+#ifndef UNIT_CURVE
+#define UNIT_CURVE 0            // 0: CO2_CURVE folded into the code, 1: per-unit k and n from the "fit" console command (EEPROM, read from RAM at run time)
+#endif
+
+#ifndef LOOP_TIMING
+#define LOOP_TIMING 1           // 1: per-section loop() timing, dumped by the "timing" console command
+#endif
+
+#ifndef BASELINE_CORRECTION
+#define BASELINE_CORRECTION 1   // 1: R0 follows the 4 h clean-air minimum; replaces scheduled recalibration once ready
+#endif
+
+#ifndef R0_TRACKING
+#define R0_TRACKING 1           // 1: commit a new R0 when the implied R0 is stable and off by > 10 %
+#endif
+
+#ifndef CALIBRATION_PERSIST
+#define CALIBRATION_PERSIST 1   // 1: keep R0 and baseline history in EEPROM; warm resets skip calibration
+#endif
+
+#ifndef BOOTLOADER_PASSES_MCUSR
+#define BOOTLOADER_PASSES_MCUSR 0 // 1: the bootloader hands the cleared reset flags over in r2
+#endif
+
+#ifndef ADAPTIVE_PREHEAT
+#define ADAPTIVE_PREHEAT 1      // 1: preheat ends when Rs settles (8-60 s), 0: fixed 20 s
+#endif
+
+#ifndef ENV_COMPENSATION
+#define ENV_COMPENSATION 1      // 1: scale Rs to 20 degC / 33 %RH from a pluggable source (envcomp.cpp)
+#endif
+
+#ifndef DRIFT_DETECTION
+#define DRIFT_DETECTION 1       // 1: CUSUM drift detector on the per-second Rs; detected drift makes recalibration due
+#endif
+
+#ifndef KALMAN_FILTER
+#define KALMAN_FILTER 1         // 1: two-state (gas, drift) Kalman filter on the per-second Rs, "kalman" command
+#endif
+
+#ifndef KALMAN_ALARM_GATE
+#define KALMAN_ALARM_GATE 1     // 1: entering the warning state also needs the filter's P(PPM > threshold) >= 0.5
+#endif
+
+#ifndef ALARM_ENGINE
+#define ALARM_ENGINE 1          // 1: table-driven alarm levels with hysteresis, persistence and dwell (alarm.cpp), 0: one 2000 ppm comparison
+#endif
+
+#ifndef TASK_SCHEDULER
+#define TASK_SCHEDULER 1        // 1: loop() runs the task table in main.cpp (scheduler.cpp), 0: the original millis() gates
+#endif
+
+#ifndef PROFILE_MARKERS
+#define PROFILE_MARKERS 0       // 1: GPIOR0 scope markers for the simavr profiler (env:uno_profile)
+#endif
+
+#endif
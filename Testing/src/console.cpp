@@ -0,0 +1,196 @@
+/**
+ * @file console.cpp
+ * @brief Serial command console for field diagnostics.
+ *
+ * pollConsole() is called every 10 ms by the console task (main.cpp).
+ * It drains whatever bytes the UART has buffered, without waiting for
+ * more, and runs a command once a full line has arrived. Lines longer
+ * than CONSOLE_LINE_MAX are discarded.
+ *
+ * Commands:
+ *  - help          : list commands
+ *  - timing        : dump loop timing counters (LOOP_TIMING builds)
+ *  - timing reset  : clear loop timing counters
+ *  - tasks         : scheduler task table, lateness and idle share
+ *  - tasks reset   : clear scheduler counters
+ *  - baseline      : automatic baseline correction state
+ *  - r0            : stability-gated R0 estimator state
+ *  - drift         : CUSUM drift detector state
+ *  - kalman        : gas / drift filter state
+ *  - alarm         : alarm level table and state
+ *  - persist       : EEPROM calibration record
+ *  - fit [...]     : multi-point curve fit against a reference meter
+ *  - env [T RH]    : compensation state, or set temperature (degC) and RH (%)
+ *  - env fixed     : back to the fixed reference conditions
+ *
+ * Dependencies:
+ *  - timing.h   : loop timing report
+ *  - scheduler.h: task report
+ *  - baseline.h : baseline correction report
+ *  - r0track.h  : R0 estimator report
+ *  - drift.h    : drift detector report
+ *  - kalman.h   : filter report
+ *  - alarm.h    : alarm level report
+ *  - persist.h  : EEPROM record report
+ *  - curvefit.h : "fit" subcommands
+ *  - envcomp.h  : temperature/humidity input and report
+ */
+
+#include "console.h"
+#include "config.h"
+#include "timing.h"
+#include "scheduler.h"
+#include "baseline.h"
+#include "r0track.h"
+#include "drift.h"
+#include "kalman.h"
+#include "alarm.h"
+#include "persist.h"
+#include "curvefit.h"
+#include "envcomp.h"
+#include <stdlib.h>
+#include <string.h>
+
+static char line[CONSOLE_LINE_MAX + 1];
+static uint8_t lineLength = 0;
+static bool lineOverflow = false;
+
+//====================================================
+// Commands
+//====================================================
+
+static void printHelp() {
+    Serial.println(F("commands: help, timing, timing reset, tasks, tasks reset, baseline, r0, drift, kalman, alarm, persist, fit [PPM|save|reset|factory], env [T RH|fixed]"));
+}
+
+#if ENV_COMPENSATION
+static void runEnvCommand(const char *args) {
+    while (*args == ' ') {
+        args++;
+    }
+    if (*args == '\0') {
+        envReport();
+        return;
+    }
+    if (strcmp(args, "fixed") == 0) {
+        envSetSource(envFixedSource);
+        envService();
+        envReport();
+        return;
+    }
+    char *end;
+    float temperature = strtod(args, &end);
+    const char *rest = end;
+    float humidity = strtod(rest, &end);
+    if (end == rest || temperature < -20 || temperature > 60 || humidity < 0 || humidity > 100) {
+        Serial.println(F("env: usage env [T RH|fixed], T -20..60 degC, RH 0..100 %"));
+        return;
+    }
+    envSerialInput(temperature, humidity);
+    envService();
+    envReport();
+}
+#endif
+
+static void runCommand(const char *command) {
+    if (strcmp(command, "help") == 0) {
+        printHelp();
+    } else if (strcmp(command, "timing") == 0) {
+#if LOOP_TIMING
+        timingDump();
+#else
+        Serial.println(F("loop timing disabled (LOOP_TIMING=0)"));
+#endif
+    } else if (strcmp(command, "timing reset") == 0) {
+#if LOOP_TIMING
+        timingReset();
+        Serial.println(F("timing counters cleared"));
+#endif
+    } else if (strcmp(command, "tasks") == 0) {
+#if TASK_SCHEDULER
+        schedulerReport();
+#else
+        Serial.println(F("scheduler disabled (TASK_SCHEDULER=0)"));
+#endif
+    } else if (strcmp(command, "tasks reset") == 0) {
+#if TASK_SCHEDULER
+        schedulerReset();
+        Serial.println(F("task counters cleared"));
+#endif
+    } else if (strcmp(command, "baseline") == 0) {
+        baselineReport();
+    } else if (strcmp(command, "r0") == 0) {
+        r0TrackReport();
+    } else if (strcmp(command, "drift") == 0) {
+#if DRIFT_DETECTION
+        driftReport();
+#else
+        Serial.println(F("drift detection disabled (DRIFT_DETECTION=0)"));
+#endif
+    } else if (strcmp(command, "kalman") == 0) {
+#if KALMAN_FILTER
+        kalmanReport();
+#else
+        Serial.println(F("Kalman filter disabled (KALMAN_FILTER=0)"));
+#endif
+    } else if (strcmp(command, "alarm") == 0) {
+#if ALARM_ENGINE
+        alarmReport();
+#else
+        Serial.println(F("alarm engine disabled (ALARM_ENGINE=0)"));
+#endif
+    } else if (strcmp(command, "persist") == 0) {
+#if CALIBRATION_PERSIST
+        persistReport();
+#else
+        Serial.println(F("persistence disabled (CALIBRATION_PERSIST=0)"));
+#endif
+    } else if (strncmp(command, "fit", 3) == 0 && (command[3] == '\0' || command[3] == ' ')) {
+#if UNIT_CURVE
+        const char *args = command + 3;
+        while (*args == ' ') {
+            args++;
+        }
+        curveFitCommand(args);
+#else
+        Serial.println(F("curve fitting disabled (UNIT_CURVE=0)"));
+#endif
+    } else if (strncmp(command, "env", 3) == 0 && (command[3] == '\0' || command[3] == ' ')) {
+#if ENV_COMPENSATION
+        runEnvCommand(command + 3);
+#else
+        Serial.println(F("compensation disabled (ENV_COMPENSATION=0)"));
+#endif
+    } else {
+        Serial.print(F("unknown command: "));
+        Serial.println(command);
+        printHelp();
+    }
+}
+
+//====================================================
+// Line Input
+//====================================================
+
+/**
+ * @brief Reads pending serial input and runs completed command lines.
+ *
+ * Non-blocking: returns as soon as the receive buffer is empty.
+ */
+void pollConsole() {
+    while (Serial.available() > 0) {
+        char c = (char)Serial.read();
+        if (c == '\r' || c == '\n') {
+            line[lineLength] = '\0';
+            if (lineLength > 0 && !lineOverflow) {
+                runCommand(line);
+            }
+            lineLength = 0;
+            lineOverflow = false;
+        } else if (lineLength < CONSOLE_LINE_MAX) {
+            line[lineLength++] = c;
+        } else {
+            lineOverflow = true;
+        }
+    }
+}
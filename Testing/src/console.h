@@ -0,0 +1,16 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <Arduino.h>
+
+//---------------------------
+// Serial command console
+//---------------------------
+// Line-oriented commands typed into the serial monitor (newline or
+// carriage return terminated), e.g. "timing" or "help".
+
+const uint8_t CONSOLE_LINE_MAX = 32;
+
+void pollConsole();
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef CURVE_H
+#define CURVE_H
+
+#include <math.h>
+#include "config.h"
+#include "fixedmath.h"
+
+//---------------------------
+// CO2 calibration curves
+//---------------------------
+// PPM = 400 * (k / (Rs/R0))^n, i.e. Rs/R0 = k at 400 ppm in clean air.
+// Each curve is a policy type whose coefficients are constant
+// expressions; code is written against ActiveCurve (selected by
+// CO2_CURVE in config.h), so the compiler folds the chosen k and n into
+// every call site and the other curve never reaches the image.
+//
+// With UNIT_CURVE (off by default), ActiveCurve is instead CurveUnit:
+// k and n are this unit's own coefficients from the on-device fit
+// (curvefit.cpp), kept in RAM and EEPROM, and FactoryCurve only provides
+// their initial values. Every call site then loads them from RAM, so the
+// folding above is lost; enable it only on units that are fitted.
+
+// Empirical fit, see test/CO2_testing.ipynb.
+struct CurveRatio18 {
+    static constexpr float cleanAirRatio() { return 1.8f; }
+    static constexpr float exponent() { return 10.0f; }
+};
+
+// Rs/R0 = 1.09 * (PPM/400)^(-0.255), exponent 1/0.255.
+struct CurveRatio109 {
+    static constexpr float cleanAirRatio() { return 1.09f; }
+    static constexpr float exponent() { return 3.9216f; }
+};
+
+#if CO2_CURVE == 0
+typedef CurveRatio18 FactoryCurve;
+#elif CO2_CURVE == 1
+typedef CurveRatio109 FactoryCurve;
+#elif CO2_CURVE == 2
+// Written by tools/fitcurve.cpp from reference logs or recorded traces.
+// The checked-in one is a fit of a simulator recording:
+//   sim --record cal.mqtr --record-rate 10 --hours 1 --ambient 400 --seed 7
+//       --gas 600:800:600 --gas 1500:1500:600 --gas 2400:3000:600
+//   fitcurve --header src/curve_generated.h
+//       "cal.mqtr@60-550:400,750-1150:800,1650-2050:1500,2550-2950:3000"
+#include "curve_generated.h"
+typedef CurveGenerated FactoryCurve;
+#else
+#error "CO2_CURVE must be 0 (CurveRatio18), 1 (CurveRatio109) or 2 (CurveGenerated)"
+#endif
+
+#if UNIT_CURVE
+extern float unitCleanAirRatio;     // FactoryCurve's until curveFitLoad() finds a fit
+extern float unitCurveExponent;
+
+struct CurveUnit {
+    static float cleanAirRatio() { return unitCleanAirRatio; }
+    static float exponent() { return unitCurveExponent; }
+};
+
+typedef CurveUnit ActiveCurve;
+#else
+typedef FactoryCurve ActiveCurve;
+#endif
+
+/**
+ * @brief PPM for a normalized resistance Rs/R0 (float reference path).
+ */
+template <class Curve>
+inline float curvePPM(float ratio) {
+    return (ratio > 0) ? 400.0f * pow(Curve::cleanAirRatio() / ratio, Curve::exponent()) : 0.0f;
+}
+
+/**
+ * @brief R0 implied by an Rs measured in clean air (400 ppm).
+ */
+template <class Curve>
+inline float curveR0(float rsClean) {
+    return rsClean / Curve::cleanAirRatio();
+}
+
+/**
+ * @brief The curve exponent in Q16.16 (same rounding as floatToQ16()).
+ *
+ * A constant for the constexpr curves, one multiply for CurveUnit.
+ */
+template <class Curve>
+constexpr q16_t curveExponentQ16() {
+    return (q16_t)(Curve::exponent() * Q16_ONE + 0.5f);
+}
+
+#endif
@@ -0,0 +1,16 @@
+// Generated by tools/fitcurve.cpp -- do not edit; rerun the fitter instead.
+// Sensor cal (cal.mqtr@60-550:400,750-1150:800,1650-2050:1500,2550-2950:3000): 16900 readings, 4 reference points, RL 20.00 kOhm
+// power law: R^2 0.99609, PPM residual rms 0.06 %, max 0.10 %
+// Selected with CO2_CURVE=2 (src/curve.h).
+
+#ifndef CURVE_GENERATED_H
+#define CURVE_GENERATED_H
+
+#include <stdint.h>
+
+struct CurveGenerated {
+    static constexpr float cleanAirRatio() { return 1.799947f; }
+    static constexpr float exponent() { return 9.997326f; }
+};
+
+#endif
@@ -0,0 +1,296 @@
+/**
+ * @file curvefit.cpp
+ * @brief Per-unit calibration curve fitted on the device over serial.
+ *
+ * The curve constants in curve.h were hand-fitted to three points of one
+ * sensor (test/CO2_testing.ipynb). Each MQ-135 differs, so this module
+ * fits k and n of PPM = 400 * (k / (Rs/R0))^n for the unit at hand,
+ * against a reference meter:
+ *
+ *    fit 400         record the current air as 400 ppm (30 s)
+ *    fit 1000        ... as 1000 ppm, and so on for more points
+ *    fit             show the accumulated fit
+ *    fit save        apply k and n and store them in EEPROM
+ *    fit reset       discard the recorded points
+ *    fit factory     go back to the curve.h constants
+ *
+ * In log space the power law is a straight line:
+ *
+ *    ln Rs = a + b * ln(PPM / 400),   n = -1 / b,   k = e^a / R0
+ *
+ * so every 1 s reading while a point is recorded adds one (x, y) pair to
+ * an incremental least-squares accumulator. It keeps means and centred
+ * co-moments (Welford), O(1) per reading and 24 bytes, without the
+ * cancellation raw sums of squares would suffer in float.
+ *
+ * k is taken relative to the R0 in use at "fit save", so the saved curve
+ * reproduces the fitted Rs(PPM) exactly, and later clean-air calibrations
+ * keep dividing by the unit's own k. R0 is persisted in the same step.
+ * While a session is open (first point until save, reset or factory),
+ * r0track.cpp holds off: the reference gas is not drift.
+ *
+ * A fit is only applied with at least two points at least 2x apart in
+ * concentration, R^2 >= CURVE_FIT_MIN_R2 and k, n inside plausible bounds.
+ *
+ * Dependencies:
+ *  - globals.h : R0, unitCleanAirRatio, unitCurveExponent (curve.h)
+ *  - utils.h   : calculateRs()
+ *  - lut.h     : table invalidated when the curve changes
+ *  - r0track.h : implied-R0 window restarted when k changes
+ *  - persist.h : CRC-16, save of the matching R0
+ *
+ * EEPROM:
+ *  - One record at CURVE_FIT_ADDR, written only by "fit save"/"fit factory"
+ */
+
+#include "curvefit.h"
+#include "config.h"
+#include "globals.h"
+#include "utils.h"
+#include "lut.h"
+#include "r0track.h"
+#include "persist.h"
+#include <EEPROM.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if UNIT_CURVE
+
+struct CurveFitRecord {
+    uint16_t magic;
+    float cleanAirRatio;
+    float exponent;
+    uint16_t crc;
+};
+
+static const uint8_t RECORD_CRC_BYTES = offsetof(CurveFitRecord, crc);
+
+// Least-squares accumulator, x = ln(PPM/400), y = ln(Rs)
+static uint16_t fitCount = 0;
+static float meanX = 0;
+static float meanY = 0;
+static float cxx = 0;
+static float cxy = 0;
+static float cyy = 0;
+
+static uint8_t fitPoints = 0;
+static float lowestPPM = 0;
+static float highestPPM = 0;
+static float pointX = 0;                // x of the point being recorded
+static uint8_t pointSecondsLeft = 0;
+static bool sessionOpen = false;        // from the first point until save/reset/factory
+
+//====================================================
+// Accumulator
+//====================================================
+
+static void fitAdd(float x, float y) {
+    fitCount++;
+    float dx = x - meanX;
+    float dy = y - meanY;
+    meanX += dx / fitCount;
+    meanY += dy / fitCount;
+    cxx += dx * (x - meanX);
+    cxy += dx * (y - meanY);
+    cyy += dy * (y - meanY);
+}
+
+static void fitReset() {
+    sessionOpen = false;
+    fitCount = 0;
+    meanX = meanY = 0;
+    cxx = cxy = cyy = 0;
+    fitPoints = 0;
+    pointSecondsLeft = 0;
+}
+
+/**
+ * @brief Solves the accumulated fit.
+ *
+ * Returns:
+ *  @return bool - false if there is too little data to solve at all
+ */
+static bool fitSolve(float *ratio, float *exponent, float *r2) {
+    if (fitPoints < 2 || cxx <= 0 || cyy <= 0) {
+        return false;
+    }
+    float b = cxy / cxx;
+    if (b >= 0) {
+        return false;                   // Rs must fall as PPM rises
+    }
+    float a = meanY - b * meanX;
+    *exponent = -1.0f / b;
+    *ratio = exp(a) / R0;
+    *r2 = (cxy * cxy) / (cxx * cyy);
+    return true;
+}
+
+static bool fitAcceptable(float ratio, float exponent, float r2) {
+    return log(highestPPM / lowestPPM) >= CURVE_FIT_MIN_SPAN
+        && r2 >= CURVE_FIT_MIN_R2
+        && ratio >= CURVE_FIT_RATIO_MIN && ratio <= CURVE_FIT_RATIO_MAX
+        && exponent >= CURVE_FIT_EXPONENT_MIN && exponent <= CURVE_FIT_EXPONENT_MAX;
+}
+
+//====================================================
+// Coefficients
+//====================================================
+
+static void applyCurve(float ratio, float exponent) {
+    unitCleanAirRatio = ratio;
+    unitCurveExponent = exponent;
+    lutInvalidate();                    // the table holds the old curve
+    r0TrackReset();                     // and the window R0 implied by the old k
+}
+
+static void writeRecord(const CurveFitRecord &record) {
+    const uint8_t *bytes = (const uint8_t *)&record;
+    for (uint8_t i = 0; i < sizeof(CurveFitRecord); i++) {
+        EEPROM.update(CURVE_FIT_ADDR + i, bytes[i]);
+    }
+}
+
+static void printCurve(float ratio, float exponent) {
+    Serial.print(F(" k ")); Serial.print(ratio, 4);
+    Serial.print(F(" n ")); Serial.print(exponent, 4);
+}
+
+static void report() {
+    Serial.print(F("fit: active")); printCurve(unitCleanAirRatio, unitCurveExponent);
+    Serial.print(F(" | points ")); Serial.print(fitPoints);
+    Serial.print(F(" readings ")); Serial.print(fitCount);
+    float ratio, exponent, r2;
+    if (fitSolve(&ratio, &exponent, &r2)) {
+        Serial.print(F(" | fitted")); printCurve(ratio, exponent);
+        Serial.print(F(" R2 ")); Serial.print(r2, 4);
+        Serial.print(fitAcceptable(ratio, exponent, r2) ? F(" ok") : F(" rejected"));
+    }
+    if (pointSecondsLeft > 0) {
+        Serial.print(F(" | recording, ")); Serial.print(pointSecondsLeft); Serial.print(F(" s left"));
+    }
+    Serial.println();
+}
+
+static void save() {
+    float ratio, exponent, r2;
+    if (!fitSolve(&ratio, &exponent, &r2) || !fitAcceptable(ratio, exponent, r2)) {
+        Serial.println(F("fit: not saved (need 2+ points 2x apart, R2 >= 0.95, plausible k/n)"));
+        return;
+    }
+    CurveFitRecord record;
+    record.magic = CURVE_FIT_MAGIC;
+    record.cleanAirRatio = ratio;
+    record.exponent = exponent;
+    record.crc = persistCrc16((const uint8_t *)&record, RECORD_CRC_BYTES);
+    writeRecord(record);
+    applyCurve(ratio, exponent);
+    fitReset();
+#if CALIBRATION_PERSIST
+    persistRequestSave();               // k is relative to the current R0: store them together
+#endif
+    Serial.print(F("fit: saved")); printCurve(ratio, exponent);
+    Serial.println();
+}
+
+//====================================================
+// Public Interface
+//====================================================
+
+/**
+ * @brief Loads this unit's fitted curve from EEPROM; call once in setup().
+ *
+ * Keeps the FactoryCurve values if no valid record exists.
+ */
+void curveFitLoad() {
+    CurveFitRecord record;
+    uint8_t *bytes = (uint8_t *)&record;
+    for (uint8_t i = 0; i < sizeof(CurveFitRecord); i++) {
+        bytes[i] = EEPROM.read(CURVE_FIT_ADDR + i);
+    }
+    if (record.magic != CURVE_FIT_MAGIC
+        || record.crc != persistCrc16(bytes, RECORD_CRC_BYTES)
+        || !(record.cleanAirRatio >= CURVE_FIT_RATIO_MIN && record.cleanAirRatio <= CURVE_FIT_RATIO_MAX)
+        || !(record.exponent >= CURVE_FIT_EXPONENT_MIN && record.exponent <= CURVE_FIT_EXPONENT_MAX)) {
+        Serial.print(F("Curve: factory")); printCurve(unitCleanAirRatio, unitCurveExponent);
+        Serial.println();
+        return;
+    }
+    applyCurve(record.cleanAirRatio, record.exponent);
+    Serial.print(F("Curve: unit fit")); printCurve(unitCleanAirRatio, unitCurveExponent);
+    Serial.println();
+}
+
+/**
+ * @brief Feeds one averaged reading; call once per second.
+ *
+ * Does nothing unless a reference point is being recorded.
+ *
+ * Parameters:
+ *  @param code Moving-average ADC code (0-1023)
+ */
+void curveFitUpdate(float code) {
+    if (pointSecondsLeft == 0 || code <= 0 || code >= 1023) {
+        return;
+    }
+    fitAdd(pointX, log(calculateRs(code * (5.0 / 1023.0))));
+    if (--pointSecondsLeft == 0) {
+        fitPoints++;
+        Serial.print(F("fit: point ")); Serial.print(fitPoints);
+        Serial.println(F(" recorded"));
+    }
+}
+
+/**
+ * @brief Reports whether a fit session is open.
+ *
+ * Reference gas is held deliberately during a session, so automatic R0
+ * corrections must not mistake it for drift.
+ */
+bool curveFitActive() {
+    return sessionOpen;
+}
+
+/**
+ * @brief Runs a "fit ..." console command.
+ *
+ * Parameters:
+ *  @param args Text after "fit", leading spaces skipped
+ */
+void curveFitCommand(const char *args) {
+    if (*args == '\0') {
+        report();
+    } else if (strcmp(args, "save") == 0) {
+        save();
+    } else if (strcmp(args, "reset") == 0) {
+        fitReset();
+        Serial.println(F("fit: points discarded"));
+    } else if (strcmp(args, "factory") == 0) {
+        CurveFitRecord blank;
+        memset(&blank, 0xFF, sizeof(blank));
+        writeRecord(blank);
+        applyCurve(FactoryCurve::cleanAirRatio(), FactoryCurve::exponent());
+        fitReset();
+        Serial.print(F("fit: factory")); printCurve(unitCleanAirRatio, unitCurveExponent);
+        Serial.println();
+    } else {
+        float ppm = atof(args);
+        if (ppm < 100 || ppm > 10000 || pointSecondsLeft > 0) {
+            Serial.println(F("fit: usage fit [PPM|save|reset|factory], PPM 100-10000, one point at a time"));
+            return;
+        }
+        if (fitPoints == 0 && fitCount == 0) {
+            lowestPPM = highestPPM = ppm;
+        }
+        if (ppm < lowestPPM) lowestPPM = ppm;
+        if (ppm > highestPPM) highestPPM = ppm;
+        sessionOpen = true;
+        pointX = log(ppm / 400.0f);
+        pointSecondsLeft = CURVE_FIT_POINT_SECONDS;
+        Serial.print(F("fit: recording ")); Serial.print(ppm, 0);
+        Serial.print(F(" ppm for ")); Serial.print(CURVE_FIT_POINT_SECONDS); Serial.println(F(" s"));
+    }
+}
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef CURVEFIT_H
+#define CURVEFIT_H
+
+#include <Arduino.h>
+
+//---------------------------
+// On-device multi-point curve fit (UNIT_CURVE)
+//---------------------------
+const uint16_t CURVE_FIT_ADDR = 768;            // EEPROM record, after the persist slots
+const uint16_t CURVE_FIT_MAGIC = 0xF17C;
+const uint8_t CURVE_FIT_POINT_SECONDS = 30;     // 1 s readings averaged per reference point
+const float CURVE_FIT_MIN_SPAN = 0.69;          // ln(highest/lowest reference): at least 2x apart
+const float CURVE_FIT_MIN_R2 = 0.95;            // reject fits that explain less of the variance
+const float CURVE_FIT_RATIO_MIN = 0.2;          // plausible k ...
+const float CURVE_FIT_RATIO_MAX = 10.0;
+const float CURVE_FIT_EXPONENT_MIN = 1.0;       // ... and n
+const float CURVE_FIT_EXPONENT_MAX = 20.0;
+
+void curveFitLoad();
+void curveFitUpdate(float code);
+bool curveFitActive();
+void curveFitCommand(const char *args);
+
+#endif
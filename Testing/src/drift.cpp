@@ -0,0 +1,186 @@
+/**
+ * @file drift.cpp
+ * @brief Sequential change-point detector for slow sensor drift.
+ *
+ * Replaces the flat "one reading 10 % off originalR0" test of
+ * quickRecalibrationCheck(), which missed slow drift and tripped on noise.
+ *
+ * Every second the averaged reading is turned into its implied R0
+ * (Rs / k of the active curve) and compared, in log units, with the R0
+ * in force at the last calibration:
+ *
+ *    e = ln(implied R0) - ln(reference R0)
+ *
+ * Page's two-sided CUSUM accumulates the part of e beyond half the
+ * smallest drift of interest (k = DRIFT_MIN_SHIFT / 2):
+ *
+ *    S+ = max(0, S+ + e - k),  S- = max(0, S- - e - k)
+ *
+ * and flags drift when either sum exceeds DRIFT_THRESHOLD. Noise averages
+ * out below k, while a sustained shift d is found after about
+ * DRIFT_THRESHOLD / (|d| - k) seconds (17 s for 5 %), and a 5 %/h ramp
+ * after ~25 min.
+ *
+ * Drift and gas both move Rs; what separates them is speed. A slow level
+ * (EWMA, DRIFT_SLOW_SECONDS) follows drift with a lag of a fraction of a
+ * percent, while a plume or a ramp of gas pulls the reading away from it
+ * within a minute. Readings more than DRIFT_GAS_EXCURSION from the slow
+ * level, and DRIFT_GAS_HOLDOFF seconds after, are not fed to the CUSUM
+ * and do not move the slow level. A reading that stays away for
+ * DRIFT_GAS_MAX seconds is no plume: the slow level jumps to it and the
+ * CUSUM judges the new level (a drift step, found after the hold time).
+ * Alarms, calibrations and curve-fit reference points are treated as
+ * excursions too.
+ *
+ * The flag latches until driftReset(), which a completed calibration or
+ * an R0 re-estimation calls. Smaller R0 corrections (the automatic
+ * baseline) move the reference with them through driftRebase(), so the
+ * detector does not count a drift that R0 has already absorbed.
+ * driftMagnitude() is the slow level relative to the reference, so it is
+ * valid with or without the flag.
+ *
+ * Dependencies:
+ *  - globals.h : R0, isWarningActive (and curve.h)
+ *  - utils.h   : calculateRs()
+ *  - calib.h   : calibrationActive()
+ *  - trace.h   : detection trace point for the simulator
+ *  - curvefit.h: reference gas is not drift
+ *
+ * Cost: one log() and a handful of float operations per second.
+ */
+
+#include "drift.h"
+#include "globals.h"
+#include "utils.h"
+#include "calib.h"
+#include "trace.h"
+#include "curvefit.h"
+#include <math.h>
+
+static bool hasReference = false;
+static float reference = 0;                 // ln(R0) at the last reset
+static float slow = 0;                      // slow level of ln(implied R0)
+static float sumUp = 0;                     // S+
+static float sumDown = 0;                   // S-
+static uint16_t excursionSeconds = 0;
+static uint8_t holdoff = 0;
+static bool detected = false;
+
+//====================================================
+// Public Interface
+//====================================================
+
+/**
+ * @brief Feeds one averaged reading; call once per second.
+ *
+ * Parameters:
+ *  @param code Moving-average ADC code (0-1023)
+ */
+void driftUpdate(float code) {
+    if (code <= 0 || code >= 1023 || R0 <= 0) {
+        return;
+    }
+    float x = log(curveR0<ActiveCurve>(calculateRs(code * (5.0 / 1023.0))));
+    if (!hasReference) {
+        reference = log(R0);
+        slow = x;
+        hasReference = true;
+    }
+
+    bool excluded = isWarningActive || calibrationActive();
+#if UNIT_CURVE
+    excluded = excluded || curveFitActive();
+#endif
+    if (excluded) {
+        holdoff = DRIFT_GAS_HOLDOFF;
+        return;
+    }
+    if (fabs(x - slow) > DRIFT_GAS_EXCURSION) {
+        if (++excursionSeconds < DRIFT_GAS_MAX) {
+            holdoff = DRIFT_GAS_HOLDOFF;
+            return;
+        }
+        slow = x;                           // held too long for gas: a new level
+    }
+    excursionSeconds = 0;
+    slow += (x - slow) / DRIFT_SLOW_SECONDS;
+    if (holdoff > 0) {
+        holdoff--;
+        return;
+    }
+
+    const float k = DRIFT_MIN_SHIFT / 2;
+    float e = x - reference;
+    sumUp += e - k;
+    sumDown += -e - k;
+    if (sumUp < 0) {
+        sumUp = 0;
+    }
+    if (sumDown < 0) {
+        sumDown = 0;
+    }
+    if (detected || (sumUp <= DRIFT_THRESHOLD && sumDown <= DRIFT_THRESHOLD)) {
+        return;
+    }
+
+    detected = true;
+    traceEvent(TRACE_DRIFT_DETECTED);
+    Serial.print(F("Sensor drift detected: "));
+    Serial.print(driftMagnitude() * 100, 1);
+    Serial.println(F(" % of R0"));
+}
+
+/**
+ * @brief Starts over against the current R0 (after a calibration).
+ */
+void driftReset() {
+    hasReference = false;
+    sumUp = 0;
+    sumDown = 0;
+    excursionSeconds = 0;
+    holdoff = 0;
+    detected = false;
+}
+
+/**
+ * @brief Keeps the reference on R0 when R0 is scaled by r0Ratio (new / old).
+ */
+void driftRebase(float r0Ratio) {
+    if (hasReference && r0Ratio > 0) {
+        reference += log(r0Ratio);
+    }
+}
+
+bool driftDetected() {
+    return detected;
+}
+
+/**
+ * @brief Reports whether the last reading was set aside as gas.
+ *
+ * True during an excursion from the slow level and its holdoff, so other
+ * R0 estimators can tell a gas level that arrived fast from drift.
+ */
+bool driftExcursion() {
+    return !hasReference || excursionSeconds > 0 || holdoff > 0;
+}
+
+/**
+ * @brief Estimated drift as a fraction of the reference R0 (+0.05 = Rs 5 % high).
+ */
+float driftMagnitude() {
+    return hasReference ? exp(slow - reference) - 1 : 0;
+}
+
+/**
+ * @brief Prints the detector state (console command "drift").
+ */
+void driftReport() {
+    Serial.print(F("drift ")); Serial.print(detected ? F("DETECTED") : F("none"));
+    Serial.print(F(" magnitude ")); Serial.print(driftMagnitude() * 100, 2);
+    Serial.print(F(" % S+ ")); Serial.print(sumUp, 3);
+    Serial.print(F(" S- ")); Serial.print(sumDown, 3);
+    Serial.print(F(" h ")); Serial.print(DRIFT_THRESHOLD, 2);
+    Serial.print(F(" excursion ")); Serial.print(excursionSeconds);
+    Serial.print(F(" s holdoff ")); Serial.println(holdoff);
+}
@@ -0,0 +1,24 @@
+#ifndef DRIFT_H
+#define DRIFT_H
+
+#include <Arduino.h>
+
+//---------------------------
+// Sequential drift detector (two-sided CUSUM)
+//---------------------------
+const float DRIFT_MIN_SHIFT = 0.03;         // smallest drift of interest (3 % of R0, log units)
+const float DRIFT_THRESHOLD = 0.6;          // CUSUM decision level h (log units x seconds)
+const float DRIFT_SLOW_SECONDS = 256;       // slow level: EWMA time constant
+const float DRIFT_GAS_EXCURSION = 0.02;     // |reading - slow level| > 2 %: a gas event, not drift
+const uint8_t DRIFT_GAS_HOLDOFF = 60;       // seconds ignored after an excursion ends
+const uint16_t DRIFT_GAS_MAX = 900;         // an excursion held 15 min is a level shift
+
+void driftUpdate(float code);
+void driftReset();
+void driftRebase(float r0Ratio);
+bool driftDetected();
+bool driftExcursion();
+float driftMagnitude();
+void driftReport();
+
+#endif
@@ -0,0 +1,187 @@
+/**
+ * @file envcomp.cpp
+ * @brief Temperature and humidity compensation between Rs and PPM.
+ *
+ * MQ-135 resistance depends on temperature and humidity as well as on
+ * gas: between 10 and 30 degC the same air reads very differently (see
+ * test/mq135lib_test.cpp). The MQ135 library's correction, which the
+ * abandoned test/src_lib(failed) tree called with constant 20 degC /
+ * 50 %RH on every reading, is
+ *
+ *    t < 20:  f = a t^2 - b t + c - (h - 33) d
+ *    t >= 20: f = e t + g h + i
+ *
+ * and Rs is divided by f (f = 1 at 20 degC, 33 %RH).
+ *
+ * Instead of evaluating that per reading, envService() reads the active
+ * source once per second and recomputes f only when the temperature or
+ * humidity moved past ENV_DELTA_TEMPERATURE / ENV_DELTA_HUMIDITY since
+ * the last evaluation. The hot path pays one multiply: calculateRs()
+ * scales by the cached 1/f (envRsScale()), and the fixed-point PPM path
+ * folds it into its per-R0 scale. A new factor invalidates the PPM table.
+ *
+ * Because every Rs goes through the same stage, R0 from calibration,
+ * the baseline and r0track is the R0 at the reference conditions, and a
+ * calibration on a hot day stays valid on a cold one.
+ *
+ * Sources (envSetSource()):
+ *  - envFixedSource  : ENV_FIXED_TEMPERATURE / ENV_FIXED_HUMIDITY (default;
+ *                      the reference conditions, i.e. no correction)
+ *  - envSerialSource : values from the "env T RH" console command, for
+ *                      ENV_SERIAL_TIMEOUT after the last one; then the
+ *                      fixed reference conditions again, so a host that
+ *                      stops sending does not leave its correction applied
+ *  - anything else with the EnvSource signature, e.g. the simulator's
+ *    environment model in the native build
+ * An unavailable source leaves the last factor in place.
+ *
+ * Dependencies:
+ *  - lut.h : table invalidated when the factor changes
+ */
+
+#include "envcomp.h"
+#include "lut.h"
+#include <math.h>
+
+// MQ135 library (phoenix1747) temperature/humidity dependency
+static const float COR_A = 0.00035;
+static const float COR_B = 0.02718;
+static const float COR_C = 1.39538;
+static const float COR_D = 0.0018;
+static const float COR_E = -0.003333333;
+static const float COR_G = -0.001923077;
+static const float COR_I = 1.130128205;
+
+static EnvSource activeSource = envFixedSource;
+static float factorTemperature = ENV_REFERENCE_TEMPERATURE;  // inputs of the cached factor
+static float factorHumidity = ENV_REFERENCE_HUMIDITY;
+static float factor = 1.0;                                  // cached f
+static float rsScale = 1.0;                                  // cached 1 / f
+static bool factorValid = false;
+static uint16_t factorUpdates = 0;
+
+static float serialTemperature = 0;
+static float serialHumidity = 0;
+static unsigned long serialTime = 0;
+static bool serialReceived = false;
+
+//====================================================
+// Sources
+//====================================================
+
+bool envFixedSource(float *temperature, float *humidity) {
+    *temperature = ENV_FIXED_TEMPERATURE;
+    *humidity = ENV_FIXED_HUMIDITY;
+    return true;
+}
+
+static bool serialFresh() {
+    return serialReceived && millis() - serialTime < ENV_SERIAL_TIMEOUT;
+}
+
+bool envSerialSource(float *temperature, float *humidity) {
+    if (!serialFresh()) {
+        return envFixedSource(temperature, humidity);   // stale: back to the reference conditions
+    }
+    *temperature = serialTemperature;
+    *humidity = serialHumidity;
+    return true;
+}
+
+//====================================================
+// Public Interface
+//====================================================
+
+/**
+ * @brief Correction factor f for Rs at the given conditions.
+ *
+ * Parameters:
+ *  @param temperature degC
+ *  @param humidity    relative humidity, %
+ */
+float envCorrectionFactor(float temperature, float humidity) {
+    if (temperature < 20) {
+        return COR_A * temperature * temperature - COR_B * temperature + COR_C
+             - (humidity - 33) * COR_D;
+    }
+    return COR_E * temperature + COR_G * humidity + COR_I;
+}
+
+/**
+ * @brief Selects where temperature and humidity come from.
+ */
+void envSetSource(EnvSource source) {
+    activeSource = source ? source : envFixedSource;
+    factorValid = false;
+}
+
+/**
+ * @brief Stores values typed on the console and switches to them.
+ */
+void envSerialInput(float temperature, float humidity) {
+    serialTemperature = temperature;
+    serialHumidity = humidity;
+    serialTime = millis();
+    serialReceived = true;
+    envSetSource(envSerialSource);
+}
+
+/**
+ * @brief Polls the source and refreshes the factor if needed; call once per second.
+ */
+void envService() {
+    float temperature, humidity;
+    if (!activeSource(&temperature, &humidity)) {
+        return;
+    }
+    if (factorValid
+        && fabs(temperature - factorTemperature) <= ENV_DELTA_TEMPERATURE
+        && fabs(humidity - factorHumidity) <= ENV_DELTA_HUMIDITY) {
+        return;
+    }
+    float newFactor = envCorrectionFactor(temperature, humidity);
+    if (newFactor <= 0) {
+        return;                             // far outside the fitted range
+    }
+    factorTemperature = temperature;
+    factorHumidity = humidity;
+    factorValid = true;
+    factorUpdates++;
+    if (newFactor != factor) {
+        factor = newFactor;
+        rsScale = 1.0 / newFactor;
+        lutInvalidate();
+    }
+}
+
+/**
+ * @brief Multiplier that maps a measured Rs to the reference conditions (1 / f).
+ */
+float envRsScale() {
+    return rsScale;
+}
+
+/**
+ * @brief The cached correction factor f (Rs at these conditions / at reference).
+ */
+float envFactor() {
+    return factor;
+}
+
+/**
+ * @brief Prints the compensation state (console command "env").
+ */
+void envReport() {
+    Serial.print(F("env source "));
+    if (activeSource == envFixedSource) {
+        Serial.print(F("fixed"));
+    } else if (activeSource == envSerialSource) {
+        Serial.print(serialFresh() ? F("serial") : F("serial (expired, fixed)"));
+    } else {
+        Serial.print(F("external"));
+    }
+    Serial.print(F(" T ")); Serial.print(factorTemperature, 1);
+    Serial.print(F(" RH ")); Serial.print(factorHumidity, 1);
+    Serial.print(F(" factor ")); Serial.print(factor, 4);
+    Serial.print(F(" updates ")); Serial.println(factorUpdates);
+}
@@ -0,0 +1,31 @@
+#ifndef ENVCOMP_H
+#define ENVCOMP_H
+
+#include <Arduino.h>
+
+//---------------------------
+// Temperature / humidity compensation
+//---------------------------
+const float ENV_REFERENCE_TEMPERATURE = 20.0;   // conditions with correction factor 1
+const float ENV_REFERENCE_HUMIDITY = 33.0;
+const float ENV_FIXED_TEMPERATURE = ENV_REFERENCE_TEMPERATURE;  // "fixed" source
+const float ENV_FIXED_HUMIDITY = ENV_REFERENCE_HUMIDITY;
+const float ENV_DELTA_TEMPERATURE = 0.5;        // recompute the factor past 0.5 degC ...
+const float ENV_DELTA_HUMIDITY = 2.0;           // ... or 2 %RH
+const unsigned long ENV_SERIAL_TIMEOUT = 10UL * 60 * 1000;  // serial values expire after 10 min
+
+// Reads temperature (degC) and relative humidity (%); false if unavailable.
+typedef bool (*EnvSource)(float *temperature, float *humidity);
+
+bool envFixedSource(float *temperature, float *humidity);
+bool envSerialSource(float *temperature, float *humidity);
+
+void envSetSource(EnvSource source);
+void envSerialInput(float temperature, float humidity);
+void envService();
+float envRsScale();
+float envFactor();
+float envCorrectionFactor(float temperature, float humidity);
+void envReport();
+
+#endif
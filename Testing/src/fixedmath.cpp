@@ -0,0 +1,226 @@
+/**
+ * @file fixedmath.cpp
+ * @brief Integer log2/exp2 primitives for the fixed-point sensor pipeline.
+ *
+ * The ATmega328P has no FPU; every float multiply, divide and pow() runs
+ * as a software routine costing hundreds to thousands of cycles. The
+ * MQ-135 power law only needs logarithms and exponentials, which this
+ * module provides in Q16.16 with integer multiplies only:
+ *
+ *    PPM = 400 * (k / (Rs/R0))^n
+ *        = 2^( log2(400) + n * log2(k * R0 / Rs) )
+ *
+ * and since Rs = RL * (Vcc - V) / V, the ratio's logarithm splits into
+ * sums of logarithms of integers (ADC codes, or the voltage as a Q16
+ * fraction of Vcc). No division is needed in the per-reading path.
+ *
+ * Accuracy (see test/fixedmath_test.cpp):
+ *  - fxLog2: 16 fractional bits, error below 2^-15
+ *  - fxExp2: cubic minimax polynomial, relative error around 1e-4
+ *  - fxPowerLawPPM: 12 fractional bits of the log ratio, relative error
+ *    around 1e-3 at exponent 10
+ *
+ * Dependencies:
+ *  - stdint.h only, so the module builds unchanged on the host
+ */
+
+#include "fixedmath.h"
+
+static const uint32_t FX_SATURATED = 0xFFFFFFFFUL;
+static const q16_t FX_LOG2_ZERO = -0x7FFFFFFFL - 1;
+
+//====================================================
+// Conversions
+//====================================================
+
+/**
+ * @brief Converts a float to Q16.16 with rounding.
+ */
+q16_t floatToQ16(float value) {
+    return (q16_t)(value * Q16_ONE + (value >= 0 ? 0.5f : -0.5f));
+}
+
+/**
+ * @brief Converts a Q16.16 value to float.
+ */
+float q16ToFloat(q16_t value) {
+    return value / (float)Q16_ONE;
+}
+
+//====================================================
+// Logarithm / Exponential
+//====================================================
+
+/**
+ * @brief Base-2 logarithm of a positive integer.
+ *
+ * Integer part from the position of the most significant bit; fractional
+ * bits by repeated squaring of the normalized mantissa (each squaring
+ * that overflows [1,2) contributes the next bit). Every multiply is
+ * 16x16->32: the operands are bounded so the product fits in 32 bits
+ * and cannot overflow, and no 64-bit multiply (a slow library call on
+ * AVR) is ever needed.
+ *
+ * Parameters:
+ *  @param x Positive integer (x = 0 returns the most negative value)
+ *
+ * Returns:
+ *  @return q16_t - log2(x) in Q16.16
+ */
+q16_t fxLog2(uint32_t x) {
+    if (x == 0) {
+        return FX_LOG2_ZERO;
+    }
+
+    int8_t msb = 31;
+    while (!(x & 0x80000000UL)) {
+        x <<= 1;
+        msb--;
+    }
+
+    // Mantissa in Q1.15: [32768, 65536) represents [1, 2)
+    uint16_t m = (uint16_t)(x >> 16);
+    q16_t result = (q16_t)msb << 16;
+    for (q16_t bit = Q16_ONE >> 1; bit > 0; bit >>= 1) {
+        uint32_t sq = ((uint32_t)m * m) >> 15;
+        if (sq >= 65536UL) {
+            sq >>= 1;
+            result += bit;
+        }
+        m = (uint16_t)sq;
+    }
+    return result;
+}
+
+/**
+ * @brief Base-2 exponential, returned as a rounded integer.
+ *
+ * Splits y into integer and fractional parts; 2^frac comes from a cubic
+ * minimax polynomial evaluated in Q16 with Horner's rule, then the
+ * integer part becomes a shift.
+ *
+ * Parameters:
+ *  @param y Exponent in Q16.16
+ *
+ * Returns:
+ *  @return uint32_t - round(2^y), saturating at 0xFFFFFFFF
+ */
+uint32_t fxExp2(q16_t y) {
+    static const uint32_t C1 = 45617;   // 0.696066 in Q16
+    static const uint32_t C2 = 14713;   // 0.224494 in Q16
+    static const uint32_t C3 = 5206;    // 0.079440 in Q16
+
+    int16_t n = (int16_t)(y >> 16);     // floor, arithmetic shift
+    uint32_t f = (uint32_t)y & 0xFFFF;
+
+    uint32_t p = C3;
+    p = C2 + ((p * f) >> 16);
+    p = C1 + ((p * f) >> 16);
+    p = Q16_ONE + ((p * f) >> 16);      // 2^f in Q16, [65536, 131072)
+
+    if (n >= 31) {
+        return FX_SATURATED;
+    }
+    if (n >= 16) {
+        return p << (n - 16);
+    }
+    if (n <= -2) {
+        return 0;
+    }
+    uint8_t shift = 16 - n;
+    return (p + (1UL << (shift - 1))) >> shift;
+}
+
+/**
+ * @brief log2(numerator / denominator) for two positive integers.
+ *
+ * Parameters:
+ *  @param numerator   Positive integer
+ *  @param denominator Positive integer
+ *
+ * Returns:
+ *  @return q16_t - log2 of the quotient in Q16.16
+ */
+q16_t fxLog2Ratio(uint32_t numerator, uint32_t denominator) {
+    return fxLog2(numerator) - fxLog2(denominator);
+}
+
+/**
+ * @brief Evaluates the MQ-135 power law in the log domain.
+ *
+ * Computes 400 * 2^(exponent * log2Ratio), where log2Ratio is
+ * log2(k / (Rs/R0)) for the curve's clean-air ratio k.
+ *
+ * The product is formed from log2Ratio in Q4.12 (16 bits) and the
+ * exponent in Q5.11 (16 bits) so it fits a 32-bit result: a full Q16 x
+ * Q16 product needs 64 bits, which avr-gcc builds from a software
+ * routine. log2Ratio is clamped to +/-8 first; for exponents of 1 or
+ * more that is already beyond 2..100000 ppm.
+ *
+ * Parameters:
+ *  @param log2Ratio log2(k * R0 / Rs) in Q16.16
+ *  @param exponent  Curve exponent n in Q16.16, 1 <= n < 32
+ *
+ * Returns:
+ *  @return uint32_t - Concentration in whole PPM, saturating
+ */
+uint32_t fxPowerLawPPM(q16_t log2Ratio, q16_t exponent) {
+    static const q16_t LOG2_400 = 566484;           // log2(400) = 8.643856 in Q16
+    static const q16_t LOG2_RATIO_LIMIT = 8L << 16;
+
+    if (log2Ratio >= LOG2_RATIO_LIMIT) {
+        log2Ratio = LOG2_RATIO_LIMIT - 1;
+    } else if (log2Ratio < -LOG2_RATIO_LIMIT) {
+        log2Ratio = -LOG2_RATIO_LIMIT;
+    }
+    int16_t ratio12 = (int16_t)((log2Ratio + 8) >> 4);
+    uint16_t exponent11 = (exponent >= (32L << 16)) ? 0xFFFF : (uint16_t)((exponent + 16) >> 5);
+
+    // |ratio12 * exponent11| < 2^31 for |ratio| <= 8 and n < 32; Q23 -> Q16
+    q16_t scaled = (q16_t)(((int32_t)ratio12 * exponent11 + 64) >> 7) + LOG2_400;
+    if (scaled >= (31L << 16)) {
+        return FX_SATURATED;
+    }
+    return fxExp2(scaled);
+}
+
+/**
+ * @brief Precomputes the R0-dependent term of the sensor log ratio.
+ *
+ * Only changes when R0 does, so callers cache the result.
+ *
+ * Parameters:
+ *  @param cleanAirRatio Curve clean-air ratio k (Rs/R0 at 400 ppm)
+ *  @param r0            Baseline resistance R0 (kOhm)
+ *  @param rl            Load resistance RL (kOhm)
+ *
+ * Returns:
+ *  @return q16_t - log2(k * R0 / RL) in Q16.16
+ */
+q16_t fxLog2Scale(float cleanAirRatio, float r0, float rl) {
+    return fxLog2((uint32_t)floatToQ16(cleanAirRatio * r0 / rl)) - (16L << 16);
+}
+
+/**
+ * @brief Converts a sensor output level straight to PPM.
+ *
+ * The sensor output is given as a fraction level/fullScale of Vcc, e.g.
+ * an ADC code over 1023. With Rs/RL = (fullScale - level) / level:
+ *
+ *    log2(k * R0 / Rs) = log2(k * R0 / RL) + log2(level) - log2(fullScale - level)
+ *
+ * Parameters:
+ *  @param level     Sensor output, 0..fullScale
+ *  @param fullScale Level corresponding to Vcc
+ *  @param log2Scale Cached result of fxLog2Scale()
+ *  @param exponent  Curve exponent n in Q16.16
+ *
+ * Returns:
+ *  @return uint32_t - Concentration in whole PPM, 0 at either rail
+ */
+uint32_t fxSensorPPM(uint32_t level, uint32_t fullScale, q16_t log2Scale, q16_t exponent) {
+    if (level == 0 || level >= fullScale) {
+        return 0;
+    }
+    return fxPowerLawPPM(log2Scale + fxLog2Ratio(level, fullScale - level), exponent);
+}
@@ -0,0 +1,22 @@
+#ifndef FIXEDMATH_H
+#define FIXEDMATH_H
+
+#include <stdint.h>
+
+//---------------------------
+// Q16.16 fixed point
+//---------------------------
+typedef int32_t q16_t;
+
+const q16_t Q16_ONE = 65536;
+
+q16_t floatToQ16(float value);
+float q16ToFloat(q16_t value);
+q16_t fxLog2(uint32_t x);
+uint32_t fxExp2(q16_t y);
+q16_t fxLog2Ratio(uint32_t numerator, uint32_t denominator);
+uint32_t fxPowerLawPPM(q16_t log2Ratio, q16_t exponent);
+q16_t fxLog2Scale(float cleanAirRatio, float r0, float rl);
+uint32_t fxSensorPPM(uint32_t level, uint32_t fullScale, q16_t log2Scale, q16_t exponent);
+
+#endif
@@ -36,7 +36,7 @@
  * Safety Considerations:
  *  - PPM_THRESHOLD set conservatively for early warning (2000 ppm)
  *  - Sensor voltage threshold provides hardware-level failsafe
- *  - Buzzer control variables prevent runaway audible alerts
+ *  - Buzzer patterns either end by themselves or are stopped explicitly (buzzer.cpp)
  *  - Preheating flag ensures sensor stability before operation
  *
  * Maintenance Notes:
@@ -84,11 +84,18 @@ LiquidCrystal lcd(rs, en, d4, d5, d6, d7); // LCD object with 4-bit interface
 
 float R0 = 76.63;           // Baseline sensor resistance in clean air (kOhm) [1: Fig.3]
                             // Typical value from datasheet; calibrated at startup
-                            // Used by calculatePPM(), updated by calibrateSensor();
+                            // Used by calculatePPM(), updated through updateR0();
 const float RL = 20.0;      // Load resistance: 20 kOhm [1: Application circuit]
                             // Standard voltage divider value for MQ-135;
+#if UNIT_CURVE
+float unitCleanAirRatio = FactoryCurve::cleanAirRatio();
+                            // This unit's Rs/R0 at 400 ppm (curve.h CurveUnit)
+                            // Fitted on-device and loaded by curveFitLoad();
+float unitCurveExponent = FactoryCurve::exponent();
+                            // This unit's power-law exponent n, same source;
+#endif
 float originalR0 = 0;       // Reference R0 value from initial calibration
-                            // Used for drift detection in quickRecalibrationCheck();
+                            // Drift reference for quickRecalibrationCheck() and r0track.cpp;
 int adc = 0;                // Current ADC reading (0-1023)
                             // Updated by MQ135SensorDirectData(), used for diagnostics;
 int d0 = 0;                 // Digital output state (HIGH/LOW)
@@ -104,16 +111,17 @@ float sensor_voltage = 0.0; // Calculated sensor voltage (0-5V)
 const int SAMPLES_PER_READING = 50;             // 50-sample moving average buffer
                                                 // Provides 1-second window at 50Hz sampling
                                                 // Balances noise rejection with responsiveness
+                                                // Averaging cost is O(1); RAM is 2 bytes/sample
 
-float ppmReadings[SAMPLES_PER_READING] = {0};   // Circular buffer for PPM readings
-                                                // Updated by updatePPMReading()
-                                                // Averaged by getAveragePPM()
+uint16_t adcReadings[SAMPLES_PER_READING] = {0}; // Circular buffer of raw ADC samples
+                                                 // Storage behind sensorWindow
 
-int readingIndex = 0;                           // Current position in circular buffer
-                                                // Wraps using modulo arithmetic
+MovingAverage sensorWindow;                     // Running-sum moving average over adcReadings
+                                                // Updated by updatePPMReading()
+                                                // Read by getAveragePPM()
 
-unsigned long lastSampleTime = 0;               // Timestamp of last sensor sample
-                                                // Ensures consistent 20ms (50Hz) sampling
+unsigned long lastSampleTime = 0;               // Timestamp of last drained sensor sample
+                                                // Samples arrive at ~50Hz from the ADC sampler
 
 const unsigned long WARNING_DISPLAY_TIME = 3000;  // 3-second prominent warning display
                                                   // Attention-grabbing period before detailed view
@@ -144,28 +152,13 @@ unsigned long lastCalibrationTime = 0;  // Timestamp of last calibration
 unsigned long warningStartTime = 0;     // Timestamp when warning was activated
                                         // Used for WARNING_DISPLAY_TIME calculation
 
-// Buzzer control variables (non-blocking pattern implementation)
-unsigned long buzzerTimer = 0;      // Timestamp of last buzzer state change
-                                    // Enables precise 500ms ON / 50ms OFF timing
-
-bool buzzerState = false;           // Current buzzer output state (false=OFF, true=ON)
-                                    // Toggled by updateBuzzer() based on timing
-
-bool buzzerActive = false;          // Buzzer pattern activation flag
-                                    // Set by startBuzzer(), cleared by stopBuzzer()
-
 //============================================================================
 // Thresholds
 //============================================================================
 // Safety limits based on indoor air quality standards and sensor characteristics
 
-const int PPM_THRESHOLD = 2000;     // CO2 concentration warning threshold (ppm)
-                                    // Based on [6]:
-                                    //   - OSHA 8-hour exposure limit: 5000 ppm
-                                    //   - ASHRAE comfort guideline: 1000 ppm
-                                    //   - Conservative early warning: 2000 ppm 
-                                    //     (We use this, can be changed to 1500 if user desires.)
-                                    // Adjustable based on application requirements
+// PPM_THRESHOLD is defined in globals.h so the alarm level table can be
+// built from it at compile time
 
 const float SENSOR_VOLTAGE_THRESHOLD = 1.75; // Raw voltage failsafe threshold (V)
                                              // Provides hardware-level protection
@@ -4,6 +4,8 @@
 #include <Arduino.h>
 #include <LiquidCrystal.h>
 #include <Servo.h>
+#include "average.h"
+#include "curve.h"
 
 //---------------------------
 // Hardware Pins
@@ -23,6 +25,7 @@ extern LiquidCrystal lcd;
 //---------------------------
 extern float R0;
 extern const float RL;
+// clean-air ratio and exponent: ActiveCurve in curve.h
 extern float originalR0;  // original reference R0 for 400 ppm
 extern int adc;
 extern int d0; 
@@ -32,8 +35,8 @@ extern float sensor_voltage;
 // Timing & sampling
 //---------------------------
 extern const int SAMPLES_PER_READING;
-extern float ppmReadings[];
-extern int readingIndex;
+extern uint16_t adcReadings[];
+extern MovingAverage sensorWindow;
 extern unsigned long lastSampleTime;
 extern const unsigned long WARNING_DISPLAY_TIME; 
 extern const unsigned long RECALIBRATION_INTERVAL;
@@ -49,14 +52,16 @@ extern bool skipPreheating;
 extern unsigned long lastCalibrationTime;
 extern unsigned long warningStartTime;
 
-// Buzzer control variables
-extern unsigned long buzzerTimer;
-extern bool buzzerState;      // false=OFF, true=ON
-extern bool buzzerActive;
-
 //---------------------------
 // Thresholds
 //---------------------------
-extern const int PPM_THRESHOLD;
+const int PPM_THRESHOLD = 2000;     // CO2 concentration warning threshold (ppm)
+                                    // Based on [6]:
+                                    //   - OSHA 8-hour exposure limit: 5000 ppm
+                                    //   - ASHRAE comfort guideline: 1000 ppm
+                                    //   - Conservative early warning: 2000 ppm
+                                    //     (We use this, can be changed to 1500 if user desires.)
+                                    // Adjustable based on application requirements
+                                    // Also the CRITICAL alarm level (alarm.cpp)
 
 #endif
@@ -0,0 +1,186 @@
+/**
+ * @file kalman.cpp
+ * @brief Two-state Kalman filter separating gas from baseline drift.
+ *
+ * A moving average of PPM cannot tell a drifting R0 from a real change
+ * in CO2: both move Rs, so drift turns into false alarms. This filter
+ * tracks both causes explicitly, in log space where the sensor is linear:
+ *
+ *    c = ln(PPM / 400)          gas, relaxes to clean air (c = 0)
+ *    d = ln(drift factor of R0) random walk
+ *
+ *    z = ln(Rs / (k R0)) = -c / n + d + v        (k, n: active curve)
+ *
+ * Model, one step per processed (1 s) reading:
+ *
+ *    F = | a 0 |   a = 1 - 1 / KALMAN_GAS_RELAX_S     H = | -1/n  1 |
+ *        | 0 1 |
+ *    Q = diag(KALMAN_GAS_NOISE, KALMAN_DRIFT_NOISE),  R = KALMAN_MEASUREMENT_NOISE
+ *
+ * A single Rs cannot separate c from d; the dynamics do. Gas is fast and
+ * returns to clean air, drift is slow and stays. A plume is carried by c,
+ * and a level that persists for many relaxation times moves to d. Gas
+ * also never reads below clean air: a posterior c < 0 is drift, so it is
+ * moved into d (c = 0 with z unchanged; constrained filter by projection).
+ *
+ * The trade-off is set by KALMAN_GAS_RELAX_S and the two noises:
+ *  - a 3000 ppm plume is tracked within ~4 % for minutes, and held gas
+ *    has lost about a quarter of its log level after 30 minutes
+ *  - Rs drifting up (PPM reading low) is removed at once
+ *  - Rs drifting down (PPM reading high, the false-alarm case) is removed
+ *    with the relaxation time constant, a few times faster than
+ *    it accumulates for a 10 %/2 h drift
+ *
+ * kalmanConfidence() is the posterior probability that the concentration
+ * is above PPM_THRESHOLD, Phi((c - ln(threshold / 400)) / sigma_c), with
+ * the logistic approximation Phi(x) ~ 1 / (1 + e^(-1.702 x)). With
+ * KALMAN_ALARM_GATE, main.cpp only enters the warning state when it
+ * reaches KALMAN_GATE_CONFIDENCE; leaving it is unchanged, so held gas
+ * slowly relaxing in the filter cannot silence a running alarm.
+ *
+ * The matrices are fixed; only the symmetric 2x2 covariance (3 floats)
+ * and the state are kept. No heap, one log() and one exp() per step.
+ *
+ * d is relative to the current R0. Every R0 change (calibration,
+ * baseline step, re-estimation) goes through updateR0(), which calls
+ * kalmanRebase(). Shifting d by the log of each R0 ratio would be exact
+ * only if d had been exact; R0 moves every minute or so under drift,
+ * and the residual error of each shift piles up (a clean-air estimate
+ * of 2263 ppm after 6 h of -5 %/h drift). Since the new R0 already
+ * holds what d was estimating, the filter is instead re-anchored: d = 0,
+ * c from the last measurement against the new R0, and the covariance
+ * back to its initial values so the next readings settle it again.
+ *
+ * Dependencies:
+ *  - globals.h : R0, PPM_THRESHOLD (and curve.h: ActiveCurve)
+ *  - utils.h   : calculateRs()
+ */
+
+#include "kalman.h"
+#include "globals.h"
+#include "utils.h"
+#include <math.h>
+
+static float gasLevel = 0;                  // c
+static float drift = 0;                     // d
+static float p00 = KALMAN_INITIAL_GAS_VAR;  // covariance (symmetric)
+static float p01 = 0;
+static float p11 = KALMAN_INITIAL_DRIFT_VAR;
+static float innovation = 0;                // last z - H x, for the report
+static float lastZ = 0;                     // last measurement, against the R0 it was taken with
+static bool hasMeasurement = false;
+
+//====================================================
+// Public Interface
+//====================================================
+
+/**
+ * @brief One predict/update step; call once per second.
+ *
+ * Parameters:
+ *  @param code Moving-average ADC code (0-1023)
+ */
+void kalmanUpdate(float code) {
+    if (code <= 0 || code >= 1023 || R0 <= 0) {
+        return;
+    }
+    float z = log(calculateRs(code * (5.0 / 1023.0)) / (ActiveCurve::cleanAirRatio() * R0));
+    lastZ = z;
+    hasMeasurement = true;
+    const float a = 1 - 1 / KALMAN_GAS_RELAX_S;
+    const float h = -1 / ActiveCurve::exponent();
+
+    // Predict
+    gasLevel *= a;
+    float q00 = a * a * p00 + KALMAN_GAS_NOISE;
+    float q01 = a * p01;
+    float q11 = p11 + KALMAN_DRIFT_NOISE;
+
+    // Update
+    innovation = z - (h * gasLevel + drift);
+    float hp0 = h * q00 + q01;              // (H P)0
+    float hp1 = h * q01 + q11;              // (H P)1
+    float s = h * hp0 + hp1 + KALMAN_MEASUREMENT_NOISE;
+    float k0 = hp0 / s;
+    float k1 = hp1 / s;
+    gasLevel += k0 * innovation;
+    drift += k1 * innovation;
+    p00 = q00 - k0 * hp0;
+    p01 = q01 - k0 * hp1;
+    p11 = q11 - k1 * hp1;
+
+    if (gasLevel < 0) {
+        drift += h * gasLevel;              // below clean air: drift, same z
+        gasLevel = 0;
+    }
+}
+
+/**
+ * @brief Back to clean air, no drift, initial uncertainty.
+ */
+void kalmanReset() {
+    gasLevel = 0;
+    drift = 0;
+    p00 = KALMAN_INITIAL_GAS_VAR;
+    p01 = 0;
+    p11 = KALMAN_INITIAL_DRIFT_VAR;
+    innovation = 0;
+    hasMeasurement = false;
+}
+
+/**
+ * @brief Re-anchors the filter when R0 is scaled by r0Ratio (new / old).
+ *
+ * No drift against the new R0, gas from the last measurement taken
+ * against it, initial uncertainty.
+ */
+void kalmanRebase(float r0Ratio) {
+    if (r0Ratio <= 0 || !hasMeasurement) {
+        kalmanReset();
+        return;
+    }
+    float z = lastZ - log(r0Ratio);
+    gasLevel = -ActiveCurve::exponent() * z;
+    if (gasLevel < 0) {
+        gasLevel = 0;                       // gas never reads below clean air
+    }
+    drift = 0;
+    p00 = KALMAN_INITIAL_GAS_VAR;
+    p01 = 0;
+    p11 = KALMAN_INITIAL_DRIFT_VAR;
+    innovation = 0;
+    lastZ = z;
+}
+
+float kalmanPPM() {
+    return 400 * exp(gasLevel);
+}
+
+/**
+ * @brief Estimated drift of R0 as a fraction (-0.05 = Rs 5 % low).
+ */
+float kalmanDrift() {
+    return exp(drift) - 1;
+}
+
+/**
+ * @brief Posterior probability that the concentration exceeds PPM_THRESHOLD.
+ */
+float kalmanConfidence() {
+    float sigma = sqrt(p00);
+    float x = (gasLevel - log(PPM_THRESHOLD / 400.0)) / sigma;
+    return 1 / (1 + exp(-1.702 * x));
+}
+
+/**
+ * @brief Prints the filter state (console command "kalman").
+ */
+void kalmanReport() {
+    Serial.print(F("kalman ppm ")); Serial.print(kalmanPPM(), 1);
+    Serial.print(F(" drift ")); Serial.print(kalmanDrift() * 100, 2);
+    Serial.print(F(" % P(>")); Serial.print(PPM_THRESHOLD);
+    Serial.print(F(") ")); Serial.print(kalmanConfidence(), 3);
+    Serial.print(F(" sd c ")); Serial.print(sqrt(p00), 3);
+    Serial.print(F(" d ")); Serial.print(sqrt(p11), 4);
+    Serial.print(F(" innovation ")); Serial.println(innovation, 4);
+}
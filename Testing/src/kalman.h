@@ -0,0 +1,26 @@
+#ifndef KALMAN_H
+#define KALMAN_H
+
+#include <Arduino.h>
+
+//---------------------------
+// Concentration / drift state-space filter
+//---------------------------
+// States: c = ln(PPM / 400), d = ln(R0 drift factor); one step per second.
+const float KALMAN_GAS_NOISE = 0.1;         // Q of c: variance of ln(PPM) change per second
+const float KALMAN_DRIFT_NOISE = 3e-6;      // Q of d: random walk, ~10 % per 1 h 1-sigma
+const float KALMAN_GAS_RELAX_S = 600;       // c returns to clean air with this time constant
+const float KALMAN_MEASUREMENT_NOISE = 4e-6;    // R: variance of ln(Rs) per averaged reading
+const float KALMAN_INITIAL_GAS_VAR = 1.0;
+const float KALMAN_INITIAL_DRIFT_VAR = 1e-4;    // (1 %)^2 right after a calibration
+const float KALMAN_GATE_CONFIDENCE = 0.5;   // alarm entry needs P(PPM > threshold) >= 0.5
+
+void kalmanUpdate(float code);
+void kalmanReset();
+void kalmanRebase(float r0Ratio);
+float kalmanPPM();
+float kalmanDrift();
+float kalmanConfidence();
+void kalmanReport();
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * @file lut.cpp
+ * @brief Precomputed ADC code to PPM calibration table.
+ *
+ * calculatePPM() costs a float divide (Rs) and a pow() per call. Since the
+ * ADC only produces 1024 codes and the curve only changes when R0 does,
+ * the conversion is tabulated once per calibration and the hot path
+ * becomes a table read with linear interpolation between codes.
+ *
+ * A full 1024-entry table does not fit in the Uno's SRAM, and most of it
+ * would be wasted: below LUT_PPM_FLOOR the reading is meaningless and the
+ * power law saturates 16-bit PPM within a few dozen codes above clean air.
+ * The table therefore covers a window of LUT_SIZE consecutive codes that
+ * starts at the first code reaching LUT_PPM_FLOOR for the current R0.
+ * Codes outside the window fall back to calculatePPM().
+ *
+ * Rebuild strategy:
+ *  - lutInvalidate() is called whenever R0 changes (see updateR0())
+ *  - lutService() recomputes LUT_REBUILD_CHUNK entries per call, so a
+ *    rebuild is spread over several loop passes instead of stalling one
+ *  - Until the rebuild completes, lookups use calculatePPM() directly
+ *
+ * The table is built from calculatePPMFromCode(), which evaluates the
+ * compile-time ActiveCurve (curve.h), so it needs no curve state of its own.
+ *
+ * Dependencies:
+ *  - utils.h : calculatePPMFromCode(), calculatePPM()
+ *
+ * Memory:
+ *  - LUT_SIZE x 2 bytes (entries are PPM saturated to 65535)
+ */
+
+#include "lut.h"
+#include "utils.h"
+#include "profile.h"
+
+//====================================================
+// Table State
+//====================================================
+
+static const uint16_t LUT_PPM_MAX = 65535;
+
+static uint16_t ppmTable[LUT_SIZE];
+static uint16_t lutBaseCode = 0;     // ADC code of ppmTable[0]
+static uint8_t lutFilled = 0;        // entries computed for the current R0
+static bool lutRebuilding = true;    // window must be (re)located first
+
+/**
+ * @brief Evaluates the calibration curve at an integer ADC code.
+ */
+static float ppmAtCode(uint16_t code) {
+    return calculatePPMFromCode(code);
+}
+
+/**
+ * @brief Finds the first ADC code whose PPM reaches LUT_PPM_FLOOR.
+ *
+ * PPM rises monotonically with the ADC code, so a binary search needs
+ * at most 10 curve evaluations.
+ */
+static uint16_t findBaseCode() {
+    uint16_t lo = 1;
+    uint16_t hi = 1023;
+    while (lo < hi) {
+        uint16_t mid = (lo + hi) / 2;
+        if (ppmAtCode(mid) >= LUT_PPM_FLOOR) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    if (lo > 1024 - LUT_SIZE) {
+        lo = 1024 - LUT_SIZE;
+    }
+    return lo;
+}
+
+//====================================================
+// Public Interface
+//====================================================
+
+/**
+ * @brief Marks the table stale after a calibration change.
+ *
+ * Cheap enough to call from anywhere; the actual work happens in
+ * lutService().
+ */
+void lutInvalidate() {
+    lutRebuilding = true;
+    lutFilled = 0;
+}
+
+/**
+ * @brief Advances an outstanding table rebuild by one chunk.
+ *
+ * Must be called regularly from the main loop. Does nothing once the
+ * table is complete.
+ */
+void lutService() {
+    PROFILE_SCOPE(PROF_LUT_SERVICE);
+    if (lutRebuilding) {
+        lutBaseCode = findBaseCode();
+        lutFilled = 0;
+        lutRebuilding = false;
+        return;
+    }
+    if (lutFilled >= LUT_SIZE) {
+        return;
+    }
+
+    uint8_t end = lutFilled + LUT_REBUILD_CHUNK;
+    if (end > LUT_SIZE) {
+        end = LUT_SIZE;
+    }
+    for (uint8_t i = lutFilled; i < end; i++) {
+        float ppm = ppmAtCode(lutBaseCode + i);
+        ppmTable[i] = (ppm >= LUT_PPM_MAX) ? LUT_PPM_MAX : (uint16_t)(ppm + 0.5f);
+    }
+    lutFilled = end;
+}
+
+/**
+ * @brief Reports whether lookups are currently served from the table.
+ */
+bool lutIsValid() {
+    return !lutRebuilding && lutFilled >= LUT_SIZE;
+}
+
+/**
+ * @brief Converts a (possibly fractional) ADC code to PPM.
+ *
+ * Interpolates linearly between the two neighbouring table entries.
+ * Falls back to calculatePPM() while the table is being rebuilt, outside
+ * the table window, or where the entries saturate.
+ *
+ * Parameters:
+ *  @param code ADC code, e.g. a moving-average mean (0-1023)
+ *
+ * Returns:
+ *  @return float - Estimated CO2 concentration in PPM
+ */
+float lutLookupPPM(float code) {
+    float pos = code - lutBaseCode;
+    if (!lutIsValid() || pos < 0 || pos >= LUT_SIZE - 1) {
+        return calculatePPM(code * (5.0 / 1023.0));
+    }
+
+    uint8_t i = (uint8_t)pos;
+    uint16_t lower = ppmTable[i];
+    uint16_t upper = ppmTable[i + 1];
+    if (upper == LUT_PPM_MAX) {
+        return calculatePPM(code * (5.0 / 1023.0));
+    }
+    return lower + (upper - lower) * (pos - i);
+}
@@ -0,0 +1,18 @@
+#ifndef LUT_H
+#define LUT_H
+
+#include <Arduino.h>
+
+//---------------------------
+// ADC -> PPM table configuration
+//---------------------------
+const uint8_t LUT_SIZE = 128;            // consecutive ADC codes covered by the table
+const uint8_t LUT_REBUILD_CHUNK = 16;    // entries recomputed per lutService() call
+const float LUT_PPM_FLOOR = 100.0;       // first table entry is the first code at/above this
+
+void lutInvalidate();
+void lutService();
+bool lutIsValid();
+float lutLookupPPM(float code);
+
+#endif
@@ -20,12 +20,12 @@
 //      - Multi-mode warning system (LCD, Buzzer, Servo, LED)
 //      - Serial monitor diagnostics and logging
 //      - Automatic servo manipulation
-//      - Regular recalibration every 5 mins
+//      - Regular recalibration every 5 mins (non-blocking, aborted by CO2 spikes)
 //         - Readings drift and become innacurate over time, requiring regular correction.
 //
 //      LIMITATIONS
 //      - 20 second MQ135 Sensor preheating at startup
-//      - 5 second Air quality Calibration
+//      - 5 second Air quality Calibration (skipped on brown-out/watchdog resets, see persist.cpp)
 //      - Requires clean air (Assumption approx. 400 ppm)
 //----------------------------------------------------------------------------
 //      AIR QUALITY THRESHOLDS:
@@ -45,6 +45,9 @@
 //      2. BUZZER emits continuous warning pattern
 //      3. LED flashes bright red
 //      4. LCD displays emergency warning message
+//      Entered after 3 of 5 readings above 2000 PPM, left after 3 of 5
+//      below 1800 PPM and at least 30 s on (alarm.cpp). Below it, 1000
+//      and 1500 PPM levels only sound the buzzer (slow / faster beeps).
 //
 //----------------------------------------------------------------------------
 //      HARDWARE CONNECTIONS:
@@ -87,6 +90,165 @@
 #include <misc.h>
 #include <calib.h>
 #include <response.h>
+#include <lut.h>
+#include <profile.h>
+#include <timing.h>
+#include <console.h>
+#include <baseline.h>
+#include <r0track.h>
+#include <persist.h>
+#include <curvefit.h>
+#include <envcomp.h>
+#include <drift.h>
+#include <kalman.h>
+#include <scheduler.h>
+#include <motion.h>
+#include <buzzer.h>
+#include <alarm.h>
+
+//============================================================================
+// TASKS
+//============================================================================
+// Each former millis() gate of loop() is a task; with TASK_SCHEDULER they
+// run from the table below (scheduler.cpp), otherwise from the original
+// gates in loop().
+
+static float currentPPM = 0;                                // last alarm evaluation, for the log task
+static int currentQuality = 0;
+
+static void taskSample() {
+    updatePPMReading();                                     // drain the sampler into the moving average
+    TIMING_MARK(TIMING_SAMPLING);
+}
+
+static void taskBuzzer() {
+    buzzerService();                                        // polled pattern player (Timer2 interrupt on AVR)
+    TIMING_MARK(TIMING_BUZZER);
+}
+
+static void taskServo() {
+    motionService();                                        // next step of a running door move
+    TIMING_MARK(TIMING_LCD);                                // with the other actuator updates
+}
+
+static void taskService() {
+    calibrationService();                                   // advance a running (non-blocking) calibration
+	lutService();											// advance any pending PPM table rebuild
+#if CALIBRATION_PERSIST
+    persistService();                                       // one EEPROM byte of a pending save
+#endif
+    TIMING_MARK(TIMING_PROCESSING);
+}
+
+static void taskConsole() {
+    pollConsole();                                          // serial commands ("help", "timing", ...)
+    TIMING_MARK(TIMING_SERIAL);
+}
+
+static void taskAlarm() {
+    checkRecalibration();                                   // check whether 5 mins has passed since last recalibration    
+#if ENV_COMPENSATION
+    envService();                                           // refresh the Rs correction if T/RH moved past the delta
+#endif
+	MQ135SensorDirectData();			    			// Update sensor direct analog and digital data.
+    float ppm = getAveragePPM();                            // get the current ppm reading
+    if (movingAverageCount(&sensorWindow) > 0) {
+        float meanCode = movingAverageMean(&sensorWindow);
+#if BASELINE_CORRECTION
+        baselineUpdate(meanCode);                           // long-window clean-air tracking, nudges R0
+#endif
+#if R0_TRACKING
+        r0TrackUpdate(meanCode);                            // stable 1-minute drift > 10% commits a new R0
+#endif
+#if DRIFT_DETECTION
+        driftUpdate(meanCode);                              // sequential drift test, flags recalibration
+#endif
+#if KALMAN_FILTER
+        kalmanUpdate(meanCode);                             // gas / drift state estimate and alarm confidence
+#endif
+#if UNIT_CURVE
+        curveFitUpdate(meanCode);                           // records a reference point for "fit PPM"
+#endif
+    }
+    int qualityLevel = getAirQualityLevel(ppm);             // get the air quality level
+    String qualityText = getQualityText(qualityLevel);      // turn that to text
+    currentPPM = ppm;
+    currentQuality = qualityLevel;
+    bool isAboveThreshold = (ppm > PPM_THRESHOLD);          // check whether the ppm level is above the set threshold (2000 ppm)
+    bool isFailsafe = (sensor_voltage > SENSOR_VOLTAGE_THRESHOLD);  // raw sensor voltage above the passive failsafe threshold
+#if ALARM_ENGINE
+    bool gasConfirmed = true;
+#if KALMAN_FILTER && KALMAN_ALARM_GATE
+    gasConfirmed = (kalmanConfidence() >= KALMAN_GATE_CONFIDENCE);  // the filter agrees this is gas, not drift
+#endif
+    AlarmSeverity severity = alarmUpdate(ppm, isFailsafe, gasConfirmed);   // hysteresis, N-of-M persistence and dwell per level
+#else
+#if KALMAN_FILTER && KALMAN_ALARM_GATE
+    if (!isWarningActive                                    // entering the warning state also needs the filter to
+        && kalmanConfidence() < KALMAN_GATE_CONFIDENCE) {       // agree that this is gas, not drift (leaving is unchanged)
+        isAboveThreshold = false;
+    }
+#endif
+#endif
+
+    bool gasArriving = false;
+#if DRIFT_DETECTION
+    gasArriving = driftExcursion();                         // the reading left its slow level within minutes
+#endif
+    if (recalibrationDue 
+        && (ppm < 700) 
+        && !gasArriving
+        && !isWarningActive
+        && !calibrationActive()) {                          // check whether regular recalibration is due, and ppm levels are safe, and 
+        performRegularRecalibration();                      // if warning systems are not running (to not interfere in emergencies)
+    }                                                       // if all are satisfied, start recalibrating (assume 400-700 ppm air)
+    TIMING_MARK(TIMING_PROCESSING);
+
+#if ALARM_ENGINE
+    if (isAboveThreshold || isFailsafe) {                   // a single polluted reading is enough to
+        calibrationAbort("alarm");                          // never calibrate on polluted air
+    }
+    if (severity == ALARM_CRITICAL) {                       // the critical level is the warning state:
+        handleWarningState(ppm, qualityText);               // activate warning systems
+    } else if (!calibrationActive()) {                      // otherwise, unless calibration owns the LCD
+        handleNormalState(ppm, qualityText);                // do normal processes (display ppm, close systems)
+    }
+    handleAlarmSound(severity);                             // lower levels: their own buzzer pattern
+#else
+    if (isAboveThreshold || isFailsafe) {                   // if ppm is above ppm danger (active) threshold or above raw sensor threshold
+                                                            // (passive failsafe), the routine:
+        calibrationAbort("alarm");                          // never calibrate on polluted air
+        handleWarningState(ppm, qualityText);               // activate warning systems
+    } else if (!calibrationActive()) {                      // otherwise, unless calibration owns the LCD
+        handleNormalState(ppm, qualityText);                // do normal processes (display ppm, close systems)
+    }
+#endif
+    TIMING_MARK(TIMING_LCD);                                // LCD, plus servo/buzzer state changes
+}
+
+static void taskLog() {
+    logSensorData(currentPPM, getQualityText(currentQuality));      // sensor data logging.
+	debugSensor();										// data debugging.
+    TIMING_MARK(TIMING_SERIAL);
+}
+
+#if TASK_SCHEDULER
+// Rates and deadlines in ms; priority 0 runs first when several are due.
+static const Task tasks[] = {
+    // function     name       period  deadline  priority
+    { taskSample,   "sample",      20,       20,        0 },    // 50 Hz, the ring absorbs lateness
+    { taskAlarm,    "alarm",     1000,      100,        1 },    // evaluation, response and display
+#if !defined(__AVR__)
+    { taskBuzzer,   "buzzer",      10,       10,        2 },    // patterns; the board plays them from Timer2
+#endif
+    { taskServo,    "servo",       20,       20,        3 },    // one step per servo frame
+    { taskService,  "service",      5,       20,        4 },    // calibration, LUT, EEPROM
+    { taskConsole,  "console",     10,       50,        5 },    // 64-byte UART buffer lasts 66 ms
+    { taskLog,      "log",       1000,      500,        6 },    // after the alarm task of the same second
+};
+static const uint8_t TASK_COUNT = sizeof(tasks) / sizeof(tasks[0]);
+static TaskState taskState[TASK_COUNT];                             // run-time state, starts zeroed
+#endif
 
 //============================================================================
 // INITIALIZATIONS
@@ -98,14 +260,28 @@ void setup() {
     initializeServo();              // Initializing servo motor
     initializeSensorArray();        // Initializing sensors
     displayStartupMessage();        // Display device name and group name
+#if UNIT_CURVE
+    curveFitLoad();                 // this unit's fitted curve, if one was saved
+#endif
     performSensorPreheating();      // 20 second mandatory preheating for MQ135 Sensor
-	originalR0 = R0;				// calibrate original R0 reading for sensor.
-    calibrateInitWaiting();         // Calibration waiting time for user
-    calibrateSensor();              // Calibrate sensor
+#if ENV_COMPENSATION
+    envService();                   // temperature/humidity factor before any Rs is used
+#endif
+#if CALIBRATION_PERSIST
+    if (!persistRestore())          // warm reset with a recent saved calibration: skip the clean-air steps
+#endif
+    {
+        calibrateInitWaiting();     // Calibration waiting time for user
+        calibrateSensor();          // Calibrate sensor
+        originalR0 = R0;            // calibrated R0 is the drift reference
+    }
     lastCalibrationTime = millis(); // Start calibration timers
     displaySystemReady();           // user ready display
     initializeSensorTiming();       // Initializing timing of sensor for moving average
     performInitialDiagnostics();    // Diagnostic information
+#if TASK_SCHEDULER
+    schedulerBegin(tasks, taskState, TASK_COUNT);   // release every periodic task now
+#endif
 }
 
 //============================================================================
@@ -113,36 +289,24 @@ void setup() {
 //============================================================================
 
 void loop() {
+    PROFILE_SCOPE(PROF_LOOP);
     if (!isPreheated) return;                               // make sure that the MQ135 sensor is preheated
+    TIMING_LOOP_START();                                    // section timing; loop period without the scheduler (LOOP_TIMING)
 
-    updatePPMReading();                                     // consistently update ppm reading
-	updateBuzzer();											// Update buzzer system
+#if TASK_SCHEDULER
+    schedulerRun();                                         // most urgent due task, or idle until one is
+#else
+    taskSample();
+    taskBuzzer();
+    taskServo();
+    taskService();
+    taskConsole();
     static unsigned long lastProcessTime = 0;               // reset process time
 
     if (millis() - lastProcessTime >= 1000) {               // if last process time was a second ago, run subroutine below
         lastProcessTime = millis();                         // set last process time
-        checkRecalibration();                               // check whether 5 mins has passed since last recalibration    
-		MQ135SensorDirectData();			    			// Update sensor direct analog and digital data.
-        float ppm = getAveragePPM();                        // get the current ppm reading
-        int qualityLevel = getAirQualityLevel(ppm);         // get the air quality level
-        String qualityText = getQualityText(qualityLevel);  // turn that to text
-        bool isAboveThreshold = (ppm > PPM_THRESHOLD);      // check whether the ppm level is above the set threshold (2000 ppm)
-
-        if (recalibrationDue 
-            && (ppm < 700) 
-            && !isWarningActive) {                          // check whether regular recalibration is due, and ppm levels are safe, and 
-            performRegularRecalibration();                  // if warning systems are not running (to not interfere in emergencies)
-        }                                                   // if all are satisfied, recalibrate device (assume 400-700 ppm air)
-
-        if (isAboveThreshold || (sensor_voltage 			// if ppm is above ppm danger (active) threshold or above raw sensor threshold
-					> SENSOR_VOLTAGE_THRESHOLD)) {          // (passive failsafe), the routine:
-            handleWarningState(ppm, qualityText);           // activate warning systems
-        } else {
-            											// otherwise
-            handleNormalState(ppm, qualityText);            // do normal processes (display ppm, close systems)
-        }
-
-        logSensorData(ppm, qualityText);                    // sensor data logging.
-		debugSensor();										// data debugging.
+        taskAlarm();
+        taskLog();
     }
+#endif
 }
@@ -18,6 +18,11 @@
  * Dependencies:
  *  - globals.h : shared system state (LCD, pins, flags, buffers)
  *  - utils.h   : debugging and sensor diagnostic output
+ *  - sampler.h : background ADC acquisition, started once setup completes
+ *  - trace.h   : preheat / ready trace points for the simulator
+ *  - warmup.h  : settling detector that ends an adaptive preheat
+ *  - motion.h  : door servo position at power-up
+ *  - buzzer.h  : buzzer pin and pattern timer
  *
  * Hardware:
  *  - Arduino Uno R3
@@ -28,7 +33,8 @@
  *
  * Timing:
  *  - Startup banners: ~4 seconds total
- *  - Sensor preheating: 20 seconds (configurable)
+ *  - Sensor preheating: 8-60 seconds until Rs settles (ADAPTIVE_PREHEAT),
+ *    or a fixed 20 seconds
  *
  * Design notes:
  *  - Preheating is mandatory for MQ-135 accuracy
@@ -37,8 +43,14 @@
 
 
 #include "misc.h"
+#include "config.h"
 #include "globals.h"
 #include "utils.h"
+#include "sampler.h"
+#include "trace.h"
+#include "warmup.h"
+#include "motion.h"
+#include "buzzer.h"
 
 //====================================================
 // Initialization
@@ -56,7 +68,7 @@
 void initializeHardwarePins() {
 	pinMode(LED_output, OUTPUT);
 	pinMode(CO2_digital_pin, INPUT);
-	pinMode(Buzzer_output, OUTPUT);
+	buzzerBegin();				// buzzer pin plus its pattern timer (Timer2)
 	Serial.println("Initializing pins ...");
 }
 
@@ -64,34 +76,32 @@ void initializeHardwarePins() {
  * @brief Initializes and resets the ventilation servo.
  *
  * Attaches the servo to its control pin and moves it to the
- * default closed position (0 degrees).
+ * default closed position (0 degrees). Later moves go through the
+ * motion profile (motion.cpp).
  */
 void initializeServo() {
 	DoorServo.attach(servoPin);
-	DoorServo.write(0);
+	motionBegin(MOTION_CLOSED_ANGLE);
 	Serial.println("Initializing servo ...");
 }
 
 /**
- * @brief Clears the rolling PPM buffer.
+ * @brief Clears the rolling sensor buffer.
  *
- * Initializes the moving-average buffer used for PPM calculations
- * by setting all entries to zero.
- *
- * This prevents undefined behavior during early averaging.
+ * Binds the moving average to its sample storage and empties it,
+ * so early averages only cover samples actually taken.
  */
 void initializeSensorArray() {
-	for (int i=0; i<SAMPLES_PER_READING; i++) {
-		ppmReadings[i] = 0;
-	}
+	movingAverageInit(&sensorWindow, adcReadings, SAMPLES_PER_READING);
 	Serial.println("Initializing sensor array ...");
 }
 
 /**
  * @brief Initializes sensor timing state.
  *
- * Marks the sensor as preheated and initializes the last
- * sample timestamp used by the rolling average logic.
+ * Marks the sensor as preheated, initializes the last
+ * sample timestamp used by the rolling average logic and
+ * starts the background ADC sampler.
  *
  * Note:
  *  - Preheating may be skipped prior to calling this function
@@ -99,6 +109,7 @@ void initializeSensorArray() {
 void initializeSensorTiming() {
 	isPreheated = true;
 	lastSampleTime = millis();
+	samplerBegin();
 }
 
 /**
@@ -157,17 +168,22 @@ void displaySystemReady() {
 	Serial.println("          SYSTEM READY               ");
 	Serial.println("=====================================");
 	delay(2000);
+	traceEvent(TRACE_SYSTEM_READY);
 }
 
 /**
  * @brief Executes MQ-135 sensor preheating sequence.
  *
- * Runs a 20-second warm-up period required for MQ-135 sensor
- * stability. Displays a countdown and animation on the LCD.
+ * With ADAPTIVE_PREHEAT, samples the sensor while waiting and ends as
+ * soon as warmup.cpp reports a settled Rs, but never before
+ * PREHEAT_MIN_MS nor after PREHEAT_MAX_MS. A sensor that is still warm
+ * from a brief reset is ready after the minimum; a cold one waits until
+ * its reading stops climbing. Without it, waits PREHEAT_FIXED_MS (20 s).
+ * Displays the elapsed time and an animation on the LCD.
  *
  * Can be skipped using the skipPreheating flag (debug use).
  *
- * Blocking: YES (20 seconds)
+ * Blocking: YES (8-60 seconds adaptive, 20 seconds fixed)
  */
 void performSensorPreheating() {
 	if (skipPreheating) {
@@ -176,28 +192,51 @@ void performSensorPreheating() {
 
 	lcd.clear();
 	lcd.setCursor(0,0); lcd.print("SensorPreheating");
-	lcd.setCursor(0,1); lcd.print("Time: 20 s ");
+	lcd.setCursor(0,1); lcd.print("Time: 00 s ");
 
 	Serial.print("Sensor preheating");
+	traceEvent(TRACE_PREHEAT_START);
 	unsigned long startTime = millis();
 	unsigned long lastAnim = 0;
+	unsigned long lastSample = startTime;
+	unsigned long lastDot = startTime;
+	warmupBegin();
 
-	while (millis()-startTime < 20000) {
+	while (true) {
+		unsigned long elapsed = millis()-startTime;
+#if ADAPTIVE_PREHEAT
+		if (elapsed >= PREHEAT_MAX_MS) break;
+		if (elapsed >= PREHEAT_MIN_MS && warmupSettled()) break;
+#else
+		if (elapsed >= PREHEAT_FIXED_MS) break;
+#endif
+		if (millis()-lastSample >= WARMUP_SAMPLE_MS) {
+			lastSample += WARMUP_SAMPLE_MS;
+			warmupAddSample(analogRead(CO2_analog_pin));
+		}
 		if (millis()-lastAnim >= 500) {
 			displayPreheatingAnimation(startTime);
 			lastAnim = millis();
 		}
-		delay(50);
-		Serial.print(".");
+		if (millis()-lastDot >= 1000) {
+			lastDot += 1000;
+			Serial.print(".");
+		}
+		delay(10);
 	}
 	Serial.println();
+	Serial.print("Preheat done after "); Serial.print((millis()-startTime)/1000.0, 1);
+	Serial.print(" s (Rs slope "); Serial.print(warmupSlope()*100, 3);
+	Serial.print(" %/s, CV "); Serial.print(warmupCV()*100, 3); Serial.println(" %)");
+	traceEvent(TRACE_PREHEAT_DONE);
 }
 
 /**
- * @brief Updates the LCD preheating animation and countdown.
+ * @brief Updates the LCD preheating animation and timer.
  *
- * Displays a rotating character animation and remaining
- * preheating time in seconds.
+ * Displays a rotating character animation and the preheating time in
+ * seconds: elapsed with ADAPTIVE_PREHEAT (the end is not known in
+ * advance), remaining of the fixed wait otherwise.
  *
  * Parameters:
  *  @param startTime Timestamp marking the beginning of preheating
@@ -210,8 +249,12 @@ void displayPreheatingAnimation(unsigned long startTime) {
 	String animation[4] = {"|","/","-","\\"};
 	lcd.setCursor(15,1); lcd.print(animation[frame%4]);
 
-	unsigned long remaining = (20000-(millis()-startTime))/1000;
-	lcd.setCursor(0,1); lcd.print("Time: "); if(remaining<10) lcd.print("0"); lcd.print(remaining); lcd.print(" s     ");
+#if ADAPTIVE_PREHEAT
+	unsigned long shown = (millis()-startTime)/1000;
+#else
+	unsigned long shown = (PREHEAT_FIXED_MS-(millis()-startTime))/1000;
+#endif
+	lcd.setCursor(0,1); lcd.print("Time: "); if(shown<10) lcd.print("0"); lcd.print(shown); lcd.print(" s     ");
 
 	frame++;
 }
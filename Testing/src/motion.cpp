@@ -0,0 +1,157 @@
+/**
+ * @file motion.cpp
+ * @brief Non-blocking door servo moves along a trapezoidal velocity profile.
+ *
+ * The warning transitions used to write the end angle to the SG90 and
+ * then delay(500) for the horn to get there, freezing sampling and the
+ * buzzer on every alarm edge. motionMoveTo() now only records the move;
+ * motionService(), run every servo frame by the servo task, writes the
+ * angle the profile has reached by then:
+ *
+ *    speed
+ *      ^    ______________
+ *      |   /              \          rise/fall at MOTION_ACCEL,
+ *      |  /                \         cruise at MOTION_MAX_SPEED
+ *      +-/------------------\----> t (short moves never reach cruise)
+ *
+ * The position is a function of the time since the move started, not of
+ * the number of service calls, so a late or irregular caller only makes
+ * the steps coarser; the move still ends on time. A new target during a
+ * move starts a new profile from the current angle (from rest, which the
+ * SG90's own controller smooths over).
+ *
+ * After the last step the servo is given MOTION_SETTLE_MS to come to
+ * rest, then the move is reported in position: motionInPosition(), a
+ * serial line and the servo_in_position trace point.
+ *
+ * Dependencies:
+ *  - globals.h : DoorServo
+ *  - trace.h   : in-position trace point for the simulator
+ */
+
+#include "motion.h"
+#include "globals.h"
+#include "trace.h"
+#include <math.h>
+
+static uint8_t startAngle = MOTION_CLOSED_ANGLE;
+static uint8_t targetAngle = MOTION_CLOSED_ANGLE;
+static uint8_t currentAngle = MOTION_CLOSED_ANGLE;     // last angle written
+static unsigned long moveStart = 0;
+static float accelTime = 0;     // s, each of the rise and the fall
+static float cruiseTime = 0;    // s
+static float peakSpeed = 0;     // deg/s
+static bool moving = false;     // profile still running
+static bool inPosition = true;
+
+/**
+ * @brief Distance covered t seconds into the current profile (degrees).
+ */
+static float profileDistance(float t) {
+    float total = 2 * accelTime + cruiseTime;
+    if (t >= total) {
+        return fabs((float)targetAngle - startAngle);
+    }
+    if (t < accelTime) {
+        return 0.5f * MOTION_ACCEL * t * t;
+    }
+    float ramp = 0.5f * MOTION_ACCEL * accelTime * accelTime;
+    if (t < accelTime + cruiseTime) {
+        return ramp + peakSpeed * (t - accelTime);
+    }
+    float left = total - t;
+    return fabs((float)targetAngle - startAngle) - 0.5f * MOTION_ACCEL * left * left;
+}
+
+//====================================================
+// Public Interface
+//====================================================
+
+/**
+ * @brief Puts the servo at an angle at once (power-up, no profile).
+ */
+void motionBegin(uint8_t angle) {
+    startAngle = targetAngle = currentAngle = angle;
+    moving = false;
+    inPosition = true;
+    DoorServo.write(angle);
+}
+
+/**
+ * @brief Starts a move to angle; returns immediately.
+ *
+ * A move to the current target is ignored, so calling this on every
+ * warning evaluation does not restart the profile.
+ */
+void motionMoveTo(uint8_t angle) {
+    if (angle == targetAngle) {
+        return;
+    }
+    startAngle = currentAngle;
+    targetAngle = angle;
+    float distance = fabs((float)targetAngle - startAngle);
+    const float rampDistance = MOTION_MAX_SPEED * MOTION_MAX_SPEED / MOTION_ACCEL;
+    if (distance >= rampDistance) {
+        accelTime = MOTION_MAX_SPEED / MOTION_ACCEL;
+        cruiseTime = (distance - rampDistance) / MOTION_MAX_SPEED;
+        peakSpeed = MOTION_MAX_SPEED;
+    } else {
+        accelTime = sqrt(distance / MOTION_ACCEL);
+        cruiseTime = 0;
+        peakSpeed = MOTION_ACCEL * accelTime;
+    }
+    moveStart = millis();
+    moving = true;
+    inPosition = false;
+}
+
+/**
+ * @brief Writes the profile's current angle; call every servo frame (20 ms).
+ *
+ * Returns at once when the servo is in position.
+ */
+void motionService() {
+    if (inPosition) {
+        return;
+    }
+    unsigned long elapsed = millis() - moveStart;
+    if (moving) {
+        float t = elapsed / 1000.0f;
+        float covered = profileDistance(t);
+        int angle = (targetAngle >= startAngle) ? startAngle + (int)(covered + 0.5f)
+                                                : startAngle - (int)(covered + 0.5f);
+        if (angle != currentAngle) {
+            currentAngle = angle;
+            DoorServo.write(currentAngle);
+        }
+        if (t >= 2 * accelTime + cruiseTime) {
+            moving = false;
+            moveStart = millis();               // settling starts now
+        }
+        return;
+    }
+    if (elapsed >= MOTION_SETTLE_MS) {
+        inPosition = true;
+        traceEvent(TRACE_SERVO_IN_POSITION);
+        Serial.print(F("Servo in position: "));
+        Serial.println(currentAngle);
+    }
+}
+
+/**
+ * @brief Reports whether the last move has finished and settled.
+ */
+bool motionInPosition() {
+    return inPosition;
+}
+
+/**
+ * @brief Returns the angle last written to the servo.
+ */
+uint8_t motionAngle() {
+    return currentAngle;
+}
+
+uint8_t motionTarget() {
+    return targetAngle;
+}
@@ -0,0 +1,25 @@
+#ifndef MOTION_H
+#define MOTION_H
+
+#include <Arduino.h>
+
+//---------------------------
+// Door servo motion profile
+//---------------------------
+// Trapezoidal velocity profile: accelerate at MOTION_ACCEL, cruise at
+// MOTION_MAX_SPEED, decelerate to rest on the target. 0 -> 90 deg takes
+// 0.75 s, plus MOTION_SETTLE_MS before the move is reported in position.
+const uint8_t MOTION_OPEN_ANGLE = 90;       // door open (warning)
+const uint8_t MOTION_CLOSED_ANGLE = 0;
+const float MOTION_MAX_SPEED = 180;         // deg/s (SG90 no-load ~600 deg/s)
+const float MOTION_ACCEL = 720;             // deg/s^2, also the deceleration
+const uint16_t MOTION_SETTLE_MS = 150;      // hold on target before "in position"
+
+void motionBegin(uint8_t angle);
+void motionMoveTo(uint8_t angle);
+void motionService();
+bool motionInPosition();
+uint8_t motionAngle();
+uint8_t motionTarget();
+
+#endif
@@ -0,0 +1,313 @@
+/**
+ * @file persist.cpp
+ * @brief Calibration state kept in EEPROM across resets.
+ *
+ * A clean-air calibration costs the user ~9 s of attention and needs
+ * clean air at that moment. After a brown-out or watchdog reset the
+ * sensor is still warm and its R0 has not moved, so setup() can reuse
+ * the last calibration and only wait for the preheat minimum.
+ *
+ * Record (one EEPROM slot):
+ *  - R0 and originalR0
+ *  - The baseline correction's block-minimum ring (baseline.cpp), so the
+ *    4 h clean-air history is not lost either
+ *  - A generation counter, powered minutes at save and at the last full
+ *    calibration (the board has no clock; off time is unknown)
+ *  - CRC-16/CCITT over everything before it, written last
+ *
+ * Wear levelling and power-fail safety:
+ *  - PERSIST_SLOTS slots are used in rotation; each save goes to the slot
+ *    after the newest one, and boot picks the valid slot with the highest
+ *    generation
+ *  - A save interrupted by a power loss leaves a slot whose CRC does not
+ *    match, and the previous slot is still the newest valid one
+ *  - Routine saves happen at most every PERSIST_SAVE_INTERVAL and only if
+ *    R0 or the baseline ring changed: at one save per 15 min each slot is
+ *    rewritten every 3 h, ~34 years for a 100k-cycle cell
+ *  - EEPROM.update() skips bytes that did not change
+ *
+ * Restore policy (persistRestore()):
+ *  - Power-on reset (PORF): the unit may have been off for weeks, so the
+ *    sensor is calibrated again; the generation sequence continues. The
+ *    same when the reset cause is unknown (no flags at all)
+ *  - Brown-out, watchdog or external reset: restore if the record is
+ *    valid and either calibrated within PERSIST_MAX_AGE_MINUTES of powered
+ *    time or backed by enough baseline history to have kept R0 current
+ *
+ * Saving is non-blocking: persistService() writes one byte per loop pass
+ * and only when the EEPROM is ready (a byte write takes 3.3 ms).
+ *
+ * Dependencies:
+ *  - globals.h  : R0, originalR0
+ *  - calib.h    : updateR0()
+ *  - baseline.h : ring export/import
+ *  - trace.h    : restore trace point for the simulator
+ */
+
+#include "persist.h"
+#include "globals.h"
+#include "calib.h"
+#include "baseline.h"
+#include "trace.h"
+#include <EEPROM.h>
+#include <stddef.h>
+
+struct PersistRecord {
+    uint16_t magic;
+    uint32_t generation;            // +1 per save; the highest valid slot is current
+    uint32_t poweredMinutes;        // run time summed over boots, at save
+    uint32_t calibratedMinutes;     // poweredMinutes at the last clean-air calibration
+    float r0;
+    float originalR0;
+    uint16_t baselineBlocks[BASELINE_BLOCKS];
+    uint8_t baselineHead;
+    uint8_t baselineCount;
+    uint16_t crc;                   // over all preceding bytes
+};
+
+static_assert(sizeof(PersistRecord) <= PERSIST_SLOT_SIZE, "PersistRecord does not fit a slot");
+static_assert(PERSIST_BASE_ADDR + (uint16_t)PERSIST_SLOTS * PERSIST_SLOT_SIZE <= 1024,
+              "persist slots exceed the ATmega328P EEPROM");
+
+static const uint8_t RECORD_CRC_BYTES = offsetof(PersistRecord, crc);
+
+static PersistRecord record;        // newest saved record, or the one being written
+static bool haveRecord = false;
+static uint8_t recordSlot = 0;
+static uint32_t bootMinutes = 0;    // powered minutes before this boot
+static uint32_t calibratedMinutes = 0;
+static uint8_t bootResetFlags = 0;
+static bool saveRequested = false;
+static unsigned long lastSaveTime = 0;
+static int8_t writePos = -1;        // next byte of `record` to write, -1 when idle
+static uint8_t writeSlot = 0;
+
+static const uint8_t RESET_CAUSE_MASK = (1 << PORF) | (1 << EXTRF) | (1 << BORF) | (1 << WDRF);
+
+#if defined(__AVR__)
+// The reset cause must be read before anything clears it. With no
+// bootloader the flags are still in MCUSR. A bootloader may clear MCUSR
+// itself; some builds hand the flags over in r2, but stock Optiboot does
+// not promise what r2 holds, so it is only trusted with
+// BOOTLOADER_PASSES_MCUSR, saved first thing in .init0 (before the C
+// runtime touches registers). Otherwise MCUSR reads 0 and the boot counts
+// as cold. MCUSR flags are sticky, so it is cleared as well; otherwise
+// PORF from the first power-up would mark every later reset as a power-on.
+uint8_t persistResetFlags __attribute__((section(".noinit")));
+#if BOOTLOADER_PASSES_MCUSR
+void persistCaptureBootloaderFlags() __attribute__((naked, used, section(".init0")));
+void persistCaptureBootloaderFlags() {
+    __asm__ __volatile__("sts %0, r2\n" : "=m"(persistResetFlags) :);
+}
+#endif
+void persistCaptureResetFlags() __attribute__((naked, used, section(".init3")));
+void persistCaptureResetFlags() {
+#if BOOTLOADER_PASSES_MCUSR
+    if (MCUSR) {
+        persistResetFlags = MCUSR;          // no bootloader, or one that leaves MCUSR alone
+    }
+#else
+    persistResetFlags = MCUSR;              // 0 after a bootloader cleared it: cold boot
+#endif
+    MCUSR = 0;
+}
+#endif
+
+static uint8_t readResetFlags() {
+#if defined(__AVR__)
+    return persistResetFlags & RESET_CAUSE_MASK;
+#else
+    uint8_t flags = MCUSR & RESET_CAUSE_MASK;
+    MCUSR = 0;
+    return flags;
+#endif
+}
+
+//====================================================
+// Slots
+//====================================================
+
+/**
+ * @brief CRC-16/CCITT (poly 0x1021, init 0xFFFF), also used by curvefit.cpp.
+ */
+uint16_t persistCrc16(const uint8_t *data, uint8_t length) {
+    uint16_t crc = 0xFFFF;
+    while (length--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static uint16_t slotAddress(uint8_t slot) {
+    return PERSIST_BASE_ADDR + (uint16_t)slot * PERSIST_SLOT_SIZE;
+}
+
+static bool readSlot(uint8_t slot, PersistRecord *out) {
+    uint8_t *bytes = (uint8_t *)out;
+    uint16_t addr = slotAddress(slot);
+    for (uint8_t i = 0; i < sizeof(PersistRecord); i++) {
+        bytes[i] = EEPROM.read(addr + i);
+    }
+    return out->magic == PERSIST_MAGIC && out->crc == persistCrc16(bytes, RECORD_CRC_BYTES);
+}
+
+/**
+ * @brief Loads the valid slot with the highest generation into `record`.
+ */
+static void scanSlots() {
+    PersistRecord candidate;
+    haveRecord = false;
+    for (uint8_t slot = 0; slot < PERSIST_SLOTS; slot++) {
+        if (!readSlot(slot, &candidate)) {
+            continue;
+        }
+        if (!haveRecord || candidate.generation > record.generation) {
+            record = candidate;
+            recordSlot = slot;
+            haveRecord = true;
+        }
+    }
+}
+
+static uint32_t poweredMinutes() {
+    return bootMinutes + millis() / 60000UL;
+}
+
+static bool stateChanged() {
+    uint16_t blocks[BASELINE_BLOCKS];
+    uint8_t head;
+    uint8_t count = baselineExport(blocks, &head);
+    return R0 != record.r0 || originalR0 != record.originalR0
+        || head != record.baselineHead || count != record.baselineCount;
+}
+
+static void beginSave() {
+    record.magic = PERSIST_MAGIC;
+    record.generation = haveRecord ? record.generation + 1 : 1;
+    record.poweredMinutes = poweredMinutes();
+    record.calibratedMinutes = calibratedMinutes;
+    record.r0 = R0;
+    record.originalR0 = originalR0;
+    record.baselineCount = baselineExport(record.baselineBlocks, &record.baselineHead);
+    record.crc = persistCrc16((const uint8_t *)&record, RECORD_CRC_BYTES);
+
+    writeSlot = haveRecord ? (recordSlot + 1) % PERSIST_SLOTS : 0;
+    writePos = 0;
+    haveRecord = false;             // `record` is not on the EEPROM until the CRC is
+    saveRequested = false;
+    lastSaveTime = millis();
+}
+
+//====================================================
+// Public Interface
+//====================================================
+
+/**
+ * @brief Reuses the saved calibration if the reset allows it.
+ *
+ * Call once in setup(), before calibration. Always reads the slots, so
+ * the generation sequence continues even when a new calibration follows.
+ *
+ * Returns:
+ *  @return bool - true if R0, originalR0 and the baseline history were
+ *                 restored and the clean-air calibration can be skipped
+ */
+bool persistRestore() {
+    bootResetFlags = readResetFlags();
+    scanSlots();
+    if (!haveRecord) {
+        Serial.println(F("persist: no saved calibration"));
+        return false;
+    }
+    bootMinutes = record.poweredMinutes;
+    calibratedMinutes = record.calibratedMinutes;
+
+    if (bootResetFlags & (1 << PORF)) {
+        Serial.println(F("persist: power-on reset, recalibrating"));
+        return false;
+    }
+    if (bootResetFlags == 0) {                  // cause unknown: assume the unit was off
+        Serial.println(F("persist: reset cause unknown, recalibrating"));
+        return false;
+    }
+    bool recent = record.poweredMinutes - record.calibratedMinutes <= PERSIST_MAX_AGE_MINUTES;
+#if BASELINE_CORRECTION
+    recent = recent || record.baselineCount >= BASELINE_MIN_BLOCKS;
+#endif
+    if (!recent || record.r0 <= 0) {
+        Serial.println(F("persist: saved calibration too old, recalibrating"));
+        return false;
+    }
+
+    updateR0(record.r0);
+    originalR0 = record.originalR0;
+    baselineImport(record.baselineBlocks, record.baselineHead, record.baselineCount);
+    traceEvent(TRACE_CALIBRATION_RESTORED);
+    Serial.print(F("persist: restored R0 ")); Serial.print(R0, 2);
+    Serial.print(F(" from slot ")); Serial.print(recordSlot);
+    Serial.print(F(" gen ")); Serial.println(record.generation);
+    return true;
+}
+
+/**
+ * @brief Saves the current state soon, regardless of the save interval.
+ */
+void persistRequestSave() {
+    saveRequested = true;
+}
+
+/**
+ * @brief Records a completed clean-air calibration and saves it soon.
+ */
+void persistCalibrationDone() {
+    calibratedMinutes = poweredMinutes();
+    persistRequestSave();
+}
+
+/**
+ * @brief Starts due saves and advances a running one; call every loop pass.
+ *
+ * Writes at most one EEPROM byte per call, and none while the previous
+ * byte is still being programmed.
+ */
+void persistService() {
+    if (writePos < 0) {
+        if (saveRequested
+            || (millis() - lastSaveTime >= PERSIST_SAVE_INTERVAL && stateChanged())) {
+            beginSave();
+        }
+        return;
+    }
+#if defined(__AVR__)
+    if (!eeprom_is_ready()) {
+        return;
+    }
+#endif
+    EEPROM.update(slotAddress(writeSlot) + writePos, ((const uint8_t *)&record)[writePos]);
+    if (++writePos < (int8_t)sizeof(PersistRecord)) {
+        return;
+    }
+    writePos = -1;
+    recordSlot = writeSlot;
+    haveRecord = true;
+}
+
+/**
+ * @brief Prints the persistence state (console command "persist").
+ */
+void persistReport() {
+    Serial.print(F("persist reset flags 0x")); Serial.print(bootResetFlags, HEX);
+    if (!haveRecord) {
+        Serial.println(writePos >= 0 ? F(" saving") : F(" no record"));
+        return;
+    }
+    Serial.print(F(" slot ")); Serial.print(recordSlot);
+    Serial.print(F(" gen ")); Serial.print(record.generation);
+    Serial.print(F(" R0 ")); Serial.print(record.r0, 2);
+    Serial.print(F(" calibrated ")); Serial.print(poweredMinutes() - calibratedMinutes);
+    Serial.print(F(" min ago, saved ")); Serial.print((millis() - lastSaveTime) / 1000);
+    Serial.println(F(" s ago"));
+}
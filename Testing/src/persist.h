@@ -0,0 +1,23 @@
+#ifndef PERSIST_H
+#define PERSIST_H
+
+#include <Arduino.h>
+
+//---------------------------
+// Calibration persistence (EEPROM)
+//---------------------------
+const uint16_t PERSIST_BASE_ADDR = 0;       // slots occupy [0, 768); curvefit.cpp uses 768
+const uint8_t PERSIST_SLOTS = 12;           // wear levelling: each save goes to the next slot
+const uint8_t PERSIST_SLOT_SIZE = 64;
+const uint16_t PERSIST_MAGIC = 0xC02A;      // change when the record layout changes
+const uint32_t PERSIST_MAX_AGE_MINUTES = 24UL * 60;            // powered time since the last clean-air calibration
+const unsigned long PERSIST_SAVE_INTERVAL = 15UL * 60 * 1000;  // routine saves at most every 15 min
+
+bool persistRestore();
+void persistRequestSave();
+void persistCalibrationDone();
+void persistService();
+void persistReport();
+uint16_t persistCrc16(const uint8_t *data, uint8_t length);
+
+#endif
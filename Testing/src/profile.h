@@ -0,0 +1,56 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "config.h"
+
+//---------------------------
+// Cycle-profiling markers
+//---------------------------
+// With PROFILE_MARKERS=1 on the board, PROFILE_SCOPE() writes the point id
+// to GPIOR0 on entry and (id | PROFILE_EXIT) on exit. GPIOR0 is otherwise
+// unused, so a simulator watching writes to it sees every scope boundary
+// with an exact cycle stamp (see profile/avr_profile.c). Each marker costs
+// two cycles; otherwise the macro expands to nothing.
+//
+// The list is shared with the C runner, so keep this header C-compatible
+// outside the __cplusplus block.
+
+#define PROFILE_POINTS(X)                              \
+    X(PROF_LOOP,            "loop")                    \
+    X(PROF_UPDATE_PPM,      "updatePPMReading")        \
+    X(PROF_AVERAGE_PPM,     "getAveragePPM")           \
+    X(PROF_CALCULATE_PPM,   "calculatePPM")            \
+    X(PROF_LUT_SERVICE,     "lutService")              \
+    X(PROF_BUZZER_ISR,      "TIMER2_COMPA_vect")       \
+    X(PROF_DISPLAY_WARNING, "displayWarningMessage")   \
+    X(PROF_DISPLAY_NORMAL,  "displayNormalMessage")    \
+    X(PROF_SAMPLER_ISR,     "ADC_vect")
+
+#define PROFILE_ENUM(id, name) id,
+
+enum ProfilePoint {
+    PROF_NONE,
+    PROFILE_POINTS(PROFILE_ENUM)
+    PROF_POINT_COUNT
+};
+
+#define PROFILE_EXIT 0x80
+
+#if defined(__cplusplus)
+#if PROFILE_MARKERS && defined(__AVR__)
+#include <avr/io.h>
+#include <stdint.h>
+
+struct ProfileScope {
+    uint8_t id;
+    explicit ProfileScope(uint8_t point) : id(point) { GPIOR0 = point; }
+    ~ProfileScope() { GPIOR0 = id | PROFILE_EXIT; }
+};
+
+#define PROFILE_SCOPE(point) ProfileScope profileScope_(point)
+#else
+#define PROFILE_SCOPE(point) ((void)0)
+#endif
+#endif
+
+#endif
@@ -0,0 +1,201 @@
+/**
+ * @file r0track.cpp
+ * @brief Streaming R0 estimator that recalibrates when drift is stable.
+ *
+ * Implements the main.cpp TODO: "forced recalibration when measured R0 is
+ * stable for 1 minute and deviates from original R0 by 10%".
+ *
+ * Every second the averaged reading is turned into the R0 it would imply
+ * in clean air (Rs / k of the active curve). Mean and variance over the last
+ * R0_TRACK_WINDOW values are kept with a sliding Welford update: the new
+ * value is added and the one leaving the ring is removed, each in O(1),
+ * so the window is never rescanned.
+ *
+ *    add x:    n+1, d = x - mean, mean += d / n, M2 += d * (x - mean)
+ *    remove y: n-1, d = y - mean, mean -= d / n, M2 -= d * (y - mean)
+ *
+ * A new R0 is committed, and the window started over, when:
+ *  - the window is full and its coefficient of variation is below
+ *    R0_TRACK_STABLE_CV (no noise or spikes)
+ *  - the newest and oldest values differ by less than R0_TRACK_MAX_TREND
+ *    (no trend: a slow gas ramp has low variance within one minute but
+ *    still moves across it)
+ *  - the mean deviates from originalR0 by more than R0_TRACK_DEVIATION
+ *    and from the current R0 by more than R0_TRACK_MIN_CHANGE
+ *
+ * A steady reading is what distinguishes drift from gas: a plume rises
+ * and falls, drift sits still. But gas held steady below the warning
+ * threshold looks the same within one minute, and committing it would
+ * zero the reading and hide the alarm that follows. What differs is how
+ * the level was reached: drift arrives at a few percent per hour, gas
+ * within minutes. The drift detector follows the implied R0 with a slow
+ * level and sets aside readings that leave it quickly (drift.cpp), so
+ * nothing is committed while it reports such an excursion. The reading
+ * itself is no guide: with k = 1.8 and n = 10 an R0 10 % low already
+ * reads ~1150 ppm in clean air, so a ppm or alarm-level gate would block
+ * exactly the drift this module exists to correct. Nothing is committed
+ * while the warning, a calibration or a curve-fit reference point is
+ * running either.
+ *
+ * A commit also re-seeds the automatic baseline with the new R0, so R0
+ * has one owner at a time: without it the baseline's older, higher
+ * minima would pull R0 straight back up after every commit.
+ *
+ * Dependencies:
+ *  - globals.h : R0, originalR0, isWarningActive (and curve.h)
+ *  - utils.h   : calculateRs()
+ *  - calib.h   : updateR0(), calibrationActive()
+ *  - trace.h   : commit trace point for the simulator
+ *  - curvefit.h: no commits while a reference point is recorded
+ *  - drift.h   : gas excursions; a commit restarts the drift detector
+ *  - baseline.h: a commit re-seeds the baseline history
+ *
+ * Memory:
+ *  - R0_TRACK_WINDOW x 2 bytes (R0 stored in 0.01 kOhm units)
+ */
+
+#include "r0track.h"
+#include "globals.h"
+#include "utils.h"
+#include "calib.h"
+#include "trace.h"
+#include "curvefit.h"
+#include "drift.h"
+#include "baseline.h"
+#include <math.h>
+
+static const float R0_UNIT = 100.0;         // ring stores R0 x 100 (0.01 kOhm)
+
+static uint16_t window[R0_TRACK_WINDOW];
+static uint8_t head = 0;
+static uint8_t count = 0;
+static float mean = 0;                      // kOhm
+static float m2 = 0;                        // sum of squared deviations (kOhm^2)
+
+//====================================================
+// Sliding Welford
+//====================================================
+
+static void welfordAdd(float x) {
+    count++;
+    float delta = x - mean;
+    mean += delta / count;
+    m2 += delta * (x - mean);
+}
+
+static void welfordRemove(float y) {
+    if (count <= 1) {
+        count = 0;
+        mean = 0;
+        m2 = 0;
+        return;
+    }
+    count--;
+    float delta = y - mean;
+    mean -= delta / count;
+    m2 -= delta * (y - mean);
+    if (m2 < 0) {
+        m2 = 0;                             // float cancellation
+    }
+}
+
+//====================================================
+// Public Interface
+//====================================================
+
+float r0TrackMean() {
+    return mean;
+}
+
+/**
+ * @brief Sample standard deviation of the window (kOhm).
+ */
+float r0TrackStdDev() {
+    return count > 1 ? sqrt(m2 / (count - 1)) : 0;
+}
+
+bool r0TrackFull() {
+    return count >= R0_TRACK_WINDOW;
+}
+
+void r0TrackReset() {
+    head = 0;
+    count = 0;
+    mean = 0;
+    m2 = 0;
+}
+
+/**
+ * @brief Feeds one averaged reading; call once per second.
+ *
+ * Parameters:
+ *  @param code Moving-average ADC code (0-1023)
+ *
+ * Returns:
+ *  @return true if a new R0 was committed
+ */
+bool r0TrackUpdate(float code) {
+    if (code <= 0 || code >= 1023) {
+        return false;
+    }
+    float implied = curveR0<ActiveCurve>(calculateRs(code * (5.0 / 1023.0)));
+    uint16_t stored = (uint16_t)constrain(implied * R0_UNIT + 0.5f, 1.0f, 65535.0f);
+
+    float oldest = stored / R0_UNIT;
+    if (r0TrackFull()) {
+        oldest = window[head] / R0_UNIT;
+        welfordRemove(oldest);
+    }
+    window[head] = stored;
+    head = (head + 1) % R0_TRACK_WINDOW;
+    welfordAdd(stored / R0_UNIT);
+
+    if (!r0TrackFull()) {
+        return false;
+    }
+    float trend = fabs(stored / R0_UNIT - oldest) / mean;
+    if (isWarningActive || calibrationActive() || originalR0 <= 0) {
+        return false;
+    }
+#if DRIFT_DETECTION
+    if (driftExcursion()) {
+        return false;                       // reached within minutes: gas, not drift
+    }
+#endif
+#if UNIT_CURVE
+    if (curveFitActive()) {
+        return false;                       // reference gas, not drift
+    }
+#endif
+    bool stable = r0TrackStdDev() < R0_TRACK_STABLE_CV * mean && trend < R0_TRACK_MAX_TREND;
+    bool drifted = fabs(mean / originalR0 - 1) > R0_TRACK_DEVIATION;
+    bool changed = fabs(mean / R0 - 1) > R0_TRACK_MIN_CHANGE;
+    if (!(stable && drifted && changed)) {
+        return false;
+    }
+
+    Serial.print(F("R0 re-estimated: ")); Serial.print(R0, 2);
+    Serial.print(F(" -> ")); Serial.println(mean, 2);
+    updateR0(mean);
+    traceEvent(TRACE_R0_REESTIMATED);
+    r0TrackReset();
+#if BASELINE_CORRECTION
+    baselineSeed(R0);                       // or the older minima pull R0 back
+#endif
+#if DRIFT_DETECTION
+    driftReset();                           // the drift is now in R0
+#endif
+    return true;
+}
+
+/**
+ * @brief Prints the estimator state (console command "r0").
+ */
+void r0TrackReport() {
+    Serial.print(F("r0 window ")); Serial.print(count);
+    Serial.print('/'); Serial.print(R0_TRACK_WINDOW);
+    Serial.print(F(" mean ")); Serial.print(mean, 2);
+    Serial.print(F(" sd ")); Serial.print(r0TrackStdDev(), 3);
+    Serial.print(F(" R0 ")); Serial.print(R0, 2);
+    Serial.print(F(" original ")); Serial.println(originalR0, 2);
+}
@@ -0,0 +1,22 @@
+#ifndef R0TRACK_H
+#define R0TRACK_H
+
+#include <Arduino.h>
+
+//---------------------------
+// Stability-gated R0 re-estimation
+//---------------------------
+const uint8_t R0_TRACK_WINDOW = 60;         // seconds of implied R0 (1 minute)
+const float R0_TRACK_STABLE_CV = 0.005;     // stable: std dev below 0.5 % of the mean
+const float R0_TRACK_MAX_TREND = 0.005;     // ... and newest/oldest differ by < 0.5 %
+const float R0_TRACK_DEVIATION = 0.10;      // commit: mean differs from originalR0 by > 10 %
+const float R0_TRACK_MIN_CHANGE = 0.02;     // ... and from the current R0 by > 2 %
+
+bool r0TrackUpdate(float code);
+void r0TrackReset();
+bool r0TrackFull();
+float r0TrackMean();
+float r0TrackStdDev();
+void r0TrackReport();
+
+#endif
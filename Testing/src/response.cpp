@@ -10,29 +10,40 @@
  *  - Activating and deactivating warning hardware (LED, buzzer, servo)
  *  - Managing warning state transitions
  *  - Displaying warning and normal messages on the LCD
- *  - Implementing non-blocking buzzer patterns for continuous operation
+ *  - Choosing the buzzer pattern for each transition, and for the alarm
+ *    levels below the warning state
  *
  * The module does NOT:
  *  - Perform sensor sampling
  *  - Calculate PPM values
  *  - Decide when warnings should be triggered
- *  - Handle the main timing loop (buzzer updates must be called externally)
+ *  - Handle the main timing loop
+ *  - Time the buzzer (buzzer.cpp plays patterns from a timer interrupt)
  *
  * All warning decisions are made by the main control loop.
  *
  * Dependencies:
  *  - globals.h : shared system state and hardware objects
  *  - misc.h    : LCD and hardware helpers
+ *  - trace.h   : warning on/off trace points for the simulator
+ *  - motion.h  : non-blocking door servo moves
+ *  - buzzer.h  : alarm and recovery patterns
+ *  - alarm.h   : pattern of each alarm level
  *
  * Design notes:
- *  - Buzzer patterns use non-blocking millis() timing for system responsiveness
- *  - Warning state transitions include mechanical delays for servo stability
+ *  - Buzzer patterns run in the background; transitions only select them
+ *  - Warning state transitions do not wait for the servo; it follows its
+ *    motion profile from the servo task and reports when in position
  *  - LCD warning display has a timed phase for maximum user attention
  */
 
 #include "response.h"
 #include "globals.h"
 #include "misc.h"
+#include "trace.h"
+#include "motion.h"
+#include "buzzer.h"
+#include "profile.h"
 
 //====================================================
 // Warning/Normal Handling
@@ -43,8 +54,6 @@
  *
  * Ensures that the warning system is activated exactly once when
  * entering a warning state, then manages the warning display.
- * Note: Buzzer control has been moved to non-blocking routines
- * that must be called from the main loop.
  *
  * Parameters:
  *  @param ppm          Current averaged CO2 concentration (PPM)
@@ -55,8 +64,6 @@
  *  - Records warning start time for display timing
  *  - Updates LCD with warning messages
  *  - Sets global isWarningActive flag
- *
- * Note: This function no longer calls the blocking warning_buzzer()
  */
 void handleWarningState(float ppm, String qualityText){
     if(!isWarningActive){
@@ -64,7 +71,6 @@ void handleWarningState(float ppm, String qualityText){
         // isWarningActive = true;
         // warningStartTime = millis(); // Redundant, already set in activate warning system
     }
-    // warning_buzzer() removed - now handled by non-blocking updateBuzzer()
     displayWarningMessage(ppm);
 }
 
@@ -80,7 +86,8 @@ void handleWarningState(float ppm, String qualityText){
  *
  * Side effects:
  *  - Deactivates warning system if active
- *  - Ensures LED and buzzer are off (safety redundancy)
+ *  - Ensures the LED is off (safety redundancy; the buzzer is left to
+ *    finish a recovery chirp or calibration beep)
  *  - Updates LCD with normal status display
  *  - Clears global warning state flag
  */
@@ -91,7 +98,6 @@ void handleNormalState(float ppm, String qualityText){
     }
     // Redundant safety - ensure outputs are off
     digitalWrite(LED_output, LOW);
-    digitalWrite(Buzzer_output, LOW);
     displayNormalMessage(ppm, qualityText);
 }
 
@@ -116,6 +122,7 @@ void handleNormalState(float ppm, String qualityText){
  *  - Maintains fixed field widths for stable display layout
  */
 void displayWarningMessage(float ppm) {
+    PROFILE_SCOPE(PROF_DISPLAY_WARNING);
     // Show full warning for the first few seconds
     if (millis() - warningStartTime < WARNING_DISPLAY_TIME) {
         lcd.setCursor(0, 0);
@@ -155,6 +162,7 @@ void displayWarningMessage(float ppm) {
  *       (e.g., "Good     ", "Fair     ", "Poor     ", "DANGER   ")
  */
 void displayNormalMessage(float ppm, String qualityText){
+    PROFILE_SCOPE(PROF_DISPLAY_NORMAL);
     lcd.setCursor(0, 0); 
     lcd.print("CO2: "); 
     lcd.print((long) ppm); 
@@ -173,169 +181,78 @@ void displayNormalMessage(float ppm, String qualityText){
  * @brief Activates all warning hardware outputs.
  *
  * Engages the full warning system including visual (LED), mechanical
- * (servo), and audible (buzzer) indicators. Includes a mechanical
- * stabilization delay for the servo.
+ * (servo), and audible (buzzer) indicators. The servo move only starts
+ * here and runs on from the servo task (motion.cpp).
  *
  * Side effects:
  *  - LED turned ON (visual warning)
- *  - Servo opened to 90° (ventilation/access indication)
- *  - Non-blocking buzzer pattern started
+ *  - Servo starts opening to 90° (ventilation/access indication)
+ *  - Alarm buzzer pattern started (buzzer.cpp)
  *  - Global warning state and timing set
  *  - Serial notification logged
- *  - 500ms blocking delay for servo stabilization
- *
- * Note: The buzzer uses non-blocking timing and must be updated
- *       regularly via updateBuzzer() from the main loop.
  */
 void activateWarningSystem(){ 
     digitalWrite(LED_output, HIGH); 
-    DoorServo.write(90); 
-    startBuzzer();  // Start the non-blocking buzzer pattern
+    motionMoveTo(MOTION_OPEN_ANGLE);    // ramps open over ~0.9 s, non-blocking
+    buzzerPlay(BUZZER_ALARM_CRITICAL);  // 500/50 ms, played by the Timer2 interrupt
     
     isWarningActive = true;
     warningStartTime = millis();
+    traceEvent(TRACE_WARNING_ON);
     Serial.println("WARNING SYSTEM ACTIVATED!");
-    delay(500);  // Mechanical stabilization delay for servo
-}
-
-/**
- * @brief Legacy blocking buzzer function - 
- * OBSOLETE; replaced with nonblocking routines
- *
- * DEPRECATED: This function blocks execution for 550ms, causing system
- * unresponsiveness. Replaced by updateBuzzer()/startBuzzer()/stopBuzzer()
- * non-blocking implementation.
- *
- * Original behavior: 500ms ON, 50ms OFF blocking pattern. Halts the entire program.
- *
- * Side effects:
- *  - Blocks execution for 550ms
- *  - Audible buzzer output
- *  - Freezes all other system functions during tone
- *
- * @warning Do not use in production. Retained only for reference.
- */
-void warning_buzzer(){ 
-    digitalWrite(Buzzer_output, HIGH); 
-    delay(500); 
-    digitalWrite(Buzzer_output, LOW); 
-    delay(50);
-}
-
-/**
- * @brief Updates the non-blocking buzzer state based on timing.
- *
- * Implements a state machine that toggles buzzer output between
- * 500ms ON and 50ms OFF states without blocking execution. Must be
- * called regularly from the main loop (every iteration recommended).
- *
- * State machine logic:
- *  - ON state: 500ms duration, buzzer HIGH
- *  - OFF state: 50ms duration, buzzer LOW
- *  - Repeats continuously while buzzerActive is true
- *
- * Timing:
- *  - Uses millis() for non-blocking time tracking
- *  - Maintains precise 500ms/50ms duty cycle
- *  - No drift over extended operation
- *
- * Note: This function does nothing if buzzerActive is false.
- *       Control via startBuzzer() and stopBuzzer().
- */
-void updateBuzzer() {
-    if (!buzzerActive) {
-        digitalWrite(Buzzer_output, LOW);
-        return;
-    }
-    
-    unsigned long currentTime = millis();
-    
-    if (buzzerState) {
-        // Currently ON, check if 500ms elapsed
-        if (currentTime - buzzerTimer >= 500) {
-            digitalWrite(Buzzer_output, LOW);  // Turn OFF
-            buzzerState = false;
-            buzzerTimer = currentTime;
-        }
-    } else {
-        // Currently OFF, check if 50ms elapsed
-        if (currentTime - buzzerTimer >= 50) {
-            digitalWrite(Buzzer_output, HIGH);  // Turn ON
-            buzzerState = true;
-            buzzerTimer = currentTime;
-        }
-    }
-}
-
-/**
- * @brief Starts the non-blocking buzzer warning pattern.
- *
- * Initializes the buzzer state machine and begins the 500ms ON,
- * 50ms OFF repeating pattern. The buzzer starts in the ON state
- * for immediate audible feedback.
- *
- * Side effects:
- *  - Sets buzzerActive flag to true
- *  - Initializes buzzerState to ON (true)
- *  - Records current time in buzzerTimer
- *  - Immediately sets buzzer output HIGH
- *
- * Note: updateBuzzer() must be called regularly after this to
- *       maintain proper timing.
- */
-void startBuzzer() {
-    buzzerActive = true;
-    buzzerState = true;  // Start with ON state
-    buzzerTimer = millis();
-    digitalWrite(Buzzer_output, HIGH);
-}
-
-/**
- * @brief Stops the non-blocking buzzer pattern.
- *
- * Deactivates the buzzer state machine and ensures the buzzer
- * output is turned off. Safe to call even if buzzer is not active.
- *
- * Side effects:
- *  - Sets buzzerActive flag to false
- *  - Resets buzzerState to OFF (false)
- *  - Ensures buzzer output is LOW
- *
- * Note: This function provides a clean shutdown of buzzer operation
- *       and prevents any residual buzzing.
- */
-void stopBuzzer() {
-    buzzerActive = false;
-    buzzerState = false;
-    digitalWrite(Buzzer_output, LOW);
 }
 
 /**
  * @brief Deactivates all warning hardware outputs.
  *
  * Shuts down the complete warning system, returning all components
- * to their normal operating state. Includes mechanical stabilization
- * delay for the servo.
+ * to their normal operating state. The servo closes along its motion
+ * profile without blocking.
  *
  * Side effects:
  *  - LED turned OFF
- *  - Servo returned to 0° (closed position)
- *  - Non-blocking buzzer pattern stopped
+ *  - Servo starts returning to 0° (closed position)
+ *  - Alarm buzzer pattern replaced by the recovery chirp
  *  - Global warning state cleared
  *  - Serial notification logged
- *  - 500ms blocking delay for servo stabilization
- *
- * Note: Includes redundant buzzer deactivation for safety.
  */
 void deactivateWarningSystem(){ 
     digitalWrite(LED_output, LOW); 
-    DoorServo.write(0); 
-    stopBuzzer();  // Stop the non-blocking buzzer pattern
-    
-    // Redundant safety - ensure buzzer is off
-    digitalWrite(Buzzer_output, LOW);
+    motionMoveTo(MOTION_CLOSED_ANGLE);
+    buzzerStop();                       // end the alarm loop, then chirp once
+    buzzerPlay(BUZZER_RECOVERY);
     
     isWarningActive = false;
+    traceEvent(TRACE_WARNING_OFF);
     Serial.println("Warning system deactivated.");
-    delay(500);  // Mechanical stabilization delay for servo (might be unnecessary)
+}
+
+//====================================================
+// Alarm Level Sound
+//====================================================
+
+/**
+ * @brief Keeps the buzzer on the pattern of the current alarm level.
+ *
+ * Call after the warning/normal handling on every evaluation. The
+ * critical level is the warning state, whose pattern and recovery chirp
+ * belong to activateWarningSystem() and deactivateWarningSystem(); the
+ * lower levels (alarm.cpp) get their own looping pattern, and the chirp
+ * when they clear.
+ *
+ * Parameters:
+ *  @param severity Current alarm level from alarmUpdate()
+ */
+void handleAlarmSound(AlarmSeverity severity) {
+    static AlarmSeverity sounding = ALARM_NONE;
+    if (severity == sounding) {
+        return;
+    }
+    if (severity != ALARM_NONE && severity != ALARM_CRITICAL) {
+        buzzerPlay(alarmPattern(severity));     // replaces the chirp after a critical alarm
+    } else if (severity == ALARM_NONE && sounding != ALARM_CRITICAL) {
+        buzzerStop();
+        buzzerPlay(BUZZER_RECOVERY);
+    }
+    sounding = severity;
 }
\ No newline at end of file
@@ -2,16 +2,14 @@
 #define RESPONSE_H
 
 #include <Arduino.h>
+#include "alarm.h"
 
 void handleWarningState(float ppm, String qualityText);
 void handleNormalState(float ppm, String qualityText);
 void displayWarningMessage(float ppm);
 void displayNormalMessage(float ppm, String qualityText);
 void activateWarningSystem();
-void warning_buzzer();
 void deactivateWarningSystem();
-void updateBuzzer();
-void startBuzzer();
-void stopBuzzer();
+void handleAlarmSound(AlarmSeverity severity);
 
 #endif
@@ -0,0 +1,259 @@
+/**
+ * @file sampler.cpp
+ * @brief Interrupt-driven, free-running ADC acquisition for the MQ-135.
+ *
+ * This module replaces busy-wait analogRead() calls on the main loop with
+ * a timer-triggered ADC that runs entirely in the background. Completed
+ * samples are handed to the main loop through a lock-free single-producer /
+ * single-consumer ring buffer.
+ *
+ * Acquisition chain (ATmega328P):
+ *  - Timer0 compare match A auto-triggers a conversion every 1.024 ms
+ *    (Timer0 is already running for millis(), so no extra timer is used)
+ *  - ADC_vect accumulates SAMPLER_DECIMATION conversions and pushes their
+ *    rounded mean into the ring buffer (~48.8 Hz with the default of 20)
+ *  - updatePPMReading() drains the ring buffer from the main loop
+ *
+ * Other code that needs a sensor reading (calibration, diagnostics) must go
+ * through readSensorADC() instead of analogRead(): while the sampler owns
+ * the ADC, a manual conversion would disturb the auto-trigger chain.
+ *
+ * Dependencies:
+ *  - globals.h : CO2_analog_pin
+ *
+ * Design notes:
+ *  - Timer1 (Servo) and Timer2 (buzzer.cpp) are left untouched
+ *  - Ring indices are single bytes, so reads and writes are atomic on AVR
+ *  - When the buffer is full the newest sample is dropped and counted
+ *  - On non-AVR targets the sampler falls back to polling analogRead()
+ *    every SAMPLER_PERIOD_MS from samplerPop()
+ */
+
+#include "sampler.h"
+#include "globals.h"
+#include "profile.h"
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#endif
+
+//====================================================
+// Ring Buffer State
+//====================================================
+
+static const uint8_t SAMPLER_INDEX_MASK = SAMPLER_BUFFER_SIZE - 1;
+
+static volatile uint16_t sampleBuffer[SAMPLER_BUFFER_SIZE];
+static volatile uint8_t sampleHead = 0;         // written by the producer (ISR) only
+static volatile uint8_t sampleTail = 0;         // written by the consumer (main loop) only
+static volatile uint16_t overrunCount = 0;      // samples dropped on a full buffer
+static volatile uint16_t latestSample = 0;      // most recent sample, for readSensorADC()
+static volatile bool samplerRunning = false;
+
+/**
+ * @brief Pushes one sample into the ring buffer (producer side).
+ *
+ * Called from the ADC interrupt on AVR, or from the polled fallback
+ * elsewhere. Never blocks: if the consumer has fallen behind, the
+ * sample is discarded and the overrun counter is incremented.
+ *
+ * Parameters:
+ *  @param raw Averaged 10-bit ADC code
+ */
+static inline void samplerPush(uint16_t raw) {
+    uint8_t head = sampleHead;
+    uint8_t next = (head + 1) & SAMPLER_INDEX_MASK;
+
+    latestSample = raw;
+    if (next == sampleTail) {
+        overrunCount++;
+        return;
+    }
+    sampleBuffer[head] = raw;
+    sampleHead = next;          // publish only after the slot is written
+}
+
+//====================================================
+// Acquisition Backend
+//====================================================
+
+#if defined(__AVR__)
+
+/**
+ * @brief ADC conversion-complete interrupt.
+ *
+ * Re-arms the Timer0 compare trigger (the auto-trigger fires on the
+ * rising edge of OCF0A, so the flag must be cleared by hand since no
+ * TIMER0_COMPA handler exists) and decimates conversions into samples.
+ */
+ISR(ADC_vect) {
+    PROFILE_SCOPE(PROF_SAMPLER_ISR);
+    static uint16_t accumulator = 0;
+    static uint8_t conversions = 0;
+
+    TIFR0 = _BV(OCF0A);
+    accumulator += ADC;
+    if (++conversions >= SAMPLER_DECIMATION) {
+        samplerPush((accumulator + SAMPLER_DECIMATION / 2) / SAMPLER_DECIMATION);
+        accumulator = 0;
+        conversions = 0;
+    }
+}
+
+#else
+
+static unsigned long lastPollTime = 0;
+
+/**
+ * @brief Software stand-in for the ADC interrupt on non-AVR targets.
+ *
+ * Takes one analogRead() per SAMPLER_PERIOD_MS. Missed periods are not
+ * back-filled, since past readings cannot be recovered.
+ */
+static void samplerPoll() {
+    if (!samplerRunning) {
+        return;
+    }
+    unsigned long now = millis();
+    if (now - lastPollTime >= SAMPLER_PERIOD_MS) {
+        lastPollTime = now;
+        samplerPush(analogRead(CO2_analog_pin));
+    }
+}
+
+#endif
+
+//====================================================
+// Public Interface
+//====================================================
+
+/**
+ * @brief Starts free-running acquisition on the MQ-135 analog pin.
+ *
+ * Configures the ADC for AVcc reference (same as analogRead() with the
+ * DEFAULT reference), prescaler 128 and Timer0 compare match A as the
+ * auto-trigger source, then enables the conversion interrupt.
+ *
+ * Side effects:
+ *  - Clears any samples left in the ring buffer
+ *  - From this point on, analogRead() must not be used on any pin
+ */
+void samplerBegin() {
+    sampleHead = 0;
+    sampleTail = 0;
+    overrunCount = 0;
+    latestSample = analogRead(CO2_analog_pin);
+
+#if defined(__AVR__)
+    uint8_t channel = (CO2_analog_pin >= A0) ? CO2_analog_pin - A0 : CO2_analog_pin;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ADMUX  = _BV(REFS0) | (channel & 0x07);
+        ADCSRB = _BV(ADTS1) | _BV(ADTS0);       // trigger: Timer0 compare match A
+        DIDR0 |= _BV(channel & 0x07);           // digital input buffer not needed
+        TIFR0  = _BV(OCF0A);
+        ADCSRA = _BV(ADEN) | _BV(ADATE) | _BV(ADIE)
+               | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+        samplerRunning = true;
+    }
+#else
+    lastPollTime = millis();
+    samplerRunning = true;
+#endif
+    Serial.println("Initializing ADC sampler ...");
+}
+
+/**
+ * @brief Stops free-running acquisition and hands the ADC back.
+ *
+ * Restores the register state expected by analogRead().
+ */
+void samplerEnd() {
+#if defined(__AVR__)
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ADCSRA = _BV(ADEN) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+        ADCSRB = 0;
+        samplerRunning = false;
+    }
+#else
+    samplerRunning = false;
+#endif
+}
+
+/**
+ * @brief Reports whether the sampler currently owns the ADC.
+ */
+bool samplerIsRunning() {
+    return samplerRunning;
+}
+
+/**
+ * @brief Removes the oldest pending sample (consumer side).
+ *
+ * Parameters:
+ *  @param raw Receives the averaged 10-bit ADC code
+ *
+ * Returns:
+ *  @return true  - A sample was written to raw
+ *  @return false - The buffer is empty
+ */
+bool samplerPop(uint16_t *raw) {
+#if !defined(__AVR__)
+    samplerPoll();
+#endif
+    uint8_t tail = sampleTail;
+    if (tail == sampleHead) {
+        return false;
+    }
+    *raw = sampleBuffer[tail];
+    sampleTail = (tail + 1) & SAMPLER_INDEX_MASK;   // release the slot
+    return true;
+}
+
+/**
+ * @brief Returns the number of samples waiting to be drained.
+ */
+uint8_t samplerPending() {
+    return (sampleHead - sampleTail) & SAMPLER_INDEX_MASK;
+}
+
+/**
+ * @brief Returns the number of samples dropped on a full buffer.
+ */
+uint16_t samplerOverruns() {
+    uint16_t count;
+#if defined(__AVR__)
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        count = overrunCount;
+    }
+#else
+    count = overrunCount;
+#endif
+    return count;
+}
+
+/**
+ * @brief Reads the MQ-135 analog output without disturbing the sampler.
+ *
+ * Returns the most recent sampler output while acquisition is running,
+ * otherwise performs a plain analogRead(). Use this everywhere a single
+ * sensor reading is needed.
+ *
+ * Returns:
+ *  @return int - ADC code (0-1023)
+ */
+int readSensorADC() {
+    if (!samplerRunning) {
+        return analogRead(CO2_analog_pin);
+    }
+    uint16_t value;
+#if defined(__AVR__)
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        value = latestSample;
+    }
+#else
+    samplerPoll();
+    value = latestSample;
+#endif
+    return value;
+}
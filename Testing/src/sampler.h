@@ -0,0 +1,21 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <Arduino.h>
+
+//---------------------------
+// Sampler configuration
+//---------------------------
+const uint8_t SAMPLER_BUFFER_SIZE = 32;     // ring capacity, must be a power of two
+const uint8_t SAMPLER_DECIMATION = 20;      // ADC conversions averaged per sample
+const unsigned long SAMPLER_PERIOD_MS = 20; // sample period of the polled (non-AVR) fallback
+
+void samplerBegin();
+void samplerEnd();
+bool samplerIsRunning();
+bool samplerPop(uint16_t *raw);
+uint8_t samplerPending();
+uint16_t samplerOverruns();
+int readSensorADC();
+
+#endif
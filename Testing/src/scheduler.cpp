@@ -0,0 +1,219 @@
+/**
+ * @file scheduler.cpp
+ * @brief Static-table cooperative scheduler with deadline and overrun accounting.
+ *
+ * Replaces the separate millis() gates in loop() (20 ms sampling, the
+ * 1000 ms processing block, ...) with one table of tasks that all run
+ * from the same tick: each schedulerRun() pass reads millis() once (the
+ * Timer0 tick already kept by the core), picks the most urgent released
+ * task, and runs it to completion. Tasks are plain functions and must
+ * not block; a long task delays everything behind it, and the accounting
+ * below shows by how much.
+ *
+ * Every task is periodic: released every periodMs from schedulerBegin(),
+ * on a fixed grid, so the rate does not drift with run time.
+ *
+ * Selection: among the released tasks the lowest priority value wins;
+ * ties go to the earlier table entry. One task runs per pass, so an
+ * urgent task waits for at most one other task, never a whole sweep.
+ *
+ * Accounting, per task:
+ *  - lateness: start time minus release time; the worst case is kept,
+ *    and a start later than deadlineMs counts as a deadline miss
+ *  - overruns: releases of a periodic task that passed before it ran.
+ *    They are skipped, not queued: a late sensor task still drains
+ *    every pending sample in one run
+ *  - run time: count, total and worst case in microseconds
+ * Slack (deadline - worst lateness) and the idle share of the CPU are
+ * printed by schedulerReport() (console command "tasks").
+ *
+ * Idle: when no task is released the CPU sleeps until the next interrupt
+ * (SLEEP_MODE_IDLE keeps Timer0, the ADC trigger and the UART running,
+ * so the tick, the sampler and serial input all wake it). On the native
+ * build idle is a delay() until the next release, which the simulator's
+ * virtual clock skips instantly.
+ *
+ * Dependencies:
+ *  - none (the task table and functions come from main.cpp)
+ *
+ * Memory:
+ *  - 8 bytes per task in the caller's table and 22 in its state (AVR),
+ *    15 bytes here
+ */
+
+#include "scheduler.h"
+
+#if defined(__AVR__)
+#include <avr/sleep.h>
+#endif
+
+static const Task *tasks = 0;
+static TaskState *states = 0;
+static uint8_t taskCount = 0;
+static uint32_t windowStart = 0;        // millis() of the last reset
+static uint32_t idleMillis = 0;
+static uint16_t idleMicros = 0;         // remainder below 1 ms
+
+//====================================================
+// Idle
+//====================================================
+
+/**
+ * @brief Waits for the next release without spinning.
+ *
+ * Parameters:
+ *  @param waitMs Milliseconds until the next release
+ */
+static void schedulerIdle(uint32_t waitMs) {
+    uint32_t start = micros();
+#if defined(__AVR__)
+    (void)waitMs;
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    noInterrupts();
+    sleep_enable();
+    interrupts();                       // sei; sleep runs before any pending ISR
+    sleep_cpu();
+    sleep_disable();
+#else
+    delay(waitMs);
+#endif
+    uint32_t slept = micros() - start;
+    idleMillis += slept / 1000;
+    idleMicros += slept % 1000;
+    if (idleMicros >= 1000) {
+        idleMicros -= 1000;
+        idleMillis++;
+    }
+}
+
+//====================================================
+// Public Interface
+//====================================================
+
+/**
+ * @brief Installs the task table and releases every task now.
+ *
+ * Parameters:
+ *  @param table Caller-owned task configurations
+ *  @param state Caller-owned state, one per task (zeroed)
+ *  @param count Number of entries
+ */
+void schedulerBegin(const Task *table, TaskState *state, uint8_t count) {
+    tasks = table;
+    states = state;
+    taskCount = count;
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < taskCount; i++) {
+        states[i].release = now;
+    }
+    schedulerReset();
+}
+
+/**
+ * @brief Runs the most urgent released task, or idles until one is due.
+ *
+ * Call from loop() on every pass.
+ *
+ * Returns:
+ *  @return true  - A task ran
+ *  @return false - Nothing was released; the CPU idled
+ */
+bool schedulerRun() {
+    uint32_t now = millis();
+    int8_t next = -1;
+    uint32_t wait = 0xFFFFFFFFUL;
+
+    for (uint8_t i = 0; i < taskCount; i++) {
+        const TaskState &s = states[i];
+        int32_t until = (int32_t)(s.release - now);
+        if (until > 0) {
+            if ((uint32_t)until < wait) {
+                wait = until;
+            }
+        } else if (next < 0 || tasks[i].priority < tasks[next].priority) {
+            next = i;
+        }
+    }
+    if (next < 0) {
+        schedulerIdle(wait == 0xFFFFFFFFUL ? 1 : wait);
+        return false;
+    }
+
+    const Task &t = tasks[next];
+    TaskState &s = states[next];
+    uint32_t late = now - s.release;
+    if (late > s.maxLateMs) {
+        s.maxLateMs = late > 0xFFFF ? 0xFFFF : late;
+    }
+    if (late > t.deadlineMs && s.deadlineMisses < 0xFFFF) {
+        s.deadlineMisses++;
+    }
+    uint32_t skipped = late / t.periodMs;
+    s.overruns = (s.overruns + skipped > 0xFFFF) ? 0xFFFF : s.overruns + skipped;
+    s.release += (skipped + 1) * t.periodMs;
+
+    uint32_t start = micros();
+    t.run();
+    uint32_t elapsed = micros() - start;
+
+    if (s.runs < 0xFFFFFFFFUL) {
+        s.runs++;
+    }
+    s.totalMicros = (s.totalMicros + elapsed < s.totalMicros) ? 0xFFFFFFFFUL : s.totalMicros + elapsed;
+    if (elapsed > s.maxMicros) {
+        s.maxMicros = elapsed;
+    }
+    return true;
+}
+
+/**
+ * @brief Clears the accounting of every task and the idle counter.
+ */
+void schedulerReset() {
+    for (uint8_t i = 0; i < taskCount; i++) {
+        TaskState &s = states[i];
+        s.runs = 0;
+        s.totalMicros = 0;
+        s.maxMicros = 0;
+        s.maxLateMs = 0;
+        s.deadlineMisses = 0;
+        s.overruns = 0;
+    }
+    windowStart = millis();
+    idleMillis = 0;
+    idleMicros = 0;
+}
+
+//====================================================
+// Report
+//====================================================
+
+/**
+ * @brief Prints the task table and CPU load (console command "tasks").
+ *
+ * Output format (run times in microseconds, the rest in milliseconds):
+ *  task prio period deadline runs mean max late slack misses overruns
+ *  idle share of the time since the last reset
+ */
+void schedulerReport() {
+    Serial.println(F("--- tasks (run us, rest ms) ---"));
+    Serial.println(F("task prio period deadline runs mean max late slack misses overruns"));
+    for (uint8_t i = 0; i < taskCount; i++) {
+        const Task &t = tasks[i];
+        const TaskState &s = states[i];
+        Serial.print(t.name);
+        Serial.print(' '); Serial.print(t.priority);
+        Serial.print(' '); Serial.print(t.periodMs);
+        Serial.print(' '); Serial.print(t.deadlineMs);
+        Serial.print(' '); Serial.print(s.runs);
+        Serial.print(' '); Serial.print(s.runs ? s.totalMicros / s.runs : 0);
+        Serial.print(' '); Serial.print(s.maxMicros);
+        Serial.print(' '); Serial.print(s.maxLateMs);
+        Serial.print(' '); Serial.print((long)t.deadlineMs - (long)s.maxLateMs);
+        Serial.print(' '); Serial.print(s.deadlineMisses);
+        Serial.print(' '); Serial.println(s.overruns);
+    }
+    uint32_t window = millis() - windowStart;
+    Serial.print(F("idle ")); Serial.print(window ? idleMillis * 100.0 / window : 0.0, 1);
+    Serial.print(F(" % of ")); Serial.print(window / 1000); Serial.println(F(" s"));
+}
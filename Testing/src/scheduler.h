@@ -0,0 +1,39 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+//---------------------------
+// Cooperative task scheduler
+//---------------------------
+// The caller (main.cpp) owns two parallel static arrays: a const table
+// of task configurations and one TaskState per task, which starts
+// zeroed. Lower priority values run first.
+
+typedef void (*TaskFunction)();
+
+struct Task {
+    TaskFunction run;
+    const char *name;
+    uint16_t periodMs;          // release period, > 0
+    uint16_t deadlineMs;        // allowed start lateness after release
+    uint8_t priority;           // 0 = most urgent
+};
+
+// State and accounting of one task
+struct TaskState {
+    uint32_t release;           // millis() of the pending release
+    uint32_t runs;
+    uint32_t totalMicros;       // saturating
+    uint32_t maxMicros;
+    uint16_t maxLateMs;
+    uint16_t deadlineMisses;    // started more than deadlineMs late
+    uint16_t overruns;          // releases skipped because the previous one was still pending
+};
+
+void schedulerBegin(const Task *table, TaskState *state, uint8_t count);
+bool schedulerRun();
+void schedulerReset();
+void schedulerReport();
+
+#endif
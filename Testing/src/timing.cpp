@@ -0,0 +1,191 @@
+/**
+ * @file timing.cpp
+ * @brief Per-section loop() timing, loop period and sampler lateness.
+ *
+ * Answers "where does the time go" in the field. Every loop() pass is
+ * split into sections by TIMING_MARK(); each mark costs one micros() read
+ * and a few additions. For each section the total, call count and worst
+ * case are kept. The loop period (start to start) and the sampler
+ * lateness go into fixed histograms:
+ *
+ *  - loop period: how long the main loop was away; blocking calls such as
+ *    activateWarningSystem() or performRegularRecalibration() show up here
+ *  - sampler lateness: how far past SAMPLER_PERIOD_MS the sampler was
+ *    serviced. With the ADC interrupt sampler the samples wait in the
+ *    ring (and are lost as overruns beyond SAMPLER_BUFFER_SIZE periods);
+ *    with the polled fallback the sample itself is late
+ *
+ * With TASK_SCHEDULER a loop() pass runs one task or idles, so its period
+ * says nothing about the sampler; the loop period and lateness are not
+ * kept, and per-task lateness comes from the scheduler (console "tasks").
+ * The sections and the sampler overrun count still apply.
+ *
+ * Counters saturate rather than wrap. Totals are 32-bit microseconds,
+ * good for about 71 minutes per section before timingReset() is needed.
+ *
+ * Dependencies:
+ *  - sampler.h : sample period and overrun count for the report
+ *
+ * Memory:
+ *  - ~130 bytes of SRAM; compiled out entirely with LOOP_TIMING=0
+ */
+
+#include "timing.h"
+#include "sampler.h"
+#include <string.h>
+
+//====================================================
+// Counters
+//====================================================
+
+struct SectionStats {
+    uint32_t totalMicros;
+    uint32_t maxMicros;
+    uint32_t count;
+};
+
+static SectionStats sections[TIMING_SECTION_COUNT];
+static uint32_t lastMark = 0;
+
+#if !TASK_SCHEDULER
+// Histogram bucket upper bounds (us); the last bucket is open-ended.
+static const uint32_t bucketLimits[TIMING_BUCKETS - 1] = {
+    1000, 5000, 20000, 50000, 100000, 500000, 1000000
+};
+
+static uint32_t periodHistogram[TIMING_BUCKETS];
+static uint32_t latenessHistogram[TIMING_BUCKETS];
+static uint32_t maxPeriod = 0;
+static uint32_t maxLateness = 0;
+static uint32_t loopStart = 0;
+static bool started = false;
+
+static void countBucket(uint32_t *histogram, uint32_t micros) {
+    uint8_t i = 0;
+    while (i < TIMING_BUCKETS - 1 && micros >= bucketLimits[i]) {
+        i++;
+    }
+    if (histogram[i] < 0xFFFFFFFFUL) {
+        histogram[i]++;
+    }
+}
+#endif
+
+//====================================================
+// Recording
+//====================================================
+
+/**
+ * @brief Marks the start of a loop() pass.
+ *
+ * Records the period since the previous pass and the resulting sampler
+ * lateness (not with TASK_SCHEDULER), then opens the first section.
+ */
+void timingLoopStart() {
+    uint32_t now = micros();
+#if !TASK_SCHEDULER
+    if (started) {
+        uint32_t period = now - loopStart;
+        if (period > maxPeriod) {
+            maxPeriod = period;
+        }
+        countBucket(periodHistogram, period);
+
+        const uint32_t samplePeriod = SAMPLER_PERIOD_MS * 1000UL;
+        if (period > samplePeriod) {
+            uint32_t late = period - samplePeriod;
+            if (late > maxLateness) {
+                maxLateness = late;
+            }
+            countBucket(latenessHistogram, late);
+        }
+    }
+    started = true;
+    loopStart = now;
+#endif
+    lastMark = now;
+}
+
+/**
+ * @brief Charges the time since the previous mark to a section.
+ */
+void timingMark(TimingSection section) {
+    uint32_t now = micros();
+    uint32_t elapsed = now - lastMark;
+    lastMark = now;
+
+    SectionStats &s = sections[section];
+    s.totalMicros = (s.totalMicros + elapsed < s.totalMicros) ? 0xFFFFFFFFUL : s.totalMicros + elapsed;
+    if (s.count < 0xFFFFFFFFUL) {
+        s.count++;
+    }
+    if (elapsed > s.maxMicros) {
+        s.maxMicros = elapsed;
+    }
+}
+
+/**
+ * @brief Clears every counter; the next loop() pass starts a new period.
+ */
+void timingReset() {
+    memset(sections, 0, sizeof(sections));
+#if !TASK_SCHEDULER
+    memset(periodHistogram, 0, sizeof(periodHistogram));
+    memset(latenessHistogram, 0, sizeof(latenessHistogram));
+    maxPeriod = 0;
+    maxLateness = 0;
+    started = false;
+#endif
+}
+
+//====================================================
+// Report
+//====================================================
+
+#if !TASK_SCHEDULER
+static void printHistogram(const char *label, const uint32_t *histogram) {
+    Serial.print(label);
+    for (uint8_t i = 0; i < TIMING_BUCKETS; i++) {
+        Serial.print(i < TIMING_BUCKETS - 1 ? F(" <") : F(" >="));
+        Serial.print((i < TIMING_BUCKETS - 1 ? bucketLimits[i] : bucketLimits[i - 1]) / 1000);
+        Serial.print(F("ms:"));
+        Serial.print(histogram[i]);
+    }
+    Serial.println();
+}
+#endif
+
+/**
+ * @brief Prints all counters to Serial (console command "timing").
+ *
+ * Output format (times in microseconds):
+ *  section  count  total  mean  max
+ *  loop period max / histogram, sampler lateness max / histogram / overruns
+ *  (TASK_SCHEDULER: sampler overruns only)
+ */
+void timingDump() {
+    static const char *const names[TIMING_SECTION_COUNT] = {
+        "sampling", "processing", "lcd", "serial", "buzzer"
+    };
+
+    Serial.println(F("--- loop timing (us) ---"));
+    Serial.println(F("section count total mean max"));
+    for (uint8_t i = 0; i < TIMING_SECTION_COUNT; i++) {
+        const SectionStats &s = sections[i];
+        Serial.print(names[i]);
+        Serial.print(' '); Serial.print(s.count);
+        Serial.print(' '); Serial.print(s.totalMicros);
+        Serial.print(' '); Serial.print(s.count ? s.totalMicros / s.count : 0);
+        Serial.print(' '); Serial.println(s.maxMicros);
+    }
+#if TASK_SCHEDULER
+    Serial.print(F("sampler overruns ")); Serial.println(samplerOverruns());
+    Serial.println(F("per-task lateness: tasks"));
+#else
+    Serial.print(F("loop period max ")); Serial.println(maxPeriod);
+    printHistogram("loop period", periodHistogram);
+    Serial.print(F("sampler late max ")); Serial.print(maxLateness);
+    Serial.print(F(" overruns ")); Serial.println(samplerOverruns());
+    printHistogram("sampler late", latenessHistogram);
+#endif
+}
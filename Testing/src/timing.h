@@ -0,0 +1,38 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <Arduino.h>
+#include "config.h"
+
+//---------------------------
+// Loop timing instrumentation
+//---------------------------
+// TIMING_LOOP_START() opens a loop() pass; each TIMING_MARK(section)
+// charges the time since the previous mark to that section. With
+// LOOP_TIMING=0 both expand to nothing and the module is not referenced.
+
+enum TimingSection {
+    TIMING_SAMPLING,
+    TIMING_PROCESSING,
+    TIMING_LCD,
+    TIMING_SERIAL,
+    TIMING_BUZZER,
+    TIMING_SECTION_COUNT
+};
+
+const uint8_t TIMING_BUCKETS = 8;
+
+void timingLoopStart();
+void timingMark(TimingSection section);
+void timingReset();
+void timingDump();
+
+#if LOOP_TIMING
+#define TIMING_LOOP_START() timingLoopStart()
+#define TIMING_MARK(section) timingMark(section)
+#else
+#define TIMING_LOOP_START() ((void)0)
+#define TIMING_MARK(section) ((void)0)
+#endif
+
+#endif
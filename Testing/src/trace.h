@@ -0,0 +1,33 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+//---------------------------
+// State-transition trace points
+//---------------------------
+// Compiled out on the board. The native build forwards each event, with
+// its (virtual) timestamp, to the simulator.
+
+enum TraceEvent {
+    TRACE_PREHEAT_START,
+    TRACE_PREHEAT_DONE,
+    TRACE_CALIBRATION_START,
+    TRACE_CALIBRATION_DONE,
+    TRACE_CALIBRATION_ABORTED,
+    TRACE_SYSTEM_READY,
+    TRACE_RECALIBRATION_DUE,
+    TRACE_WARNING_ON,
+    TRACE_WARNING_OFF,
+    TRACE_R0_REESTIMATED,
+    TRACE_CALIBRATION_RESTORED,
+    TRACE_DRIFT_DETECTED,
+    TRACE_SERVO_IN_POSITION,
+    TRACE_EVENT_COUNT
+};
+
+#if defined(NATIVE_HAL)
+void traceEvent(TraceEvent event);
+#else
+inline void traceEvent(TraceEvent event) { (void)event; }
+#endif
+
+#endif
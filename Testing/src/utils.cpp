@@ -20,82 +20,109 @@
  *
  * Dependencies:
  *  - globals.h : shared system state, calibration constants, and hardware pins
+ *  - curve.h   : compile-time calibration curve (ActiveCurve)
+ *  - envcomp.h : temperature/humidity Rs scale (ENV_COMPENSATION)
  *  - utils.h   : function declarations and constants
  *
  * Design notes:
- *  - Implements a 50Hz sampling rate (20ms intervals) for responsive detection
- *  - Uses a circular buffer for moving average calculation
+ *  - Samples arrive at ~50Hz from the interrupt-driven sampler (sampler.cpp)
+ *  - Uses a running-sum circular buffer (average.cpp) for the moving average
  *  - Exponential formula derived from MQ-135 datasheet characteristics
- *  - All floating-point operations optimized for 8-bit microcontroller
+ *  - PPM math runs in Q16.16 fixed point (fixedmath.cpp) unless
+ *    SENSOR_MATH_FIXED is set to 0 in config.h, which restores the float path
  */
 
 #include "utils.h"
 #include "globals.h"
+#include "sampler.h"
+#include "lut.h"
+#include "fixedmath.h"
+#include "profile.h"
+#include "envcomp.h"
 
 //====================================================
 // Sensor Reading
 //====================================================
 
 /**
- * @brief Samples the MQ-135 sensor and updates the moving average buffer.
+ * @brief Drains the ADC sampler and updates the moving average buffer.
  *
- * Executes at 20ms intervals (50Hz) to maintain responsive detection while
- * providing sufficient filtering against electrical noise. Each sample is
- * converted to PPM and stored in a circular buffer for later averaging.
- *
- * Timing control:
- *  - Uses non-blocking millis() comparison for precise 20ms intervals
- *  - Maintains lastSampleTime to prevent drift
+ * The sampler (see sampler.cpp) acquires the MQ-135 output in the
+ * background at ~50Hz. Every sample that arrived since the previous call
+ * is pushed into the moving average window, so the window holds genuinely
+ * distinct readings regardless of how often the main loop gets around to
+ * calling this function.
  *
  * Data flow:
- *  - Reads current sensor voltage from global variable
- *  - Converts voltage to PPM using calculatePPM()
- *  - Stores result in ppmReadings circular buffer
- *  - Updates readingIndex for next sample
+ *  - Pops raw ADC codes from the sampler ring buffer
+ *  - Pushes them unconverted into sensorWindow (O(1) per sample)
+ *  - Updates lastSampleTime
  *
- * Note: The function expects sensor_voltage to be updated elsewhere
- *       (typically by MQ135SensorDirectData()).
+ * Note: Should be called every loop pass. If the loop stalls for longer
+ *       than the ring buffer covers (~650ms), the oldest samples are kept
+ *       and newer ones are counted as overruns by the sampler.
  */
 void updatePPMReading() {
-    if (millis() - lastSampleTime >= 20) {
+    PROFILE_SCOPE(PROF_UPDATE_PPM);
+    uint16_t raw;
+    while (samplerPop(&raw)) {
         lastSampleTime = millis();
-        float samplePPM = calculatePPM(sensor_voltage);
-        ppmReadings[readingIndex] = samplePPM;
-        readingIndex = (readingIndex + 1) % SAMPLES_PER_READING;
+        movingAveragePush(&sensorWindow, raw);
     }
 }
 
 /**
- * @brief Calculates the moving average of valid PPM readings.
+ * @brief Calculates the moving average CO2 concentration.
  *
- * Computes the arithmetic mean of all non-zero samples in the circular buffer.
- * This provides stable readings by filtering out transient spikes and sensor noise.
+ * Takes the mean ADC code of the sample window (maintained incrementally
+ * by a running sum) and converts it to PPM once through the calibration
+ * table (see lut.cpp). The filter therefore
+ * operates in the linear ADC domain before the power-law conversion,
+ * which keeps single noisy samples from dominating the exponential curve.
  *
  * Filter characteristics:
  *  - Buffer size: SAMPLES_PER_READING (typically 50)
  *  - Time window: ~1 second at 50Hz sampling
- *  - Response time: <1 second for significant concentration changes
+ *  - Cost: one divide plus one table lookup, independent of window size
  *
  * Returns:
  *  @return float - Average CO2 concentration in PPM
- *  @return 0.0 - If no valid samples are available (should not occur in normal operation)
- *
- * Edge cases:
- *  - Ignores zero values (uninitialized buffer positions)
- *  - Returns zero if buffer contains no valid samples
+ *  @return 0.0 - If no samples have been taken yet
  */
 float getAveragePPM() {
-    float sum = 0;
-    int validSamples = 0;
-    for (int i = 0; i < SAMPLES_PER_READING; i++) {
-        if (ppmReadings[i] > 0) {
-            sum += ppmReadings[i];
-            validSamples++;
-        }
+    PROFILE_SCOPE(PROF_AVERAGE_PPM);
+    if (movingAverageCount(&sensorWindow) == 0) {
+        return 0;
+    }
+    return lutLookupPPM(movingAverageMean(&sensorWindow));
+}
+
+#if SENSOR_MATH_FIXED
+/**
+ * @brief Returns log2(k * R0 / RL) in Q16, recomputed only when k or R0 changes.
+ *
+ * With ENV_COMPENSATION, R0 is taken at the current conditions (R0 times
+ * the correction factor), which is the same as compensating every Rs.
+ */
+static q16_t curveLog2Scale() {
+    static float cachedR0 = -1.0f;
+    static float cachedRatio = -1.0f;
+    static q16_t log2Scale = 0;
+#if ENV_COMPENSATION
+    float r0 = R0 * envFactor();
+#else
+    float r0 = R0;
+#endif
+    if (r0 != cachedR0 || ActiveCurve::cleanAirRatio() != cachedRatio) {
+        cachedR0 = r0;
+        cachedRatio = ActiveCurve::cleanAirRatio();
+        log2Scale = fxLog2Scale(cachedRatio, r0, RL);
     }
-    return (validSamples > 0) ? sum / validSamples : 0;
+    return log2Scale;
 }
 
+#endif
+
 /**
  * @brief Calculates the sensor resistance Rs from voltage reading.
  *
@@ -115,9 +142,16 @@ float getAveragePPM() {
  *
  * Formula: Rs = ((Vcc / Vout) - 1) * RL
  * Where: Vcc = 5.0V, RL = 20.0 kΩ (from datasheet)
+ *
+ * With ENV_COMPENSATION the result is scaled to the reference temperature
+ * and humidity by the cached factor from envcomp.cpp (one multiply).
  */
 float calculateRs(float sensor_volt) {    
+#if ENV_COMPENSATION
+    return ((5.0 / sensor_volt) - 1.0) * RL * envRsScale();
+#else
     return ((5.0 / sensor_volt) - 1.0) * RL;
+#endif
 }
 
 /**
@@ -128,8 +162,10 @@ float calculateRs(float sensor_volt) {
  *
  * Calibration basis:
  *  - Derived from MQ-135 datasheet response curve
- *  - Assumes 400 PPM in clean air corresponds to Rs/R0 = 1.8
+ *  - Assumes 400 PPM in clean air corresponds to Rs/R0 = k
  *  - Uses power law approximation for full concentration range
+ *  - k and n come from ActiveCurve (curve.h, CO2_CURVE in config.h):
+ *    1.8 and 10 (empirical, default) or 1.09 and 3.9216
  *
  * Parameters:
  *  @param sensor_volt - Measured analog voltage (0-5V)
@@ -137,28 +173,48 @@ float calculateRs(float sensor_volt) {
  * Returns:
  *  @return float - Estimated CO2 concentration in parts per million
  *
- * Formula: PPM = 400 * (1.8 / (Rs/R0))^10
+ * Formula: PPM = 400 * (k / (Rs/R0))^n
  * Where: Rs/R0 is the normalized sensor resistance
  *
  * Note: This provides a reasonable approximation but is not laboratory-grade
  *       accuracy. Regular calibration in known conditions is essential.
  */
 float calculatePPM(float sensor_volt) {
+    PROFILE_SCOPE(PROF_CALCULATE_PPM);
+#if SENSOR_MATH_FIXED
+    // Voltage as a Q16 fraction of Vcc: finer than whole millivolts, whose
+    // rounding the exponent-10 curve would amplify at low voltages.
+    float level = sensor_volt * (65536.0f / 5.0f);
+    if (level <= 0.0f || level >= 65536.0f) {
+        return 0.0f;
+    }
+    return fxSensorPPM((uint32_t)(level + 0.5f), 65536UL, curveLog2Scale(), curveExponentQ16<ActiveCurve>());
+#else
     float Rs = calculateRs(sensor_volt);
     float ratio = Rs / R0;
-    
-    // Old formula:
-    // return 400.0f * pow(1.8f / ratio, 10.0f);
-    
-    // New formula based on: Rs/R0 = 1.09 * (PPM/400)^(-0.255)
-    // Rearranged to: PPM = 400 * [1.09 / (Rs/R0)]^(1/0.255)
-    // Where 1/0.255 ≈ 3.9216
-    if (ratio > 0) {
-        //return 400.0f * pow(1.09f / ratio, 3.9216f);
-        return 400.0f * pow(1.8f / ratio, 10.0f);
-    } else {
-        return 0.0f;  // Avoid division by zero
-    }
+    return curvePPM<ActiveCurve>(ratio);   // 0 for ratio <= 0 (no division by zero)
+#endif
+}
+
+/**
+ * @brief Converts an integer ADC code to CO2 concentration (PPM).
+ *
+ * Same transfer function as calculatePPM(), but takes the ADC code
+ * directly. In the fixed-point build the code/1023 fraction is exact, so
+ * this path involves no float arithmetic at all (used by the PPM table).
+ *
+ * Parameters:
+ *  @param code - ADC code (0-1023)
+ *
+ * Returns:
+ *  @return float - Estimated CO2 concentration in parts per million
+ */
+float calculatePPMFromCode(uint16_t code) {
+#if SENSOR_MATH_FIXED
+    return fxSensorPPM(code, 1023, curveLog2Scale(), curveExponentQ16<ActiveCurve>());
+#else
+    return calculatePPM(code * (5.0 / 1023.0));
+#endif
 }
 
 //============================================================================
@@ -254,7 +310,7 @@ String getQualityText(int level) {
 void debugSensorValues() {
     Serial.println("\n=== SENSOR DIAGNOSTICS ===");
     for (int i=0; i<3; i++) {
-        int raw = analogRead(CO2_analog_pin);
+        int raw = readSensorADC();
         float volt = raw * (5.0/1023.0);
         float Rs = calculateRs(volt);
         float ratio = Rs / R0;
@@ -319,9 +375,11 @@ void logSensorData(float ppm, String qualityText) {
  *
  * Note: The digital output threshold is factory-set and may not align with
  *       the system's PPM_THRESHOLD. Used primarily as a hardware backup.
+ *       The analog value comes from readSensorADC(), i.e. the latest
+ *       sampler output once acquisition is running.
  */
 void MQ135SensorDirectData() {
-    adc = analogRead(CO2_analog_pin);
+    adc = readSensorADC();
     d0  = digitalRead(CO2_digital_pin);
     sensor_voltage = adc * (5.0 / 1023.0);
 }
@@ -354,7 +412,7 @@ void MQ135SensorDirectData() {
  */
 void debugSensor() {
     float Rs = calculateRs(sensor_voltage);
-    float ppm = calculatePPM(sensor_voltage);
+    float ppm = lutLookupPPM(adc);
     
     Serial.print("ADC: "); Serial.print(adc);
     Serial.print(" | D0: "); Serial.print(d0);
@@ -399,7 +457,7 @@ void debugSensor() {
  *       time-critical code sections.
  */
 void lcdDebug() {
-    int adc = analogRead(CO2_analog_pin);
+    int adc = readSensorADC();
     float voltage = adc * (5.0 / 1023.0);
     float Rs = calculateRs(voltage);
     float ppm = calculatePPM(voltage);
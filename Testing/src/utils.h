@@ -2,11 +2,13 @@
 #define UTILS_H
 
 #include <Arduino.h>
+#include "config.h"
 
 void updatePPMReading();
 float getAveragePPM();
 float calculateRs(float sensor_volt);
 float calculatePPM(float sensor_volt);
+float calculatePPMFromCode(uint16_t code);
 int getAirQualityLevel(float ppm);
 String getQualityText(int level);
 void debugSensorValues();
@@ -0,0 +1,138 @@
+/**
+ * @file warmup.cpp
+ * @brief Detects when the MQ-135 heater has settled during preheat.
+ *
+ * A cold MQ-135 reads a low Rs that climbs toward its clean-air value as
+ * the heater warms the sensing layer; a sensor that was only reset for a
+ * moment is already there. Instead of always waiting PREHEAT_FIXED_MS,
+ * preheat ends once Rs has stopped moving:
+ *
+ *  - ADC codes are averaged into one Rs point per second
+ *  - Over the last WARMUP_WINDOW points, the least-squares slope and
+ *    the standard deviation are computed, both relative to the mean Rs
+ *  - The sensor is settled when |slope| < WARMUP_MAX_SLOPE per second
+ *    and std dev < WARMUP_MAX_CV
+ *
+ * The slope test catches the slow exponential approach of a warming
+ * sensor, which has little variance over a few seconds; the variance
+ * test catches a noisy or disturbed signal without a trend.
+ *
+ * performSensorPreheating() adds the hard bounds PREHEAT_MIN_MS and
+ * PREHEAT_MAX_MS around this test.
+ *
+ * Dependencies:
+ *  - utils.h : calculateRs()
+ *
+ * Memory:
+ *  - WARMUP_WINDOW x 4 bytes
+ */
+
+#include "warmup.h"
+#include "utils.h"
+#include <math.h>
+
+static float points[WARMUP_WINDOW];         // Rs (kOhm), one per second
+static uint8_t pointHead = 0;
+static uint8_t pointCount = 0;
+static uint16_t codeSum = 0;
+static uint8_t codeSamples = 0;
+static float slope = 0;                     // fraction of mean Rs per second
+static float cv = 0;
+
+/**
+ * @brief Recomputes slope and variation over a full window.
+ *
+ * The window is oldest-first from pointHead; x runs 0..WARMUP_WINDOW-1.
+ */
+static void updateStatistics() {
+    float mean = 0;
+    for (uint8_t i = 0; i < WARMUP_WINDOW; i++) {
+        mean += points[i];
+    }
+    mean /= WARMUP_WINDOW;
+    if (mean <= 0) {
+        slope = 1;
+        cv = 1;
+        return;
+    }
+
+    const float xMean = (WARMUP_WINDOW - 1) / 2.0;
+    float sxy = 0;
+    float sxx = 0;
+    float syy = 0;
+    for (uint8_t x = 0; x < WARMUP_WINDOW; x++) {
+        float dy = points[(pointHead + x) % WARMUP_WINDOW] - mean;
+        float dx = x - xMean;
+        sxy += dx * dy;
+        sxx += dx * dx;
+        syy += dy * dy;
+    }
+    slope = (sxy / sxx) / mean;
+    cv = sqrt(syy / WARMUP_WINDOW) / mean;
+}
+
+//====================================================
+// Public Interface
+//====================================================
+
+/**
+ * @brief Starts a new warm-up observation.
+ */
+void warmupBegin() {
+    pointHead = 0;
+    pointCount = 0;
+    codeSum = 0;
+    codeSamples = 0;
+    slope = 0;
+    cv = 0;
+}
+
+/**
+ * @brief Feeds one ADC reading; call every WARMUP_SAMPLE_MS.
+ *
+ * Parameters:
+ *  @param code Raw ADC code (0-1023)
+ */
+void warmupAddSample(uint16_t code) {
+    codeSum += code;
+    if (++codeSamples < WARMUP_SAMPLES_PER_POINT) {
+        return;
+    }
+    float meanCode = (float)codeSum / codeSamples;
+    codeSum = 0;
+    codeSamples = 0;
+    if (meanCode < 1) {
+        meanCode = 1;                       // open sensor: Rs huge but finite
+    }
+    points[pointHead] = calculateRs(meanCode * (5.0 / 1023.0));
+    pointHead = (pointHead + 1) % WARMUP_WINDOW;
+    if (pointCount < WARMUP_WINDOW) {
+        pointCount++;
+    }
+    if (pointCount == WARMUP_WINDOW) {
+        updateStatistics();
+    }
+}
+
+/**
+ * @brief Reports whether Rs has stayed inside the band for a full window.
+ */
+bool warmupSettled() {
+    return pointCount == WARMUP_WINDOW
+        && fabs(slope) < WARMUP_MAX_SLOPE
+        && cv < WARMUP_MAX_CV;
+}
+
+/**
+ * @brief Relative Rs slope over the last window (per second).
+ */
+float warmupSlope() {
+    return slope;
+}
+
+/**
+ * @brief Relative Rs standard deviation over the last window.
+ */
+float warmupCV() {
+    return cv;
+}
@@ -0,0 +1,24 @@
+#ifndef WARMUP_H
+#define WARMUP_H
+
+#include <Arduino.h>
+
+//---------------------------
+// Adaptive preheat (warm-up settling detector)
+//---------------------------
+const unsigned long PREHEAT_FIXED_MS = 20000;      // the fixed wait (ADAPTIVE_PREHEAT=0)
+const unsigned long PREHEAT_MIN_MS = 8000;         // never ready sooner, even if warm
+const unsigned long PREHEAT_MAX_MS = 60000;        // ready regardless after this
+const unsigned long WARMUP_SAMPLE_MS = 100;        // ADC read interval during preheat
+const uint8_t WARMUP_SAMPLES_PER_POINT = 10;       // one Rs point per second
+const uint8_t WARMUP_WINDOW = 8;                   // settled for 8 s ...
+const float WARMUP_MAX_CV = 0.005;                 // ... std dev below 0.5 % of mean Rs
+const float WARMUP_MAX_SLOPE = 0.001;              // ... and |slope| below 0.1 % of Rs per second
+
+void warmupBegin();
+void warmupAddSample(uint16_t code);
+bool warmupSettled();
+float warmupSlope();
+float warmupCV();
+
+#endif
@@ -0,0 +1,131 @@
+// Host-side test for the per-unit curve fit (src/curvefit.cpp, UNIT_CURVE=1).
+//
+// Drives the "fit ..." console commands against the simulated board in
+// hal/native with readings generated from a known curve, then checks:
+//  - fit -> save: the fitted k and n match the generating curve and are
+//    applied at once
+//  - restore: after a reset with the factory curve in RAM, curveFitLoad()
+//    reads the saved record back from EEPROM
+//  - a corrupted record is ignored and the factory curve kept
+//  - fit reset: recorded points are discarded and a save is refused
+//  - fit factory: the factory curve is back and the EEPROM record erased,
+//    so the next boot keeps it too
+//
+// Build and run on the host (no Arduino needed):
+//   g++ -std=gnu++11 -O2 -DNATIVE_HAL -DUNIT_CURVE=1 -I../hal/native -I../src curvefit_test.cpp
+//       $(ls ../src/*.cpp | grep -v main.cpp) ../hal/native/hal_native.cpp
+//       ../hal/native/Print.cpp ../hal/native/WString.cpp -o curvefit_test
+//   ./curvefit_test
+//
+// Exits non-zero if any check fails.
+
+#include <math.h>
+#include <stdio.h>
+#include "curvefit.h"
+#include "globals.h"
+#include "hal_native.h"
+
+#if !UNIT_CURVE
+#error "build with -DUNIT_CURVE=1"
+#endif
+
+const float TRUE_RATIO = 2.5;           // the unit's k and n, inside the plausible bounds
+const float TRUE_EXPONENT = 3.5;
+const float OTHER_RATIO = 3.2;          // points recorded and then discarded by "fit reset"
+const float TEST_R0 = 76.63;
+const float MAX_RELATIVE_ERROR = 0.001;
+
+static int failures = 0;
+
+static void check(bool ok, const char *what) {
+    printf("%-52s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) {
+        failures++;
+    }
+}
+
+static bool near(float value, float expected) {
+    return fabs(value - expected) <= MAX_RELATIVE_ERROR * fabs(expected);
+}
+
+// Moving-average ADC code a unit with clean-air ratio k reads at a given concentration.
+static float codeAt(float ppm, float ratio) {
+    float rs = TEST_R0 * ratio * pow(ppm / 400.0, -1.0 / TRUE_EXPONENT);
+    return 1023.0 * RL / (rs + RL);
+}
+
+static void recordPoint(const char *ppmText, float ppm, float ratio = TRUE_RATIO) {
+    curveFitCommand(ppmText);
+    for (uint8_t i = 0; i < CURVE_FIT_POINT_SECONDS; i++) {
+        curveFitUpdate(codeAt(ppm, ratio));
+    }
+}
+
+// What setup() does after a reset: RAM holds the factory curve again.
+static void reboot() {
+    unitCleanAirRatio = FactoryCurve::cleanAirRatio();
+    unitCurveExponent = FactoryCurve::exponent();
+    curveFitLoad();
+}
+
+int main() {
+    halSetSerialOutput(fopen("/dev/null", "w"));
+    R0 = TEST_R0;
+    const float factoryRatio = FactoryCurve::cleanAirRatio();
+    const float factoryExponent = FactoryCurve::exponent();
+
+    curveFitLoad();
+    check(unitCleanAirRatio == factoryRatio && unitCurveExponent == factoryExponent,
+          "erased EEPROM: factory curve");
+
+    // fit -> save
+    recordPoint("400", 400);
+    recordPoint("1000", 1000);
+    recordPoint("2500", 2500);
+    check(curveFitActive(), "session open while recording");
+    curveFitCommand("save");
+    check(near(unitCleanAirRatio, TRUE_RATIO) && near(unitCurveExponent, TRUE_EXPONENT),
+          "fit save: k and n of the generating curve applied");
+    check(!curveFitActive(), "fit save: session closed");
+
+    // restore
+    reboot();
+    check(near(unitCleanAirRatio, TRUE_RATIO) && near(unitCurveExponent, TRUE_EXPONENT),
+          "reboot: saved curve restored from EEPROM");
+
+    uint8_t *eeprom = halEeprom();
+    eeprom[CURVE_FIT_ADDR + 5] ^= 0x01;
+    reboot();
+    check(unitCleanAirRatio == factoryRatio && unitCurveExponent == factoryExponent,
+          "corrupted record: factory curve kept");
+    eeprom[CURVE_FIT_ADDR + 5] ^= 0x01;
+    reboot();
+    check(near(unitCleanAirRatio, TRUE_RATIO), "repaired record: saved curve restored");
+
+    // fit reset
+    recordPoint("400", 400, OTHER_RATIO);
+    recordPoint("2000", 2000, OTHER_RATIO);
+    curveFitCommand("reset");
+    check(!curveFitActive(), "fit reset: session closed");
+    curveFitCommand("save");
+    check(near(unitCleanAirRatio, TRUE_RATIO) && near(unitCurveExponent, TRUE_EXPONENT),
+          "fit reset: points gone, save refused, curve unchanged");
+    reboot();
+    check(near(unitCleanAirRatio, TRUE_RATIO), "fit reset: EEPROM record unchanged");
+
+    // fit factory
+    curveFitCommand("factory");
+    check(unitCleanAirRatio == factoryRatio && unitCurveExponent == factoryExponent,
+          "fit factory: factory curve applied");
+    bool erased = true;
+    for (uint8_t i = 0; i < 12; i++) {
+        erased = erased && eeprom[CURVE_FIT_ADDR + i] == 0xFF;
+    }
+    check(erased, "fit factory: EEPROM record erased");
+    reboot();
+    check(unitCleanAirRatio == factoryRatio && unitCurveExponent == factoryExponent,
+          "fit factory: reboot keeps the factory curve");
+
+    printf("%s\n", failures ? "FAILED" : "all passed");
+    return failures ? 1 : 0;
+}
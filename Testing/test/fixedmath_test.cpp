@@ -0,0 +1,80 @@
+// Host-side equivalence test for the fixed-point sensor math (src/fixedmath.cpp).
+//
+// Compares the Q16.16 pipeline used when SENSOR_MATH_FIXED=1 against the
+// float reference formula PPM = 400 * (k / (Rs/R0))^n for every ADC code,
+// every curve policy in curve.h, and the R0 range explored in
+// CO2_testing.ipynb (50-500 kOhm).
+// Only readings inside the meaningful range [PPM_MIN, PPM_MAX] are scored,
+// and the +/-0.5 ppm of the fixed path's whole-ppm output is not counted
+// as error.
+//
+// Build and run on the host (no Arduino needed):
+//   g++ -std=c++11 -O2 -I../src fixedmath_test.cpp ../src/fixedmath.cpp -o fixedmath_test
+//   ./fixedmath_test
+//
+// Exits non-zero if any scored reading exceeds MAX_RELATIVE_ERROR.
+
+#include <math.h>
+#include <stdio.h>
+#include "fixedmath.h"
+#include "curve.h"
+#include "curve_generated.h"
+
+const float RL = 20.0;
+const double PPM_MIN = 10.0;
+const double PPM_MAX = 100000.0;
+const double MAX_RELATIVE_ERROR = 0.0025;  // 0.25 %
+
+template <class Curve>
+double referencePPM(int code, float r0) {
+    double volt = code * (5.0 / 1023.0);
+    double rs = ((5.0 / volt) - 1.0) * RL;
+    double ratio = rs / r0;
+    return 400.0 * pow(Curve::cleanAirRatio() / ratio, Curve::exponent());
+}
+
+template <class Curve>
+bool checkCurve(const char *name) {
+    double worst = 0.0;
+    int worstCode = 0;
+    float worstR0 = 0.0f;
+    long scored = 0;
+    q16_t exponent = curveExponentQ16<Curve>();
+    if (exponent != floatToQ16(Curve::exponent())) {
+        printf("%-26s curveExponentQ16 %ld != floatToQ16 %ld  FAIL\n",
+               name, (long)exponent, (long)floatToQ16(Curve::exponent()));
+        return false;
+    }
+
+    for (float r0 = 50.0f; r0 <= 500.0f; r0 += 1.0f) {
+        q16_t log2Scale = fxLog2Scale(Curve::cleanAirRatio(), r0, RL);
+        for (int code = 1; code < 1023; code++) {
+            double expected = referencePPM<Curve>(code, r0);
+            if (expected < PPM_MIN || expected > PPM_MAX) {
+                continue;
+            }
+            double actual = fxSensorPPM(code, 1023, log2Scale, exponent);
+            double error = fabs(actual - expected) - 0.5;
+            error = (error > 0.0) ? error / expected : 0.0;
+            scored++;
+            if (error > worst) {
+                worst = error;
+                worstCode = code;
+                worstR0 = r0;
+            }
+        }
+    }
+
+    bool ok = worst <= MAX_RELATIVE_ERROR;
+    printf("%-26s %7ld readings  max error %.4f %%  (code %d, R0 %.0f)  %s\n",
+           name, scored, worst * 100.0, worstCode, worstR0, ok ? "PASS" : "FAIL");
+    return ok;
+}
+
+int main() {
+    bool passed = true;
+    passed = checkCurve<CurveRatio18>("400*(1.8/ratio)^10") && passed;
+    passed = checkCurve<CurveRatio109>("400*(1.09/ratio)^3.9216") && passed;
+    passed = checkCurve<CurveGenerated>("curve_generated.h") && passed;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,527 @@
+/**
+ * @file fitcurve.cpp
+ * @brief Host-side calibration curve fitter that writes firmware headers.
+ *
+ * Replaces the hand fit in test/CO2_testing.ipynb, whose results were
+ * copied into the firmware by hand. Reads reference measurements of one
+ * or more sensors, fits every model to every sensor in parallel, reports
+ * the residuals and writes a header that the uno and native builds
+ * include with CO2_CURVE=2 (src/curve.h).
+ *
+ * Usage:
+ *   fitcurve [options] INPUT...
+ *
+ *   Each INPUT is one sensor, either
+ *     LOG                    reference log: one reading per line,
+ *                            "PPM ADC [R0]" (spaces or commas, # comments)
+ *     TRACE@T0-T1:PPM[,...]  recorded .mqtr ADC trace (sim --record, or
+ *                            sim --convert-log of a debugSensor() capture)
+ *                            with the seconds T0..T1 held at PPM
+ *
+ *   --r0 KOHM         R0 of the sensors (default: a trace's R0 at capture,
+ *                     else 76.63; a log's third column wins)
+ *   --rl KOHM         load resistor (default 20)
+ *   --model NAME      model written to the header: power (default; the
+ *                     only one the firmware evaluates)
+ *   --header FILE     write the header for the (single) input
+ *   --header-dir DIR  write DIR/curve_<sensor>.h for every input
+ *   --lut             add an ADC -> PPM table to the header
+ *   --lut-r0 KOHM     R0 the table is computed for (default: the sensor's)
+ *   --jobs N          worker threads (default: all cores)
+ *
+ * Models (least squares in the transformed space, x = ln(PPM / 400),
+ * y = ln(Rs / R0)):
+ *   power    y = a + b x                 PPM = 400 (k / ratio)^n, k = e^a, n = -1/b
+ *   loglog2  y = a + b x + c x^2         curvature in log-log
+ *   exp      ln PPM = a + b ratio        PPM = e^a e^(b ratio)
+ *   factory  the compiled-in FactoryCurve (not fitted, for comparison)
+ *
+ * Residuals are given in PPM: every reference point's mean ratio is
+ * turned back into PPM by the model and compared with the reference.
+ *
+ * A batch of sensors is recalibrated with one call, e.g.
+ *   fitcurve --header-dir out unit1.csv unit2.csv unit3.mqtr@0-600:400,900-1500:2000
+ * and each unit is built with its header copied to src/curve_generated.h.
+ *
+ * Build (host only):
+ *   g++ -std=c++11 -O2 -pthread -I../src -I../sim fitcurve.cpp ../sim/adc_trace.cpp -o fitcurve
+ * or: pio run -e fitcurve
+ *
+ * Dependencies:
+ *  - sim/adc_trace.h : trace reader
+ *  - src/curve.h     : FactoryCurve for the comparison row
+ */
+
+#include "adc_trace.h"
+#include "curve.h"
+
+#include <algorithm>
+#include <atomic>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const double DEFAULT_R0 = 76.63;
+static const double FULL_SCALE = 1023.0;
+
+struct Reading {
+    double ppm;
+    double ratio;           // Rs / R0
+};
+
+struct Sensor {
+    std::string name;
+    std::string source;
+    double r0;              // R0 of the last reading, for the LUT
+    std::vector<Reading> readings;
+};
+
+enum Model { MODEL_POWER, MODEL_LOGLOG2, MODEL_EXP, MODEL_FACTORY, MODEL_COUNT };
+
+static const char *const MODEL_NAMES[MODEL_COUNT] = { "power", "loglog2", "exp", "factory" };
+
+struct Fit {
+    bool ok;
+    double coef[3];         // a, b, c of the model's transformed line
+    double r2;              // in the fitted space
+    double rmsPct;          // PPM residual over reference points
+    double maxPct;
+    unsigned points;
+};
+
+struct Options {
+    double r0;
+    bool r0Given;
+    double rl;
+    Model headerModel;
+    const char *header;
+    const char *headerDir;
+    bool lut;
+    double lutR0;
+    unsigned jobs;
+};
+
+//====================================================
+// Input
+//====================================================
+
+static double ratioFromCode(double code, double r0, double rl) {
+    return (FULL_SCALE / code - 1.0) * rl / r0;
+}
+
+static std::string stem(const char *path) {
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    std::string name(base);
+    size_t dot = name.find('.');
+    return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+static bool readLog(const char *path, const Options &options, Sensor *sensor) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return false;
+    }
+    char line[256];
+    unsigned number = 0;
+    sensor->r0 = options.r0;
+    while (fgets(line, sizeof(line), file)) {
+        number++;
+        for (char *p = line; *p; p++) {
+            if (*p == ',') *p = ' ';
+        }
+        double ppm, code, r0 = options.r0;
+        int fields = sscanf(line, "%lf %lf %lf", &ppm, &code, &r0);
+        if (line[0] == '#' || fields < 2) {
+            continue;
+        }
+        if (ppm <= 0 || code <= 0 || code >= FULL_SCALE || r0 <= 0) {
+            fprintf(stderr, "%s:%u: reading out of range, skipped\n", path, number);
+            continue;
+        }
+        Reading reading = { ppm, ratioFromCode(code, r0, options.rl) };
+        sensor->readings.push_back(reading);
+        sensor->r0 = r0;
+    }
+    fclose(file);
+    return true;
+}
+
+/**
+ * @brief TRACE@T0-T1:PPM[,T0-T1:PPM...]: every sample inside a window is a reading.
+ */
+static bool readTrace(const char *spec, const Options &options, Sensor *sensor) {
+    const char *at = strchr(spec, '@');
+    std::string path(spec, at - spec);
+    AdcTraceReader trace;
+    if (!adcTraceOpen(&trace, path.c_str())) {
+        return false;
+    }
+    double rate = adcTraceSampleRate(&trace);
+    double r0 = options.r0Given || trace.header->r0AtCapture <= 0 ? options.r0 : trace.header->r0AtCapture;
+    sensor->name = stem(path.c_str());
+    sensor->r0 = r0;
+
+    const char *p = at + 1;
+    bool ok = true;
+    while (*p) {
+        double t0, t1, ppm;
+        int used = 0;
+        if (sscanf(p, "%lf-%lf:%lf%n", &t0, &t1, &ppm, &used) != 3 || t1 <= t0 || ppm <= 0) {
+            fprintf(stderr, "%s: bad window \"%s\" (want T0-T1:PPM)\n", path.c_str(), p);
+            ok = false;
+            break;
+        }
+        uint32_t first = (uint32_t)(t0 * rate);
+        uint32_t last = std::min((uint32_t)(t1 * rate), trace.header->sampleCount);
+        for (uint32_t i = first; i < last && adcTraceSeek(&trace, i); i++) {
+            if (trace.code > 0 && trace.code < FULL_SCALE) {
+                Reading reading = { ppm, ratioFromCode(trace.code, r0, options.rl) };
+                sensor->readings.push_back(reading);
+            }
+        }
+        p += used;
+        if (*p == ',') {
+            p++;
+        }
+    }
+    adcTraceCloseReader(&trace);
+    return ok;
+}
+
+//====================================================
+// Models
+//====================================================
+
+/**
+ * @brief Least squares y = c0 + c1 x (+ c2 x^2), normal equations on
+ * centred data, solved by Cramer's rule.
+ */
+static bool leastSquares(const std::vector<double> &x, const std::vector<double> &y,
+                         int terms, double *coef, double *r2) {
+    size_t n = x.size();
+    if (n < (size_t)terms) {
+        return false;
+    }
+    double mx = 0, my = 0;
+    for (size_t i = 0; i < n; i++) {
+        mx += x[i];
+        my += y[i];
+    }
+    mx /= n;
+    my /= n;
+    // Centred powers u = x - mx, u^2 - mean(u^2)
+    double mu2 = 0;
+    for (size_t i = 0; i < n; i++) {
+        mu2 += (x[i] - mx) * (x[i] - mx);
+    }
+    mu2 /= n;
+    double s11 = 0, s12 = 0, s22 = 0, s1y = 0, s2y = 0, syy = 0;
+    for (size_t i = 0; i < n; i++) {
+        double u = x[i] - mx;
+        double v = u * u - mu2;
+        double w = y[i] - my;
+        s11 += u * u;
+        s12 += u * v;
+        s22 += v * v;
+        s1y += u * w;
+        s2y += v * w;
+        syy += w * w;
+    }
+    double b1, b2 = 0;
+    if (terms == 2) {
+        if (s11 <= 0) return false;
+        b1 = s1y / s11;
+    } else {
+        double det = s11 * s22 - s12 * s12;
+        if (fabs(det) <= 1e-12 * s11 * s22) return false;
+        b1 = (s1y * s22 - s2y * s12) / det;
+        b2 = (s2y * s11 - s1y * s12) / det;
+    }
+    // Back to y = c0 + c1 x + c2 x^2
+    coef[2] = b2;
+    coef[1] = b1 - 2 * b2 * mx;
+    coef[0] = my - b1 * mx + b2 * (mx * mx - mu2);
+    double explained = b1 * s1y + b2 * s2y;
+    *r2 = syy > 0 ? explained / syy : 1.0;
+    return true;
+}
+
+/**
+ * @brief PPM the model gives for a ratio, or a negative value if none.
+ */
+static double modelPPM(Model model, const double *c, double ratio) {
+    double y = log(ratio);
+    switch (model) {
+    case MODEL_POWER:
+        return 400.0 * exp((y - c[0]) / c[1]);
+    case MODEL_LOGLOG2: {
+        // c2 x^2 + c1 x + (c0 - y) = 0, the root on the branch through the data
+        if (fabs(c[2]) < 1e-12) {
+            return 400.0 * exp((y - c[0]) / c[1]);
+        }
+        double disc = c[1] * c[1] - 4 * c[2] * (c[0] - y);
+        if (disc < 0) return -1.0;
+        double x = (-c[1] - (c[1] < 0 ? -1 : 1) * sqrt(disc)) / (2 * c[2]);
+        double other = (c[0] - y) / (c[2] * x);
+        // pick the root where dy/dx has the sign of c1 (monotonic branch)
+        if ((c[1] + 2 * c[2] * x) * c[1] <= 0) x = other;
+        return 400.0 * exp(x);
+    }
+    case MODEL_EXP:
+        return exp(c[0] + c[1] * ratio);
+    case MODEL_FACTORY:
+        return curvePPM<FactoryCurve>((float)ratio);
+    default:
+        return -1.0;
+    }
+}
+
+static Fit fitModel(const Sensor &sensor, Model model) {
+    Fit fit;
+    memset(&fit, 0, sizeof(fit));
+    std::vector<double> x, y;
+    x.reserve(sensor.readings.size());
+    y.reserve(sensor.readings.size());
+    for (size_t i = 0; i < sensor.readings.size(); i++) {
+        const Reading &r = sensor.readings[i];
+        if (model == MODEL_EXP) {
+            x.push_back(r.ratio);
+            y.push_back(log(r.ppm));
+        } else {
+            x.push_back(log(r.ppm / 400.0));
+            y.push_back(log(r.ratio));
+        }
+    }
+    switch (model) {
+    case MODEL_POWER:
+    case MODEL_EXP:
+        fit.ok = leastSquares(x, y, 2, fit.coef, &fit.r2);
+        break;
+    case MODEL_LOGLOG2:
+        fit.ok = leastSquares(x, y, 3, fit.coef, &fit.r2);
+        break;
+    case MODEL_FACTORY:
+        fit.coef[0] = log(FactoryCurve::cleanAirRatio());
+        fit.coef[1] = -1.0 / FactoryCurve::exponent();
+        fit.ok = true;
+        fit.r2 = NAN;
+        break;
+    default:
+        break;
+    }
+    if (!fit.ok) {
+        return fit;
+    }
+
+    // Residuals per reference point (readings grouped by reference PPM)
+    std::vector<double> levels;
+    for (size_t i = 0; i < sensor.readings.size(); i++) {
+        levels.push_back(sensor.readings[i].ppm);
+    }
+    std::sort(levels.begin(), levels.end());
+    levels.erase(std::unique(levels.begin(), levels.end()), levels.end());
+    double sumSq = 0;
+    for (size_t l = 0; l < levels.size(); l++) {
+        double logRatio = 0;
+        unsigned count = 0;
+        for (size_t i = 0; i < sensor.readings.size(); i++) {
+            if (sensor.readings[i].ppm == levels[l]) {
+                logRatio += log(sensor.readings[i].ratio);
+                count++;
+            }
+        }
+        double predicted = modelPPM(model, fit.coef, exp(logRatio / count));
+        double error = predicted > 0 ? fabs(predicted / levels[l] - 1.0) * 100.0 : 100.0;
+        sumSq += error * error;
+        fit.maxPct = std::max(fit.maxPct, error);
+    }
+    fit.points = (unsigned)levels.size();
+    fit.rmsPct = sqrt(sumSq / levels.size());
+    if ((model == MODEL_POWER || model == MODEL_EXP) && fit.points < 2) {
+        fit.ok = false;
+    }
+    if (model == MODEL_LOGLOG2 && fit.points < 3) {
+        fit.ok = false;
+    }
+    return fit;
+}
+
+//====================================================
+// Header
+//====================================================
+
+static bool writeHeader(const char *path, const Sensor &sensor, Model model, const Fit &fit,
+                        const Options &options) {
+    if (model != MODEL_POWER) {
+        fprintf(stderr, "%s: the firmware evaluates the power law only\n", MODEL_NAMES[model]);
+        return false;
+    }
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "%s: cannot write\n", path);
+        return false;
+    }
+    double k = exp(fit.coef[0]);
+    double n = -1.0 / fit.coef[1];
+    fprintf(file, "// Generated by tools/fitcurve.cpp -- do not edit; rerun the fitter instead.\n");
+    fprintf(file, "// Sensor %s (%s): %zu readings, %u reference points, RL %.2f kOhm\n",
+            sensor.name.c_str(), sensor.source.c_str(), sensor.readings.size(), fit.points, options.rl);
+    fprintf(file, "// power law: R^2 %.5f, PPM residual rms %.2f %%, max %.2f %%\n",
+            fit.r2, fit.rmsPct, fit.maxPct);
+    fprintf(file, "// Selected with CO2_CURVE=2 (src/curve.h).\n\n");
+    fprintf(file, "#ifndef CURVE_GENERATED_H\n#define CURVE_GENERATED_H\n\n");
+    fprintf(file, "#include <stdint.h>\n\n");
+    fprintf(file, "struct CurveGenerated {\n");
+    fprintf(file, "    static constexpr float cleanAirRatio() { return %.6ff; }\n", k);
+    fprintf(file, "    static constexpr float exponent() { return %.6ff; }\n", n);
+    fprintf(file, "};\n");
+
+    if (options.lut) {
+        double r0 = options.lutR0 > 0 ? options.lutR0 : sensor.r0;
+        // Codes from the first one reaching 10 ppm to the last below 65535 ppm
+        int first = 1, last = 1022;
+        while (first < last && 400.0 * pow(k / ratioFromCode(first, r0, options.rl), n) < 10.0) first++;
+        while (last > first && 400.0 * pow(k / ratioFromCode(last, r0, options.rl), n) > 65535.0) last--;
+        fprintf(file, "\n// ADC code -> PPM for R0 %.2f kOhm, codes %d..%d (PPM = table[code - first]).\n",
+                r0, first, last);
+        fprintf(file, "#define CURVE_GENERATED_LUT 1\n");
+        fprintf(file, "#ifdef __AVR__\n#include <avr/pgmspace.h>\n#define CURVE_GENERATED_STORAGE PROGMEM\n"
+                      "#else\n#define CURVE_GENERATED_STORAGE\n#endif\n");
+        fprintf(file, "const float CURVE_GENERATED_LUT_R0 = %.4ff;\n", r0);
+        fprintf(file, "const uint16_t CURVE_GENERATED_LUT_FIRST = %d;\n", first);
+        fprintf(file, "const uint16_t CURVE_GENERATED_LUT_SIZE = %d;\n", last - first + 1);
+        fprintf(file, "const uint16_t curveGeneratedLut[] CURVE_GENERATED_STORAGE = {");
+        for (int code = first; code <= last; code++) {
+            double ppm = 400.0 * pow(k / ratioFromCode(code, r0, options.rl), n);
+            fprintf(file, "%s%u,", (code - first) % 12 == 0 ? "\n    " : " ", (unsigned)lround(ppm));
+        }
+        fprintf(file, "\n};\n");
+    }
+    fprintf(file, "\n#endif\n");
+    return fclose(file) == 0;
+}
+
+//====================================================
+// Main
+//====================================================
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [--r0 KOHM] [--rl KOHM] [--model power] [--header FILE | --header-dir DIR]\n"
+            "          [--lut [--lut-r0 KOHM]] [--jobs N] INPUT...\n"
+            "  INPUT: LOG (\"PPM ADC [R0]\" lines) or TRACE.mqtr@T0-T1:PPM[,T0-T1:PPM...]\n",
+            program);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    Options options = { DEFAULT_R0, false, 20.0, MODEL_POWER, NULL, NULL, false, 0.0,
+                        std::max(1u, std::thread::hardware_concurrency()) };
+    std::vector<const char *> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--lut") == 0) { options.lut = true; continue; }
+        if (strncmp(arg, "--", 2) != 0) { inputs.push_back(arg); continue; }
+        if (i + 1 >= argc) usage(argv[0]);
+        const char *value = argv[++i];
+        if (strcmp(arg, "--r0") == 0)              { options.r0 = atof(value); options.r0Given = true; }
+        else if (strcmp(arg, "--rl") == 0)         options.rl = atof(value);
+        else if (strcmp(arg, "--header") == 0)     options.header = value;
+        else if (strcmp(arg, "--header-dir") == 0) options.headerDir = value;
+        else if (strcmp(arg, "--lut-r0") == 0)     options.lutR0 = atof(value);
+        else if (strcmp(arg, "--jobs") == 0)       options.jobs = std::max(1, atoi(value));
+        else if (strcmp(arg, "--model") == 0) {
+            int m = 0;
+            while (m < MODEL_COUNT && strcmp(MODEL_NAMES[m], value) != 0) m++;
+            if (m == MODEL_COUNT) usage(argv[0]);
+            options.headerModel = (Model)m;
+        }
+        else usage(argv[0]);
+    }
+    if (inputs.empty() || options.r0 <= 0 || options.rl <= 0 || (options.header && inputs.size() != 1)) {
+        usage(argv[0]);
+    }
+
+    std::vector<Sensor> sensors(inputs.size());
+    for (size_t s = 0; s < inputs.size(); s++) {
+        Sensor &sensor = sensors[s];
+        sensor.source = inputs[s];
+        bool ok;
+        if (strchr(inputs[s], '@')) {
+            ok = readTrace(inputs[s], options, &sensor);
+        } else {
+            sensor.name = stem(inputs[s]);
+            ok = readLog(inputs[s], options, &sensor);
+        }
+        if (!ok) {
+            return 1;
+        }
+        if (sensor.readings.empty()) {
+            fprintf(stderr, "%s: no readings\n", inputs[s]);
+            return 1;
+        }
+    }
+
+    // Every (sensor, model) pair is an independent job.
+    size_t jobCount = sensors.size() * MODEL_COUNT;
+    std::vector<Fit> fits(jobCount);
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    unsigned threads = (unsigned)std::min<size_t>(options.jobs, jobCount);
+    for (unsigned t = 0; t < threads; t++) {
+        workers.push_back(std::thread([&]() {
+            for (size_t j = next++; j < jobCount; j = next++) {
+                fits[j] = fitModel(sensors[j / MODEL_COUNT], (Model)(j % MODEL_COUNT));
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+
+    printf("%zu sensor(s), %d models, %u thread(s); residuals in PPM over reference points\n",
+           sensors.size(), MODEL_COUNT, threads);
+    int status = 0;
+    for (size_t s = 0; s < sensors.size(); s++) {
+        const Sensor &sensor = sensors[s];
+        printf("\n%s: %zu readings\n", sensor.name.c_str(), sensor.readings.size());
+        printf("  %-8s %12s %12s %12s %9s %9s %9s\n", "model", "a", "b", "c", "R^2", "rms %", "max %");
+        for (int m = 0; m < MODEL_COUNT; m++) {
+            const Fit &fit = fits[s * MODEL_COUNT + m];
+            if (!fit.ok) {
+                printf("  %-8s %12s\n", MODEL_NAMES[m], "(too few points)");
+                continue;
+            }
+            printf("  %-8s %12.6f %12.6f %12.6f %9.5f %9.2f %9.2f", MODEL_NAMES[m],
+                   fit.coef[0], fit.coef[1], fit.coef[2], fit.r2, fit.rmsPct, fit.maxPct);
+            if (m == MODEL_POWER || m == MODEL_FACTORY) {
+                printf("   k %.4f n %.4f", exp(fit.coef[0]), -1.0 / fit.coef[1]);
+            }
+            printf("\n");
+        }
+
+        const Fit &chosen = fits[s * MODEL_COUNT + options.headerModel];
+        std::string path;
+        if (options.header) {
+            path = options.header;
+        } else if (options.headerDir) {
+            path = std::string(options.headerDir) + "/curve_" + sensor.name + ".h";
+        } else {
+            continue;
+        }
+        if (!chosen.ok || !writeHeader(path.c_str(), sensor, options.headerModel, chosen, options)) {
+            fprintf(stderr, "%s: no header written\n", sensor.name.c_str());
+            status = 1;
+            continue;
+        }
+        printf("  header: %s\n", path.c_str());
+    }
+    return status;
+}